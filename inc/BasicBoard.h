@@ -2,10 +2,16 @@
 #define GOL_BASIC_BOARD_H
 
 #include "Board.h"
+#include "BoundingBox.h"
+#include <memory>
 #include <vector>
 
 /**
  * A simple implementation of the Board API.
+ *
+ * Rows are shared with snapshots and with the copy update() reads from,
+ * and only copied when a cell in them changes, so a snapshot costs a
+ * pointer per row to take.
  */
 class BasicBoard : public Board
 {
@@ -13,9 +19,43 @@ class BasicBoard : public Board
   CellIndex mRows; /// Number of rows in game board.
   CellIndex mColumns; /// Number of columns in game board.
 
-  /// Board representation using std::vector's bool specialization, which uses
+  /// Row representation using std::vector's bool specialization, which uses
   /// one bit per cell.
-  std::vector< std::vector<bool> > mBoard;
+  typedef std::vector<bool> Row;
+
+  /// Board representation, a row at a time. Rows may be shared, so
+  /// ownRow() must be called before changing one.
+  std::vector< std::shared_ptr<Row> > mBoard;
+
+  int64_t mPopulation; /// Number of live cells.
+  mutable BoundingBox mBox; /// Bounding box of live cells.
+
+  /// Two-dimensional Fenwick tree of live cells, (mRows + 1) by
+  /// (mColumns + 1), for counting cells in rectangles. Built when first
+  /// needed after update(), then kept up to date by setCell().
+  mutable std::vector<int32_t> mTree;
+  mutable bool mTreeDirty; /// Whether mTree must be built again.
+
+  /// Test whether a row is shared with a snapshot or another board.
+  static bool isShared(const std::shared_ptr<Row>& row);
+
+  /// Get row i for writing, copying it first if it is shared.
+  Row& ownRow(CellIndex i);
+
+  /// Bytes taken by a row.
+  size_t getRowBytes() const;
+
+  /// Share rows and cached bounds with a snapshot.
+  void shareRows(BasicBoard& copy) const;
+
+  /// Build mTree if it is dirty.
+  void buildTree() const;
+
+  /// Add to the count of cell (i, j) in mTree, unless it is dirty.
+  void addToTree(CellIndex i, CellIndex j, int32_t delta);
+
+  /// Number of live cells in rows [0, i) and columns [0, j), from mTree.
+  int64_t countBefore(CellIndex i, CellIndex j) const;
 
  public:
   BasicBoard(CellIndex rows, CellIndex columns); /// Constructor.
@@ -24,13 +64,51 @@ class BasicBoard : public Board
   
   void setCell(CellIndex i, CellIndex j, bool alive);
 
+  void setCells(const CellCoord* cells, size_t count);
+
   void clearBoard();
   
   void update();
 
+  int64_t getPopulation() const;
+
+  /// When a death has left the box dirty, it is found by binary searches
+  /// over counts of cells before each row and column.
+  bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+  /// Rows [0, rows) and columns [0, columns).
+  bool getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+  /// Takes O(log(rows) log(columns)) once the tree is built, which takes
+  /// time in proportion to the area after each update().
+  int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+  size_t getMemoryUsage() const;
+
+  /// Releases the tree used by countCells().
+  size_t compact();
+
   bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
 
   bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+  /// Shares the rows with the snapshot, which counts cells a row at a
+  /// time rather than building a tree of its own.
+  std::shared_ptr<const Board> snapshot() const;
+};
+
+/**
+ * A snapshot of a BasicBoard, sharing its rows. Its const functions may be
+ * called from several threads at once, so it doesn't build the tree that
+ * BasicBoard::countCells() uses.
+ */
+class FrozenBasicBoard : public BasicBoard
+{
+ public:
+  FrozenBasicBoard(); /// Constructor for an empty board; see BasicBoard::snapshot().
+
+  /// Counts a row at a time.
+  int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
 };
 
 #endif
\ No newline at end of file
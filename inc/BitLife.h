@@ -0,0 +1,156 @@
+#ifndef GOL_BIT_LIFE_H
+#define GOL_BIT_LIFE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * Helpers for updating cells packed one per bit, many cells per word.
+ * Within a packed row, column j lives in bit (j % 64) of word (j / 64).
+ */
+
+/// Number of cells packed into a word.
+static const int BITS_PER_WORD = 64;
+
+/// Number of set bits in a word.
+inline int popCount(uint64_t word)
+{
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(word));
+#else
+    return __builtin_popcountll(word);
+#endif
+}
+
+/// Index of lowest set bit in a nonzero word.
+inline int countTrailingZeros(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(word);
+#endif
+}
+
+/// Index of highest set bit in a nonzero word.
+inline int highestBit(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return static_cast<int>(index);
+#else
+    return BITS_PER_WORD - 1 - __builtin_clzll(word);
+#endif
+}
+
+/// Mask of bits first to last of a word, inclusive.
+inline uint64_t bitRange(int first, int last)
+{
+    uint64_t upTo = (last >= BITS_PER_WORD - 1) ? ~uint64_t(0) : ((uint64_t(1) << (last + 1)) - 1);
+    return upTo & ~((uint64_t(1) << first) - 1);
+}
+
+/**
+ * Apply the GOL rule to many cells at once. Each bit position of the words
+ * is an independent cell; nbrs holds the state of its 8 neighbors. Neighbors
+ * are summed with a bit-sliced adder, so this works for any word type that
+ * supports bitwise operators.
+ */
+template <typename Word>
+inline Word lifeRule(const Word nbrs[8], Word self)
+{
+    // Counts 0-3 are held in bits (ones, twos); fours is set once the count
+    // reaches 4, which means death whatever the rest of the count is.
+    Word ones = nbrs[0] ^ nbrs[0];
+    Word twos = ones;
+    Word fours = ones;
+    for (int n = 0; n < 8; n++)
+    {
+        Word carry = ones & nbrs[n];
+        ones = ones ^ nbrs[n];
+        fours = fours | (twos & carry);
+        twos = twos ^ carry;
+    }
+
+    // Alive with 3 neighbors, or with 2 if already alive.
+    return ~fours & twos & (ones | self);
+}
+
+/// Neighbors to the west: bit j holds the cell in column j - 1.
+inline uint64_t westNeighbors(uint64_t word, uint64_t prevWord)
+{
+    return (word << 1) | (prevWord >> (BITS_PER_WORD - 1));
+}
+
+/// Neighbors to the east: bit j holds the cell in column j + 1.
+inline uint64_t eastNeighbors(uint64_t word, uint64_t nextWord)
+{
+    return (word >> 1) | (nextWord << (BITS_PER_WORD - 1));
+}
+
+/**
+ * Compute the next state of a packed row from it and the rows above and below.
+ * Cells beyond either end of the row are treated as dead.
+ *
+ * @param above - row above, or null if dead
+ * @param row - row to update
+ * @param below - row below, or null if dead
+ * @param out - receives next state of row; must not alias the inputs
+ * @param words - number of words per row
+ */
+inline void lifeRow(const uint64_t* above, const uint64_t* row, const uint64_t* below,
+    uint64_t* out, size_t words)
+{
+    for (size_t w = 0; w < words; w++)
+    {
+        uint64_t a = above ? above[w] : 0;
+        uint64_t c = row[w];
+        uint64_t b = below ? below[w] : 0;
+        uint64_t aPrev = 0, cPrev = 0, bPrev = 0;
+        uint64_t aNext = 0, cNext = 0, bNext = 0;
+        if (w > 0)
+        {
+            aPrev = above ? above[w - 1] : 0;
+            cPrev = row[w - 1];
+            bPrev = below ? below[w - 1] : 0;
+        }
+        if (w + 1 < words)
+        {
+            aNext = above ? above[w + 1] : 0;
+            cNext = row[w + 1];
+            bNext = below ? below[w + 1] : 0;
+        }
+
+        uint64_t nbrs[8] = {
+            westNeighbors(a, aPrev), a, eastNeighbors(a, aNext),
+            westNeighbors(c, cPrev), eastNeighbors(c, cNext),
+            westNeighbors(b, bPrev), b, eastNeighbors(b, bNext)
+        };
+        out[w] = lifeRule(nbrs, c);
+    }
+}
+
+/**
+ * Read 64 consecutive cells of a packed row starting at any column.
+ * Cells beyond the end of the row (or before its start) read as dead.
+ */
+inline uint64_t extractBits(const uint64_t* row, size_t words, int64_t column)
+{
+    int64_t w = (column >= 0) ? (column / BITS_PER_WORD) : -((BITS_PER_WORD - 1 - column) / BITS_PER_WORD);
+    int shift = static_cast<int>(column - w * BITS_PER_WORD);
+    uint64_t low = ((w >= 0) && (w < static_cast<int64_t>(words))) ? row[w] : 0;
+    if (shift == 0)
+    {
+        return low;
+    }
+    uint64_t high = ((w + 1 >= 0) && (w + 1 < static_cast<int64_t>(words))) ? row[w + 1] : 0;
+    return (low >> shift) | (high << (BITS_PER_WORD - shift));
+}
+
+#endif
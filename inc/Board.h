@@ -1,12 +1,30 @@
 #ifndef GOL_BOARD_H
 #define GOL_BOARD_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 /// Type for indexing into cells; must support 64-bit signed integers.
 typedef int64_t CellIndex;
 
+/// Coordinates of a cell, in (row, column) order.
+typedef std::pair<CellIndex, CellIndex> CellCoord;
+
+/// Up to 64 cells of a row that were born or died in an update: bit b of
+/// mask is set if the cell in column j + b changed.
+struct ChangeSpan
+{
+	CellIndex i; /// Row.
+	CellIndex j; /// Column of bit 0 of mask.
+	uint64_t mask; /// Changed cells, one bit per column; never 0.
+};
+
+class Instrumentation;
+
 /**
  * Represents a GOL board that can update to a new state based on GOL rules.
  * Cells are internally specified in (row, column) format, starting with
@@ -16,6 +34,33 @@ typedef int64_t CellIndex;
  */
 class Board
 {
+public:
+	/// What tryUpdate() does when an update would exceed the memory budget.
+	enum MemoryBudgetPolicy
+	{
+		BUDGET_FAIL,    /// Refuse to update.
+		BUDGET_COMPACT, /// Call compact(), then refuse if still over budget.
+		BUDGET_DUMP     /// Dump and fail: write the board to the dump file, then refuse.
+	};
+
+protected:
+	/// Instrumentation receiving per-generation stats, or null if disabled.
+	Instrumentation* mInstrumentation;
+
+	/// List receiving the cells changed by update(), or null if disabled.
+	std::vector<ChangeSpan>* mChangeSet;
+
+	size_t mPeakMemory; /// Highest memory usage noted so far, in bytes.
+	size_t mMemoryBudget; /// Memory limit for tryUpdate(), or 0 for none.
+	MemoryBudgetPolicy mBudgetPolicy; /// What to do when over budget.
+	std::string mDumpFile; /// File written under BUDGET_DUMP.
+
+	/// Record a memory usage, e.g. transient usage in the middle of update().
+	void notePeakMemory(size_t bytes);
+
+	/// Put mChangeSet in order, for engines that find changes out of order.
+	void sortChangeSet();
+
 public:
 	/// Neighbor count for bringing a new bundle of joy into the world.
 	static const int NEIGHBOR_COUNT_BIRTH = 3;
@@ -26,6 +71,12 @@ public:
 	/// Neighbor counts above this lead to cell death from overcrowding.
 	static const int NEIGHBOR_COUNT_MAX = 3;
 
+	/// Largest side, in cells, of the light cone getFutureWindow() simulates.
+	static const int64_t MAX_LIGHT_CONE_SIDE = int64_t(1) << 30;
+
+	/// Most cells in the light cone getFutureWindow() simulates.
+	static const int64_t MAX_LIGHT_CONE_CELLS = int64_t(1) << 32;
+
 	Board(); /// Constructor.
 	virtual ~Board(); /// Oops. Don't forget this.
 
@@ -37,6 +88,16 @@ public:
 	/// Does nothing if (i, j) is outside range represented by board.
 	virtual void setCell(CellIndex i, CellIndex j, bool alive) = 0;
 
+	/**
+	 * Bring many cells to life at once. Much faster than calling setCell()
+	 * for each one. Cells outside the range represented by the board are
+	 * ignored, as are duplicates.
+	 *
+	 * @param cells - cells to set alive, in any order; sorted is fastest
+	 * @param count - number of cells
+	 */
+	virtual void setCells(const CellCoord* cells, size_t count);
+
 	/// Update entire board to next simulation state.
 	virtual void update() = 0;
 
@@ -51,6 +112,66 @@ public:
 	/// Set all cells to dead state.
 	virtual void clearBoard() = 0;
 
+	/// Number of live cells. Kept up to date as cells change.
+	virtual int64_t getPopulation() const = 0;
+
+	/**
+	 * Get the smallest rectangle holding all live cells, inclusive.
+	 * Kept up to date as cells change, so that this is cheap to call.
+	 * @return false if there are no live cells.
+	 */
+	virtual bool getBoundingBox(CellIndex& iMin, CellIndex& jMin,
+		CellIndex& iMax, CellIndex& jMax) const = 0;
+
+	/**
+	 * Get the rectangle of cells the board can hold, inclusive, for engines
+	 * that cover a bounded rectangle and keep every cell outside it dead.
+	 * @return false if the board is unbounded, which is the default.
+	 */
+	virtual bool getLimits(CellIndex& iMin, CellIndex& jMin,
+		CellIndex& iMax, CellIndex& jMax) const;
+
+	/// Count live cells in rows iMin to iMax and columns jMin to jMax, inclusive.
+	/// The default walks every live cell; engines do better.
+	virtual int64_t countCells(CellIndex iMin, CellIndex jMin,
+		CellIndex iMax, CellIndex jMax) const;
+
+	/// Approximate bytes of memory currently used by the board,
+	/// including allocator overhead of its containers.
+	virtual size_t getMemoryUsage() const = 0;
+
+	/// Estimate of the highest memory usage that the next update()
+	/// will reach, including transient data. Defaults to twice the
+	/// current usage.
+	virtual size_t estimateUpdateMemory() const;
+
+	/// Release memory not needed to represent the live cells.
+	/// @return number of bytes released.
+	virtual size_t compact();
+
+	/// Highest memory usage seen since construction or the last reset,
+	/// including transient usage during update().
+	size_t getPeakMemoryUsage() const;
+
+	/// Restart peak tracking from the current memory usage.
+	void resetPeakMemoryUsage();
+
+	/**
+	 * Limit the memory that tryUpdate() may use.
+	 * @param bytes - limit in bytes, or 0 for no limit
+	 * @param policy - what to do when an update would go over the limit
+	 * @param dumpFile - file to write the board to under BUDGET_DUMP
+	 */
+	void setMemoryBudget(size_t bytes, MemoryBudgetPolicy policy,
+		const std::string& dumpFile = "");
+
+	/**
+	 * Update board to next state, unless the update is estimated to go over
+	 * the memory budget after applying the budget policy.
+	 * @return whether the board was updated.
+	 */
+	bool tryUpdate();
+
 	/**
 	 * Load live cells from file one by one into the board.
 	 * The board must already be constructed.
@@ -60,7 +181,7 @@ public:
 
 	/// Write all live cells to a file.
 	/// @return whether cells could be written to file.
-	bool writeBoard(const std::string& fileName);
+	bool writeBoard(const std::string& fileName) const;
 
 	/// Test whether cell liveness on this board matches the other.
 	bool matches(const Board& other) const;
@@ -75,7 +196,81 @@ public:
 	 * @param width - requested width of bitmap, possibly adjusted by function call
 	 * @param height - requested height
 	 */
-	virtual const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height);
+	virtual const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
+
+	/**
+	 * Get the live cells of a window as they will be some generations from
+	 * now, without changing the board. A cell depends only on cells at most
+	 * one cell away a generation earlier, so only the window's light cone is
+	 * simulated: the window widened by the number of generations on every
+	 * side, shrinking by a cell per side each generation. Nothing outside
+	 * it is touched, however large the board.
+	 *
+	 * Works on any Life engine, from getBitmap() and getLimits(), and gives
+	 * the same cells as running the board that many generations. Engines
+	 * with other rules override it.
+	 *
+	 * @param iMin, jMin, iMax, jMax - window, inclusive
+	 * @param generations - generations ahead, 0 for the window as it is now
+	 * @param cells - receives live cells of the window, sorted
+	 * @return false if the light cone is over MAX_LIGHT_CONE_SIDE or
+	 *         MAX_LIGHT_CONE_CELLS, leaving cells empty.
+	 */
+	virtual bool getFutureWindow(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax,
+		int64_t generations, std::vector<CellCoord>& cells) const;
+
+	/**
+	 * Take an immutable copy of the board as it is now, which may be read
+	 * from other threads while this board goes on updating. Engines share
+	 * their cells with the snapshot where they can, so that it is cheap to
+	 * take; the default copies the live cells into a FrozenBoard.
+	 *
+	 * Must be called from the thread that changes this board, but the
+	 * snapshot's const functions may be called from any thread at once.
+	 */
+	virtual std::shared_ptr<const Board> snapshot() const;
+
+	/**
+	 * Attach instrumentation to collect stats on every update(),
+	 * or pass null to disable it. The board does not take ownership.
+	 */
+	void setInstrumentation(Instrumentation* instrumentation);
+
+	/// Get attached instrumentation, or null if there is none.
+	Instrumentation* getInstrumentation() const;
+
+	/**
+	 * Have every update() fill a list with the cells it changed, or pass
+	 * null to stop. The list is cleared at the start of each update() and
+	 * then holds spans sorted by row and then column, which don't overlap.
+	 * Engines only look for changes while a list is attached. The board
+	 * does not take ownership.
+	 */
+	void setChangeSet(std::vector<ChangeSpan>* changes);
+
+	/// Get attached change list, or null if there is none.
+	std::vector<ChangeSpan>* getChangeSet() const;
+
+	/// Add changed cell (i, j) to a change list, after all cells before it
+	/// in row-major order.
+	static void addChange(std::vector<ChangeSpan>& changes, CellIndex i, CellIndex j)
+	{
+		if (!changes.empty())
+		{
+			ChangeSpan& last = changes.back();
+			uint64_t offset = static_cast<uint64_t>(j) - static_cast<uint64_t>(last.j);
+			if ((last.i == i) && (offset < 64))
+			{
+				last.mask |= uint64_t(1) << offset;
+				return;
+			}
+		}
+		ChangeSpan span = { i, j, 1 };
+		changes.push_back(span);
+	}
+
+	/// Append the cells of a change list to cells, in order.
+	static void getChangedCells(const std::vector<ChangeSpan>& changes, std::vector<CellCoord>& cells);
 };
 
 #endif
\ No newline at end of file
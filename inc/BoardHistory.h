@@ -0,0 +1,122 @@
+#ifndef GOL_BOARD_HISTORY_H
+#define GOL_BOARD_HISTORY_H
+
+#include "Board.h"
+#include <deque>
+#include <vector>
+
+/**
+ * Records the generations a Board goes through, so that it can be stepped
+ * backwards or moved to any earlier generation.
+ *
+ * Each generation is stored as the compressed list of cells that changed
+ * since the one before it. Since a change toggles a cell, the same list
+ * takes the board forwards or backwards, so a single step costs time in
+ * proportion to the number of changed cells. Every so often a keyframe
+ * with all live cells is stored too, so that seeking far back doesn't have
+ * to replay every generation in between. When a memory cap is set, older
+ * keyframes are thinned out first, then the oldest generations are dropped.
+ *
+ * Generations made by step() are recorded from the cells the board reports
+ * changed (see Board::setChangeSet()), and only keyframes read every live
+ * cell off the board, so recording costs time in proportion to the changes
+ * except once every keyframe interval. Nothing else is kept of the latest
+ * generation but the board itself.
+ */
+class BoardHistory
+{
+public:
+    /// Default number of generations between keyframes.
+    static const uint64_t DEFAULT_KEYFRAME_INTERVAL = 64;
+
+    /**
+     * Constructor. The current state of the board becomes generation 0.
+     * @param board - board to record; not owned, and must outlive the history
+     * @param keyframeInterval - generations between keyframes
+     * @param memoryCap - limit on bytes used by recorded generations, or 0 for none
+     */
+    BoardHistory(Board* board, uint64_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL,
+        size_t memoryCap = 0);
+
+    /// Forget all history and start over from the current board as generation 0.
+    void reset();
+
+    /**
+     * Move the board forward a generation. If the board was stepped back,
+     * this replays recorded history; otherwise it updates the board and
+     * records the new generation. Either way, a change set attached to the
+     * board receives the cells that changed.
+     */
+    void step();
+
+    /**
+     * Record the board after it was updated outside of step(). This
+     * compares all of the board's cells with the generation before, which
+     * is rebuilt from the history.
+     * If the board had been stepped back, recorded generations after it
+     * are discarded, since the board now has a different future.
+     */
+    void record();
+
+    /// Move the board back a generation, leaving the cells that changed in
+    /// a change set attached to the board.
+    /// @return false if the previous generation is not in the history.
+    bool stepBack();
+
+    /// Move the board to any recorded generation. Doesn't fill the
+    /// board's change set.
+    /// @return false if the generation is not in the history.
+    bool seek(uint64_t generation);
+
+    /// Generation the board is showing.
+    uint64_t getGeneration() const { return mCurrent; }
+
+    /// Earliest generation still in the history.
+    uint64_t getFirstGeneration() const { return mFrames.front().generation; }
+
+    /// Latest generation in the history.
+    uint64_t getLastGeneration() const { return mFrames.back().generation; }
+
+    /// Approximate bytes used by the history.
+    size_t getMemoryUsage() const;
+
+protected:
+    /// A recorded generation.
+    struct Frame
+    {
+        uint64_t generation; /// Generation number.
+        std::vector<uint8_t> delta; /// Cells toggled since the previous generation.
+        std::vector<uint8_t> keyframe; /// All live cells, if this is a keyframe.
+        bool isKeyframe; /// Whether keyframe holds this generation's cells.
+    };
+
+    Board* mBoard; /// Board being recorded.
+    uint64_t mKeyframeInterval; /// Generations between keyframes.
+    size_t mMemoryCap; /// Limit on mBytes, or 0 for none.
+    std::deque<Frame> mFrames; /// Recorded generations, oldest first.
+    uint64_t mCurrent; /// Generation shown on the board.
+    std::vector<ChangeSpan> mChanges; /// Changes of the last update(), if the board has no change set.
+    size_t mBytes; /// Bytes used by frames.
+
+    /// Get recorded frame for a generation, which must be in the history.
+    Frame& getFrame(uint64_t generation);
+
+    /// Bytes used by a frame.
+    static size_t getFrameBytes(const Frame& frame);
+
+    /// Toggle every cell of an encoded list on the board, and optionally
+    /// list them in the board's change set, if it has one.
+    void applyToggles(const std::vector<uint8_t>& encoded, bool noteChanges);
+
+    /// Compute the live cells of a recorded generation without touching the board.
+    void reconstruct(uint64_t generation, std::vector<CellCoord>& cells);
+
+    /// Append a frame for the next generation, which the board is showing,
+    /// given the cells toggled since the latest generation.
+    void addFrame(const std::vector<CellCoord>& toggled);
+
+    /// Thin keyframes and drop old generations until within the memory cap.
+    void enforceMemoryCap();
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef GOL_BOUNDED_QUEUE_H
+#define GOL_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stddef.h>
+
+/**
+ * A first-in first-out queue for handing work between threads, holding at
+ * most a fixed number of items. Producers block while it is full, which
+ * slows them down to the pace of the consumers.
+ */
+template <typename T>
+class BoundedQueue
+{
+protected:
+    std::deque<T> mItems; /// Items waiting, oldest first.
+    size_t mCapacity; /// Most items that may wait at once.
+    bool mClosed; /// Whether close() was called.
+    std::mutex mMutex; /// Guards all of the above.
+    std::condition_variable mNotFull; /// Signaled when an item is taken.
+    std::condition_variable mNotEmpty; /// Signaled when an item is added.
+
+public:
+    /// Constructor. A capacity of 0 is taken as 1.
+    explicit BoundedQueue(size_t capacity) :
+        mCapacity((capacity > 0) ? capacity : 1),
+        mClosed(false)
+    {
+    }
+
+    /**
+     * Add an item, waiting while the queue is full.
+     * @return false if the queue was closed, in which case item is dropped.
+     */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mClosed && (mItems.size() >= mCapacity))
+        {
+            mNotFull.wait(lock);
+        }
+        if (mClosed)
+        {
+            return false;
+        }
+        mItems.push_back(std::move(item));
+        mNotEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * Take the oldest item, waiting while the queue is empty.
+     * @return false if the queue is closed and has no more items.
+     */
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mClosed && mItems.empty())
+        {
+            mNotEmpty.wait(lock);
+        }
+        if (mItems.empty())
+        {
+            return false;
+        }
+        item = std::move(mItems.front());
+        mItems.pop_front();
+        mNotFull.notify_one();
+        return true;
+    }
+
+    /// Refuse further items and wake all waiting threads. Items already
+    /// queued can still be taken.
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mClosed = true;
+        mNotFull.notify_all();
+        mNotEmpty.notify_all();
+    }
+
+    /// Number of items waiting.
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mItems.size();
+    }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef GOL_BOUNDING_BOX_H
+#define GOL_BOUNDING_BOX_H
+
+#include "Board.h"
+
+/**
+ * Bounding box of live cells, kept up to date by an engine as cells are
+ * born and die. Births only ever widen the box. A death on its edge may
+ * shrink it, which marks the box dirty until the engine finds it again.
+ */
+struct BoundingBox
+{
+    CellIndex iMin, jMin, iMax, jMax; /// Inclusive bounds; iMin > iMax if empty.
+    bool dirty; /// Whether the bounds may be wider than the live cells.
+
+    BoundingBox()
+    {
+        reset();
+    }
+
+    /// Make the box empty.
+    void reset()
+    {
+        iMin = jMin = INT64_MAX;
+        iMax = jMax = INT64_MIN;
+        dirty = false;
+    }
+
+    /// Test whether the box holds no cells.
+    bool empty() const
+    {
+        return iMin > iMax;
+    }
+
+    /// Widen the box to hold a live cell.
+    void include(CellIndex i, CellIndex j)
+    {
+        iMin = (i < iMin) ? i : iMin;
+        iMax = (i > iMax) ? i : iMax;
+        jMin = (j < jMin) ? j : jMin;
+        jMax = (j > jMax) ? j : jMax;
+    }
+
+    /// Note that a cell died.
+    void exclude(CellIndex i, CellIndex j)
+    {
+        dirty = dirty || (i == iMin) || (i == iMax) || (j == jMin) || (j == jMax);
+    }
+
+    /// Copy bounds out. @return false if the box is empty.
+    bool get(CellIndex& iMinOut, CellIndex& jMinOut, CellIndex& iMaxOut, CellIndex& jMaxOut) const
+    {
+        iMinOut = iMin;
+        jMinOut = jMin;
+        iMaxOut = iMax;
+        jMaxOut = jMax;
+        return !empty();
+    }
+};
+
+#endif
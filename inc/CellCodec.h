@@ -0,0 +1,35 @@
+#ifndef GOL_CELL_CODEC_H
+#define GOL_CELL_CODEC_H
+
+#include "Board.h"
+#include <vector>
+
+/**
+ * Compact binary encoding of a list of cells in row-major order.
+ * Each cell is stored as the distance in rows from the previous cell,
+ * followed by its distance in columns from the previous cell, both as
+ * variable-length integers. Runs of nearby cells take a byte or two each.
+ */
+
+/// Append the encoding of cells to out. Cells must be sorted.
+void encodeCells(const std::vector<CellCoord>& cells, std::vector<uint8_t>& out);
+
+/**
+ * Decode cells written by encodeCells() and append them to cells.
+ * @return whether the data was well formed.
+ */
+bool decodeCells(const uint8_t* data, size_t size, std::vector<CellCoord>& cells);
+
+/// Collect all live cells of a board, in row-major order.
+void getLiveCells(const Board& board, std::vector<CellCoord>& cells);
+
+/**
+ * Find cells that differ between two sorted lists of live cells.
+ * @param before - cells alive before
+ * @param after - cells alive after
+ * @param toggled - receives cells alive in exactly one of the lists, sorted
+ */
+void diffCells(const std::vector<CellCoord>& before, const std::vector<CellCoord>& after,
+    std::vector<CellCoord>& toggled);
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef GOL_CENSUS_H
+#define GOL_CENSUS_H
+
+#include "Board.h"
+#include "ObjectCode.h"
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Batch search of random soups. Each soup is a square of random cells,
+ * seeded from the search seed and its index so that any soup can be
+ * reproduced on its own. It is run until what is left of it, the ash,
+ * repeats with some period; spaceships flying away are taken off the board
+ * on the way. The ash is split into connected objects, each object is named
+ * by its apgcode, and the names are counted.
+ *
+ * The stages run on their own threads, connected by bounded queues:
+ * generating soups, running them (on several threads), splitting ash into
+ * objects, naming objects, and counting names.
+ */
+class Census
+{
+public:
+    /// Settings of a search.
+    struct Options
+    {
+        uint64_t seed; /// Search seed.
+        uint64_t soups; /// Number of soups to search.
+        CellIndex soupSize; /// Side of the square of random cells.
+        int density; /// Percentage of soup cells alive.
+        uint64_t maxGenerations; /// Generations after which a soup is given up.
+        int runThreads; /// Threads running soups.
+
+        /// Makes the boards that soups are run on; must be unbounded.
+        std::function<Board*()> createBoard;
+
+        Options();
+    };
+
+    /// Name counted for soups that don't settle within maxGenerations.
+    static const char* const UNSETTLED;
+
+    /// Longest ash period looked for.
+    static const int MAX_PERIOD = 60;
+
+    /// Longest spaceship period looked for.
+    static const int MAX_SHIP_PERIOD = 4;
+
+    /// Generations between looks for spaceships leaving the ash.
+    static const int SHIP_CHECK_INTERVAL = 32;
+
+    /// Gap between a spaceship and each other object, in cells, beyond
+    /// which the spaceship is taken to have escaped if it isn't closing in.
+    static const CellIndex SHIP_ESCAPE_GAP = 32;
+
+    /// Number of stages in the pipeline.
+    static const int STAGES = 5;
+
+    /// Timing of one stage.
+    struct StageStats
+    {
+        const char* name; /// Stage name.
+        int threads; /// Threads running the stage.
+        uint64_t items; /// Items processed.
+        double busySeconds; /// Time spent processing, summed over threads.
+    };
+
+protected:
+    /// A soup waiting to be run.
+    struct Soup
+    {
+        uint64_t index; /// Soup number within the search.
+        std::vector<CellCoord> cells; /// Live cells, sorted.
+    };
+
+    /// What is left of a soup once it repeats.
+    struct Ash
+    {
+        bool settled; /// Whether the soup settled within maxGenerations.
+        ObjectPhases phases; /// Cells over one period of the ash.
+        std::vector<ObjectPhases> ships; /// Spaceships that escaped.
+    };
+
+    /// An object to be named.
+    struct Object
+    {
+        bool moving; /// Whether it is a spaceship.
+        ObjectPhases phases; /// Cells over one period.
+    };
+
+    /// How an object behaves when run on its own.
+    struct Motion
+    {
+        int period; /// Generations until it comes back to its shape, or 0 if not within MAX_SHIP_PERIOD.
+        CellIndex di, dj; /// Rows and columns it moves each period.
+        ObjectPhases phases; /// Cells over one period, with the first phase's box at (0, 0).
+
+        /// Test whether the object is a spaceship.
+        bool isShip() const { return (period > 0) && ((di != 0) || (dj != 0)); }
+    };
+
+    /// Motions of objects found so far, by shape with its box at (0, 0).
+    typedef std::map<std::vector<CellCoord>, Motion> MotionCache;
+
+    Options mOptions; /// Settings of the search.
+    std::map<std::string, uint64_t> mCounts; /// Number of each object found.
+    StageStats mStages[STAGES]; /// Timing of each stage.
+    std::mutex mStatsMutex; /// Guards mStages.
+    double mSeconds; /// Wall time of the last run().
+
+    /// Add processing time to a stage.
+    void addStageTime(int stage, uint64_t items, double seconds);
+
+    /// Make the random cells of a soup.
+    void generateSoup(uint64_t index, Soup& soup) const;
+
+    /// Run a soup until its ash repeats.
+    void runSoup(const Soup& soup, Ash& ash) const;
+
+    /// Find how an object moves, running it on its own for up to
+    /// MAX_SHIP_PERIOD generations unless its shape is in the cache.
+    const Motion& findMotion(const std::vector<CellCoord>& cells, MotionCache& cache) const;
+
+    /// Take spaceships that are flying away from the rest of the board off it.
+    void removeShips(Board& board, MotionCache& motions, std::vector<ObjectPhases>& ships) const;
+
+    /// Test whether cells over a period, taken from the ash, go through
+    /// the same phases when run on their own.
+    bool evolvesAlone(const ObjectPhases& phases) const;
+
+    /// Split ash into objects, each with the phases of its own period.
+    void splitAsh(const Ash& ash, std::vector<Object>& objects) const;
+
+public:
+    /// Constructor.
+    explicit Census(const Options& options);
+
+    /// Search all soups, adding to the counts.
+    void run();
+
+    /// Number of each object found, keyed by apgcode.
+    const std::map<std::string, uint64_t>& getCounts() const { return mCounts; }
+
+    /// Write counts, most common first.
+    void writeCounts(std::ostream& out) const;
+
+    /// Write soups per second and the timing of each stage.
+    void writeStats(std::ostream& out) const;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef GOL_CHECKPOINTER_H
+#define GOL_CHECKPOINTER_H
+
+#include "Board.h"
+#include "BoundedQueue.h"
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class UringWriter;
+
+/**
+ * Writes checkpoints of boards without holding up the simulation.
+ * checkpoint() only takes a snapshot of the board and queues it; a worker
+ * thread serializes the snapshot and writes the file, through io_uring
+ * where the system supports it and with plain writes otherwise.
+ *
+ * If checkpoints are taken faster than they can be written, checkpoint()
+ * waits for room once a few are queued, rather than piling up snapshots.
+ */
+class Checkpointer
+{
+public:
+    /// Turns a board into the bytes of a file.
+    typedef std::function<void(const Board&, std::vector<uint8_t>&)> Serializer;
+
+    /// Serialize in the text format of Board::writeBoard().
+    static void serializeText(const Board& board, std::vector<uint8_t>& out);
+
+    /// Serialize as a small header followed by the cells in the encoding of
+    /// encodeCells(), typically a byte or two per live cell.
+    static void serializeBinary(const Board& board, std::vector<uint8_t>& out);
+
+    /**
+     * Load a file written by serializeBinary() or in the text format of
+     * writeBoard() into a board, telling them apart by the header.
+     * @return whether the file could be read.
+     */
+    static bool loadCheckpoint(Board& board, const std::string& fileName);
+
+protected:
+    /// A checkpoint waiting to be written.
+    struct Job
+    {
+        std::shared_ptr<const Board> board; /// Snapshot to write.
+        std::string fileName; /// File to write it to.
+        Serializer serializer; /// Format to write it in.
+    };
+
+    BoundedQueue<Job> mQueue; /// Checkpoints waiting for the worker.
+    std::thread mThread; /// Worker serializing and writing checkpoints.
+    std::mutex mMutex; /// Guards the members below.
+    UringWriter* mUring; /// io_uring writer, or null if unavailable.
+    std::condition_variable mFinished; /// Signaled when a checkpoint is done.
+    uint64_t mQueued; /// Checkpoints queued so far.
+    uint64_t mWritten; /// Checkpoints written so far.
+    uint64_t mFailed; /// Checkpoints that couldn't be written.
+    uint64_t mBytes; /// Bytes written so far.
+    double mStallSeconds; /// Time checkpoint() spent waiting for room.
+
+    /// Worker loop: take checkpoints off the queue until it is closed.
+    void run();
+
+    /// Write data to a file, replacing it. @return whether it worked.
+    bool writeFile(const std::string& fileName, const std::vector<uint8_t>& data);
+
+public:
+    /// Constructor, starting the worker thread.
+    /// @param maxQueued - checkpoints that may wait before checkpoint() blocks
+    explicit Checkpointer(size_t maxQueued = 2);
+
+    /// Destructor. Writes all queued checkpoints before returning.
+    ~Checkpointer();
+
+    /**
+     * Queue a checkpoint of the board as it is now. Must be called from the
+     * thread that updates the board, which may go on updating it as soon
+     * as this returns.
+     * @return false if the checkpointer is shutting down.
+     */
+    bool checkpoint(const Board& board, const std::string& fileName,
+        const Serializer& serializer = serializeText);
+
+    /// Wait until all queued checkpoints are written.
+    void flush();
+
+    bool usesUring(); /// Test whether writes go through io_uring.
+    uint64_t getWritten(); /// Checkpoints written so far.
+    uint64_t getFailed(); /// Checkpoints that couldn't be written.
+    uint64_t getBytes(); /// Bytes written so far.
+    double getStallSeconds(); /// Time checkpoint() spent waiting for room.
+};
+
+#endif
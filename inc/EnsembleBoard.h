@@ -0,0 +1,315 @@
+#ifndef GOL_ENSEMBLE_BOARD_H
+#define GOL_ENSEMBLE_BOARD_H
+
+#include "BitLife.h"
+#include "Board.h"
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+#include <vector>
+
+// The wider words are only defined when compiled for registers that hold
+// them; otherwise GCC splits them up and warns about their calling
+// convention (-Wpsabi), and they gain nothing over uint64_t.
+#if defined(__GNUC__) && defined(__AVX2__)
+/// Word of 256 lanes, in AVX2 registers.
+typedef uint64_t EnsembleWord256 __attribute__((vector_size(32)));
+#define GOL_HAVE_ENSEMBLE_WORD256
+#endif
+
+#if defined(__GNUC__) && defined(__AVX512F__)
+/// Word of 512 lanes, in AVX-512 registers.
+typedef uint64_t EnsembleWord512 __attribute__((vector_size(64)));
+#define GOL_HAVE_ENSEMBLE_WORD512
+#endif
+
+/**
+ * Many independent boards of the same size, run in lockstep. Bit k of the
+ * word for cell (i, j) holds that cell on board k, its lane, so that one
+ * bitwise update advances every board at once: 64 of them with uint64_t
+ * words, or 256 or 512 with the SIMD word types above where they exist.
+ *
+ * Every board covers rows [0, rows) and columns [0, columns); cells outside
+ * are dead, as on BasicBoard. This is meant for many small boards, such as
+ * soups in a search, and does not implement the Board API itself; boards
+ * go in and out through seedLane() and extractLane().
+ */
+template <typename Word>
+class EnsembleBoard
+{
+public:
+    /// Number of boards run together.
+    static const int LANES = sizeof(Word) * 8;
+
+protected:
+    /// Number of 64-bit words in a Word.
+    static const size_t WORDS_PER_CELL = sizeof(Word) / sizeof(uint64_t);
+
+    CellIndex mRows; /// Number of rows on each board.
+    CellIndex mColumns; /// Number of columns on each board.
+
+    /// Cells per stored row, including a dead cell past each end so that
+    /// update() needs no bounds checks. There is a dead row above and below
+    /// too.
+    size_t mStride;
+
+    /// Cells, row after row, WORDS_PER_CELL words each. Kept as plain words
+    /// and copied in and out of Word, so that the storage needs no more
+    /// than the usual alignment.
+    std::vector<uint64_t> mCells;
+
+    /// Scratch space for the next generation.
+    std::vector<uint64_t> mNextCells;
+
+    /// Lanes in which any cell changed in the last update. Kept as plain
+    /// words for the same reason.
+    uint64_t mChanged[WORDS_PER_CELL];
+
+    /// Get offset of the words of cell (i, j).
+    size_t getOffset(CellIndex i, CellIndex j) const
+    {
+        return ((i + 1) * mStride + (j + 1)) * WORDS_PER_CELL;
+    }
+
+    /// Test whether (i, j) is on the boards.
+    bool contains(CellIndex i, CellIndex j) const
+    {
+        return (i >= 0) && (j >= 0) && (i < mRows) && (j < mColumns);
+    }
+
+    static Word load(const uint64_t* words)
+    {
+        Word word;
+        memcpy(&word, words, sizeof(Word));
+        return word;
+    }
+
+    static void store(uint64_t* words, const Word& word)
+    {
+        memcpy(words, &word, sizeof(Word));
+    }
+
+public:
+    /// Constructor for boards of the given size, all dead.
+    EnsembleBoard(CellIndex rows, CellIndex columns)
+    {
+        mRows = (rows > 0) ? rows : 0;
+        mColumns = (columns > 0) ? columns : 0;
+        mStride = static_cast<size_t>(mColumns + 2);
+        mCells.assign((mRows + 2) * mStride * WORDS_PER_CELL, 0);
+        mNextCells.assign(mCells.size(), 0);
+        memset(mChanged, 0, sizeof(mChanged));
+    }
+
+    CellIndex getRows() const { return mRows; }
+    CellIndex getColumns() const { return mColumns; }
+
+    /// Word with no lanes set.
+    static Word noLanes()
+    {
+        uint64_t words[WORDS_PER_CELL] = { 0 };
+        return load(words);
+    }
+
+    /// Test whether a lane is set in a word of lanes.
+    static bool testLane(const Word& lanes, int lane)
+    {
+        uint64_t words[WORDS_PER_CELL];
+        store(words, lanes);
+        return ((words[lane / 64] >> (lane % 64)) & 1) != 0;
+    }
+
+    /// Test whether any lane is set in a word of lanes.
+    static bool anyLane(const Word& lanes)
+    {
+        uint64_t words[WORDS_PER_CELL];
+        store(words, lanes);
+        uint64_t any = 0;
+        for (size_t w = 0; w < WORDS_PER_CELL; w++)
+        {
+            any |= words[w];
+        }
+        return any != 0;
+    }
+
+    /// Returns whether cell (i, j) is alive on the board in a lane.
+    bool getCell(int lane, CellIndex i, CellIndex j) const
+    {
+        assert((lane >= 0) && (lane < LANES));
+        if (!contains(i, j))
+        {
+            return false;
+        }
+        return ((mCells[getOffset(i, j) + lane / 64] >> (lane % 64)) & 1) != 0;
+    }
+
+    /// Sets whether cell (i, j) is alive on the board in a lane.
+    /// Does nothing if (i, j) is outside the boards.
+    void setCell(int lane, CellIndex i, CellIndex j, bool alive)
+    {
+        assert((lane >= 0) && (lane < LANES));
+        if (contains(i, j))
+        {
+            uint64_t& word = mCells[getOffset(i, j) + lane / 64];
+            uint64_t bit = uint64_t(1) << (lane % 64);
+            word = alive ? (word | bit) : (word & ~bit);
+        }
+    }
+
+    /// Kill every cell of every board.
+    void clear()
+    {
+        std::fill(mCells.begin(), mCells.end(), 0);
+    }
+
+    /// Kill every cell of the board in a lane.
+    void clearLane(int lane)
+    {
+        assert((lane >= 0) && (lane < LANES));
+        uint64_t mask = ~(uint64_t(1) << (lane % 64));
+        for (size_t w = lane / 64; w < mCells.size(); w += WORDS_PER_CELL)
+        {
+            mCells[w] &= mask;
+        }
+    }
+
+    /**
+     * Copy live cells of a board into a lane, which is cleared first.
+     * Cell (i, j) of the board lands on (i - iOffset, j - jOffset); cells
+     * that land outside the lane are dropped.
+     */
+    void seedLane(int lane, const Board& board, CellIndex iOffset = 0, CellIndex jOffset = 0)
+    {
+        clearLane(lane);
+        CellIndex i, j;
+        if (board.getFirstLiveCell(i, j))
+        {
+            do
+            {
+                setCell(lane, i - iOffset, j - jOffset, true);
+            } while (board.getNextLiveCell(i, j));
+        }
+    }
+
+    /// Bring to life on a board the live cells of a lane, cell (i, j)
+    /// landing on (i + iOffset, j + jOffset).
+    void extractLane(int lane, Board& board, CellIndex iOffset = 0, CellIndex jOffset = 0) const
+    {
+        assert((lane >= 0) && (lane < LANES));
+        std::vector<CellCoord> cells;
+        for (CellIndex i = 0; i < mRows; i++)
+        {
+            for (CellIndex j = 0; j < mColumns; j++)
+            {
+                if ((mCells[getOffset(i, j) + lane / 64] >> (lane % 64)) & 1)
+                {
+                    cells.push_back(CellCoord(i + iOffset, j + jOffset));
+                }
+            }
+        }
+        board.setCells(cells.data(), cells.size());
+    }
+
+    /**
+     * Fill rows iMin to iMax and columns jMin to jMax, inclusive, of every
+     * lane with random cells, each alive with probability 1/2.
+     * @param random - generator of uniform 64-bit words, e.g. std::mt19937_64
+     */
+    template <typename Random>
+    void randomize(Random& random, CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax)
+    {
+        for (CellIndex i = (iMin > 0) ? iMin : 0; (i <= iMax) && (i < mRows); i++)
+        {
+            for (CellIndex j = (jMin > 0) ? jMin : 0; (j <= jMax) && (j < mColumns); j++)
+            {
+                uint64_t* words = &mCells[getOffset(i, j)];
+                for (size_t w = 0; w < WORDS_PER_CELL; w++)
+                {
+                    words[w] = random();
+                }
+            }
+        }
+    }
+
+    /// Update every board to its next state.
+    void update()
+    {
+        Word changed = noLanes();
+        const size_t up = mStride * WORDS_PER_CELL;
+        for (CellIndex i = 0; i < mRows; i++)
+        {
+            const uint64_t* cell = &mCells[getOffset(i, 0)];
+            uint64_t* out = &mNextCells[getOffset(i, 0)];
+            for (CellIndex j = 0; j < mColumns; j++)
+            {
+                Word nbrs[8] = {
+                    load(cell - up - WORDS_PER_CELL), load(cell - up), load(cell - up + WORDS_PER_CELL),
+                    load(cell - WORDS_PER_CELL), load(cell + WORDS_PER_CELL),
+                    load(cell + up - WORDS_PER_CELL), load(cell + up), load(cell + up + WORDS_PER_CELL)
+                };
+                Word self = load(cell);
+                Word next = lifeRule(nbrs, self);
+                changed = changed | (next ^ self);
+                store(out, next);
+                cell += WORDS_PER_CELL;
+                out += WORDS_PER_CELL;
+            }
+        }
+        mCells.swap(mNextCells);
+        store(mChanged, changed);
+    }
+
+    /// Lanes in which any cell changed in the last update, i.e. whose
+    /// boards are not yet still lifes.
+    Word getChangedLanes() const
+    {
+        return load(mChanged);
+    }
+
+    /// Lanes with any live cell.
+    Word getLiveLanes() const
+    {
+        Word live = noLanes();
+        for (size_t c = 0; c < mCells.size(); c += WORDS_PER_CELL)
+        {
+            live = live | load(&mCells[c]);
+        }
+        return live;
+    }
+
+    /// Number of live cells on the board in a lane.
+    int64_t getPopulation(int lane) const
+    {
+        assert((lane >= 0) && (lane < LANES));
+        int64_t count = 0;
+        for (size_t w = lane / 64; w < mCells.size(); w += WORDS_PER_CELL)
+        {
+            count += (mCells[w] >> (lane % 64)) & 1;
+        }
+        return count;
+    }
+
+    /// Get number of live cells on every board, indexed by lane.
+    void getPopulations(std::vector<int64_t>& populations) const
+    {
+        populations.assign(LANES, 0);
+        for (size_t c = 0; c < mCells.size(); c += WORDS_PER_CELL)
+        {
+            for (size_t w = 0; w < WORDS_PER_CELL; w++)
+            {
+                for (uint64_t bits = mCells[c + w]; bits != 0; bits &= bits - 1)
+                {
+                    populations[w * 64 + countTrailingZeros(bits)]++;
+                }
+            }
+        }
+    }
+
+    /// Approximate bytes of memory used by the boards.
+    size_t getMemoryUsage() const
+    {
+        return sizeof(*this) + (mCells.capacity() + mNextCells.capacity()) * sizeof(uint64_t);
+    }
+};
+
+#endif
@@ -0,0 +1,475 @@
+#ifndef GOL_FIXED_BOARD_H
+#define GOL_FIXED_BOARD_H
+
+#include "BitLife.h"
+#include "Board.h"
+#include "BoundingBox.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <memory>
+
+/**
+ * Cells of a dense board whose size is fixed at compile time, and
+ * everything that only reads them; shared by FixedBoard and its snapshots.
+ * Cells are packed 64 to a word as on PackedBoard, held inline in the
+ * object in one of a number of buffers.
+ */
+template <CellIndex Rows, CellIndex Cols, int Buffers>
+class FixedBoardBase : public Board
+{
+    static_assert((Rows > 0) && (Cols > 0), "FixedBoard needs at least one cell");
+
+public:
+    /// Number of words holding a row.
+    static const size_t WORDS_PER_ROW = static_cast<size_t>((Cols + BITS_PER_WORD - 1) / BITS_PER_WORD);
+
+protected:
+    /// Number of words in a buffer: the rows, with a dead row above the top
+    /// one and below the bottom one so that update() needs no special
+    /// cases for them.
+    static const size_t BUFFER_WORDS = (Rows + 2) * WORDS_PER_ROW;
+
+    /// Buffers of cells, one after the other.
+    std::array<uint64_t, Buffers * BUFFER_WORDS> mBuffers;
+    int mCurrent; /// Buffer holding the current generation.
+    int64_t mPopulation; /// Number of live cells.
+    mutable BoundingBox mBox; /// Bounding box of live cells.
+
+    /// Get pointer to the words of a buffer.
+    uint64_t* getBuffer(int buffer)
+    {
+        return &mBuffers[buffer * BUFFER_WORDS];
+    }
+
+    const uint64_t* getBuffer(int buffer) const
+    {
+        return &mBuffers[buffer * BUFFER_WORDS];
+    }
+
+    /// Get pointer to the words of row i.
+    uint64_t* getRow(CellIndex i)
+    {
+        return getBuffer(mCurrent) + (i + 1) * WORDS_PER_ROW;
+    }
+
+    const uint64_t* getRow(CellIndex i) const
+    {
+        return getBuffer(mCurrent) + (i + 1) * WORDS_PER_ROW;
+    }
+
+    /// Test whether (i, j) is on the board.
+    static bool contains(CellIndex i, CellIndex j)
+    {
+        return (i >= 0) && (j >= 0) && (i < Rows) && (j < Cols);
+    }
+
+    /// Widen mBox to hold the live cells of row i, and count them.
+    int64_t includeRow(CellIndex i, const uint64_t* row) const
+    {
+        int64_t count = 0;
+        size_t first = WORDS_PER_ROW, last = 0;
+        for (size_t w = 0; w < WORDS_PER_ROW; w++)
+        {
+            if (row[w] != 0)
+            {
+                count += popCount(row[w]);
+                first = (first < w) ? first : w;
+                last = w;
+            }
+        }
+
+        if (count > 0)
+        {
+            mBox.include(i, first * BITS_PER_WORD + countTrailingZeros(row[first]));
+            mBox.include(i, last * BITS_PER_WORD + highestBit(row[last]));
+        }
+        return count;
+    }
+
+    /// Find live cell at or after row i, word w, bit b.
+    bool findLiveCell(CellIndex i, size_t w, int b, CellIndex& iOut, CellIndex& jOut) const
+    {
+        for (; i < Rows; i++)
+        {
+            const uint64_t* row = getRow(i);
+            for (; w < WORDS_PER_ROW; w++)
+            {
+                uint64_t word = (b < BITS_PER_WORD) ? (row[w] >> b) << b : 0;
+                if (word != 0)
+                {
+                    iOut = i;
+                    jOut = w * BITS_PER_WORD + countTrailingZeros(word);
+                    return true;
+                }
+                b = 0;
+            }
+            w = 0;
+        }
+        return false;
+    }
+
+    /// Constructor for an empty board.
+    FixedBoardBase()
+    {
+        mBuffers.fill(0);
+        mCurrent = 0;
+        mPopulation = 0;
+    }
+
+public:
+    static CellIndex getRows() { return Rows; }
+    static CellIndex getColumns() { return Cols; }
+
+    bool getCell(CellIndex i, CellIndex j) const
+    {
+        if (contains(i, j))
+        {
+            return ((getRow(i)[j / BITS_PER_WORD] >> (j % BITS_PER_WORD)) & 1) != 0;
+        }
+        return false;
+    }
+
+    /// Copies 64 cells at a time, as PackedBoard does.
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
+    {
+        // round width up to nearest 8 (bits)
+        if (width % 8 != 0)
+        {
+            width += 8 - (width % 8);
+        }
+        int bw = width / 8;
+
+        int8_t* bitmap = new int8_t[height * bw];
+        memset(bitmap, 0, height * bw * sizeof(int8_t));
+        for (int iCount = 0; iCount < height; iCount++)
+        {
+            CellIndex i = iOffset + iCount;
+            if ((i < 0) || (i >= Rows))
+            {
+                continue;
+            }
+
+            int8_t* out = &bitmap[iCount * bw];
+            for (int byteCount = 0; byteCount < bw; byteCount += 8)
+            {
+                uint64_t bits = extractBits(getRow(i), WORDS_PER_ROW, jOffset + 8 * byteCount);
+                for (int b = 0; (b < 8) && (byteCount + b < bw); b++)
+                {
+                    out[byteCount + b] = static_cast<int8_t>((bits >> (8 * b)) & 0xff);
+                }
+            }
+        }
+        return bitmap;
+    }
+
+    bool getFirstLiveCell(CellIndex& i, CellIndex& j) const
+    {
+        return findLiveCell(0, 0, 0, i, j);
+    }
+
+    bool getNextLiveCell(CellIndex& i, CellIndex& j) const
+    {
+        CellIndex c = j + 1;
+        return findLiveCell(i, static_cast<size_t>(c / BITS_PER_WORD),
+            static_cast<int>(c % BITS_PER_WORD), i, j);
+    }
+
+    int64_t getPopulation() const
+    {
+        return mPopulation;
+    }
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+    {
+        if (mBox.dirty)
+        {
+            mBox.reset();
+            for (CellIndex i = 0; i < Rows; i++)
+            {
+                includeRow(i, getRow(i));
+            }
+        }
+        return mBox.get(iMin, jMin, iMax, jMax);
+    }
+
+    bool getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+    {
+        iMin = 0;
+        jMin = 0;
+        iMax = Rows - 1;
+        jMax = Cols - 1;
+        return true;
+    }
+
+    /// Counts 64 cells at a time.
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+    {
+        CellIndex i0 = (iMin > 0) ? iMin : 0;
+        CellIndex i1 = (iMax < Rows - 1) ? iMax : Rows - 1;
+        CellIndex j0 = (jMin > 0) ? jMin : 0;
+        CellIndex j1 = (jMax < Cols - 1) ? jMax : Cols - 1;
+        if ((i0 > i1) || (j0 > j1))
+        {
+            return 0;
+        }
+
+        size_t w0 = static_cast<size_t>(j0 / BITS_PER_WORD);
+        size_t w1 = static_cast<size_t>(j1 / BITS_PER_WORD);
+        int64_t count = 0;
+        for (CellIndex i = i0; i <= i1; i++)
+        {
+            const uint64_t* row = getRow(i);
+            for (size_t w = w0; w <= w1; w++)
+            {
+                int first = (w == w0) ? static_cast<int>(j0 % BITS_PER_WORD) : 0;
+                int last = (w == w1) ? static_cast<int>(j1 % BITS_PER_WORD) : BITS_PER_WORD - 1;
+                count += popCount(row[w] & bitRange(first, last));
+            }
+        }
+        return count;
+    }
+
+    /// Every buffer is held inline, so this is the size of the object.
+    size_t getMemoryUsage() const
+    {
+        return sizeof(*this);
+    }
+
+    /// update() allocates nothing.
+    size_t estimateUpdateMemory() const
+    {
+        return sizeof(*this);
+    }
+};
+
+template <CellIndex Rows, CellIndex Cols>
+class FixedBoard;
+
+/**
+ * Snapshot of a FixedBoard: a copy of its current cells alone, without the
+ * scratch buffer or anything else of the board's, such as its change set.
+ * The functions that would change the board do nothing, as on FrozenBoard.
+ */
+template <CellIndex Rows, CellIndex Cols>
+class FrozenFixedBoard final : public FixedBoardBase<Rows, Cols, 1>
+{
+public:
+    /// Constructor copying the current cells of a board.
+    explicit FrozenFixedBoard(const FixedBoard<Rows, Cols>& board)
+    {
+        std::memcpy(this->getBuffer(0), board.getBuffer(board.mCurrent), sizeof(this->mBuffers));
+        this->mPopulation = board.mPopulation;
+        this->mBox = board.mBox;
+    }
+
+    void setCell(CellIndex, CellIndex, bool)
+    {
+    }
+
+    void setCells(const CellCoord*, size_t)
+    {
+    }
+
+    void clearBoard()
+    {
+    }
+
+    void update()
+    {
+        if (this->mChangeSet)
+        {
+            this->mChangeSet->clear();
+        }
+    }
+};
+
+/**
+ * A dense board whose size is fixed at compile time, for small bounded
+ * boards such as 32x32 to 256x256. Cells are packed 64 to a word as on
+ * PackedBoard, but held inline in the object rather than on the heap, and
+ * every loop bound is a constant, so that the compiler can unroll update()
+ * and drop the bounds checks that don't depend on the cell asked for.
+ *
+ * Both generations live in one array, and update() flips which of them is
+ * current rather than moving any words.
+ *
+ * It covers rows [0, Rows) and columns [0, Cols), like BasicBoard. The
+ * class is final, so calls through a FixedBoard itself rather than a Board
+ * are not virtual and can be inlined into hot loops.
+ */
+template <CellIndex Rows, CellIndex Cols>
+class FixedBoard final : public FixedBoardBase<Rows, Cols, 2>
+{
+    typedef FixedBoardBase<Rows, Cols, 2> Base;
+    friend class FrozenFixedBoard<Rows, Cols>;
+
+    using Base::WORDS_PER_ROW;
+    using Base::mCurrent;
+    using Base::mPopulation;
+    using Base::mBox;
+    using Base::mChangeSet;
+    using Base::mInstrumentation;
+
+protected:
+    /// Mask of the bits of the last word of a row that hold cells.
+    static const uint64_t LAST_WORD_MASK = (Cols % BITS_PER_WORD == 0) ?
+        ~uint64_t(0) : ((uint64_t(1) << (Cols % BITS_PER_WORD)) - 1);
+
+    /// Compute the next state of a row. The word count is a constant, so
+    /// this unrolls, and a row of one word needs no neighboring words.
+    static void updateRow(const uint64_t* above, const uint64_t* row, const uint64_t* below, uint64_t* out)
+    {
+        for (size_t w = 0; w < WORDS_PER_ROW; w++)
+        {
+            uint64_t aPrev = 0, cPrev = 0, bPrev = 0;
+            uint64_t aNext = 0, cNext = 0, bNext = 0;
+            if (w > 0)
+            {
+                aPrev = above[w - 1];
+                cPrev = row[w - 1];
+                bPrev = below[w - 1];
+            }
+            if (w + 1 < WORDS_PER_ROW)
+            {
+                aNext = above[w + 1];
+                cNext = row[w + 1];
+                bNext = below[w + 1];
+            }
+
+            uint64_t a = above[w], c = row[w], b = below[w];
+            uint64_t nbrs[8] = {
+                westNeighbors(a, aPrev), a, eastNeighbors(a, aNext),
+                westNeighbors(c, cPrev), eastNeighbors(c, cNext),
+                westNeighbors(b, bPrev), b, eastNeighbors(b, bNext)
+            };
+            out[w] = lifeRule(nbrs, c);
+        }
+        out[WORDS_PER_ROW - 1] &= LAST_WORD_MASK;
+    }
+
+public:
+    /// Constructor for an empty board.
+    FixedBoard()
+    {
+    }
+
+    void setCell(CellIndex i, CellIndex j, bool alive)
+    {
+        if (Base::contains(i, j))
+        {
+            uint64_t& word = this->getRow(i)[j / BITS_PER_WORD];
+            uint64_t bit = uint64_t(1) << (j % BITS_PER_WORD);
+            if (alive && !(word & bit))
+            {
+                word |= bit;
+                mPopulation++;
+                mBox.include(i, j);
+            }
+            else if (!alive && (word & bit))
+            {
+                word &= ~bit;
+                mPopulation--;
+                mBox.exclude(i, j);
+            }
+        }
+    }
+
+    /// ORs cells straight into their words.
+    void setCells(const CellCoord* cells, size_t count)
+    {
+        for (size_t c = 0; c < count; c++)
+        {
+            CellIndex i = cells[c].first;
+            CellIndex j = cells[c].second;
+            if (Base::contains(i, j))
+            {
+                uint64_t& word = this->getRow(i)[j / BITS_PER_WORD];
+                uint64_t bit = uint64_t(1) << (j % BITS_PER_WORD);
+                mPopulation += ((word & bit) == 0);
+                word |= bit;
+                mBox.include(i, j);
+            }
+        }
+    }
+
+    void clearBoard()
+    {
+        std::fill(this->getBuffer(mCurrent), this->getBuffer(mCurrent) + Base::BUFFER_WORDS, 0);
+        mPopulation = 0;
+        mBox.reset();
+    }
+
+    void update()
+    {
+        // As on PackedBoard, counting and updating are one pass, timed as
+        // neighbor counting.
+        Instrumentation* instrumentation = mInstrumentation;
+        if (instrumentation)
+        {
+            instrumentation->beginGeneration();
+            instrumentation->beginPhase(PHASE_NEIGHBOR_COUNT);
+        }
+
+        if (mChangeSet)
+        {
+            mChangeSet->clear();
+        }
+
+        mPopulation = 0;
+        mBox.reset();
+        uint64_t* next = this->getBuffer(1 - mCurrent);
+        for (CellIndex i = 0; i < Rows; i++)
+        {
+            uint64_t* out = next + (i + 1) * WORDS_PER_ROW;
+            updateRow(this->getRow(i - 1), this->getRow(i), this->getRow(i + 1), out);
+            mPopulation += this->includeRow(i, out);
+            if (mChangeSet)
+            {
+                const uint64_t* row = this->getRow(i);
+                for (size_t w = 0; w < WORDS_PER_ROW; w++)
+                {
+                    if (row[w] != out[w])
+                    {
+                        ChangeSpan span = { i, static_cast<CellIndex>(w * BITS_PER_WORD), row[w] ^ out[w] };
+                        mChangeSet->push_back(span);
+                    }
+                }
+            }
+        }
+
+        if (instrumentation)
+        {
+            instrumentation->endPhase(PHASE_NEIGHBOR_COUNT);
+            const uint64_t* now = this->getBuffer(mCurrent);
+            int64_t births = 0, deaths = 0;
+            for (size_t w = 0; w < Base::BUFFER_WORDS; w++)
+            {
+                births += popCount(next[w] & ~now[w]);
+                deaths += popCount(now[w] & ~next[w]);
+            }
+            instrumentation->countBirths(births);
+            instrumentation->countDeaths(deaths);
+        }
+
+        // The border rows of both buffers stay dead, so flipping is enough.
+        mCurrent = 1 - mCurrent;
+        if (instrumentation)
+        {
+            instrumentation->endGeneration(mPopulation);
+        }
+    }
+
+    /// Copies the current cells alone into a FrozenFixedBoard, which is
+    /// half the size of the board.
+    std::shared_ptr<const Board> snapshot() const
+    {
+        // Find the bounding box first, so that the snapshot never has to.
+        CellIndex iMin, jMin, iMax, jMax;
+        this->getBoundingBox(iMin, jMin, iMax, jMax);
+        return std::make_shared<FrozenFixedBoard<Rows, Cols> >(*this);
+    }
+};
+
+#endif
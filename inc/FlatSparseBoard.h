@@ -0,0 +1,120 @@
+#ifndef GOL_FLAT_SPARSE_BOARD_H
+#define GOL_FLAT_SPARSE_BOARD_H
+
+#include "Board.h"
+#include "BoundingBox.h"
+#include <vector>
+
+/**
+ * A sparse implementation of the Board API that, like SparseBoard, accepts
+ * coordinates anywhere in the signed 64-bit range and updates row by row
+ * from each row and its two neighbors. Instead of trees, the live cells are
+ * kept in flat arrays: the indices of non-empty rows, sorted, and the
+ * sorted columns of each row, one row after another in a single vector.
+ *
+ * update() builds each new row by a linear merge of the three rows around
+ * it into arrays kept from the last update, so that once those have grown
+ * to size there is no allocation at all, and memory is read and written in
+ * order.
+ *
+ * Inserting single cells with setCell() moves every cell after them, so
+ * load boards with setCells().
+ */
+class FlatSparseBoard : public Board
+{
+protected:
+    /// Cells of a board, rows in order.
+    struct Cells
+    {
+        std::vector<CellIndex> rows; /// Indices of non-empty rows, ascending.
+
+        /// Where the columns of each row start in columns, plus the total
+        /// number of columns at the end.
+        std::vector<size_t> rowStarts;
+
+        std::vector<CellIndex> columns; /// Columns of each row, ascending.
+
+        /// Make the board empty, keeping memory for reuse.
+        void clear();
+
+        /// Bytes allocated by the arrays.
+        size_t getMemoryUsage() const;
+    };
+
+    /// Live cells in a column of three rows, as merged by update().
+    struct ColumnSum
+    {
+        CellIndex column; /// Column index.
+        int count; /// Live cells in this column of the three rows.
+        bool alive; /// Whether the cell in the middle row is alive.
+    };
+
+    Cells mCells; /// Live cells.
+    Cells mNextCells; /// Scratch space for the next generation.
+    std::vector<ColumnSum> mSums; /// Scratch space for merging three rows.
+    mutable BoundingBox mBox; /// Bounding box of live cells.
+
+    /// Find the position of row i in mCells.rows, or of the first row after it.
+    size_t findRow(CellIndex i) const;
+
+    /// Test whether position r of mCells.rows holds row i.
+    bool isRow(size_t r, CellIndex i) const
+    {
+        return (r < mCells.rows.size()) && (mCells.rows[r] == i);
+    }
+
+    /// Get pointers to the first and past-the-last columns of row position r.
+    const CellIndex* beginRow(size_t r) const { return mCells.columns.data() + mCells.rowStarts[r]; }
+    const CellIndex* endRow(size_t r) const { return mCells.columns.data() + mCells.rowStarts[r + 1]; }
+
+    /**
+     * Compute the next state of row i from it and the rows above and below,
+     * appending live columns to mNextCells.columns.
+     * @param above, row, below - row positions in mCells, or -1 for empty rows
+     * @return number of live cells of the row that stay alive.
+     */
+    int64_t updateRow(CellIndex i, ptrdiff_t above, ptrdiff_t row, ptrdiff_t below);
+
+    /// Find the bounding box again from the rows.
+    void findBoundingBox() const;
+
+public:
+    FlatSparseBoard();
+
+    bool getCell(CellIndex i, CellIndex j) const;
+
+    void setCell(CellIndex i, CellIndex j, bool alive);
+
+    /// Sorts the cells, then merges them with the live cells in one pass.
+    void setCells(const CellCoord* cells, size_t count);
+
+    void clearBoard();
+
+    void update();
+
+    int64_t getPopulation() const;
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    /// Binary searches each row in range.
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+    size_t getMemoryUsage() const;
+
+    /// Assumes the next generation takes about as much room as this one.
+    size_t estimateUpdateMemory() const;
+
+    /// Releases the scratch arrays used by update().
+    size_t compact();
+
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
+
+    bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
+
+    bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+    /// Copies the live cells into a FrozenBoard in one pass.
+    std::shared_ptr<const Board> snapshot() const;
+};
+
+#endif
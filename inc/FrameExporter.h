@@ -0,0 +1,148 @@
+#ifndef GOL_FRAME_EXPORTER_H
+#define GOL_FRAME_EXPORTER_H
+
+#include "Board.h"
+#include "BoundedQueue.h"
+#include <stdio.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Writes frames of a viewport of a board as images, without the GUI, for
+ * making videos of runs. addFrame() only takes a snapshot of the board and
+ * queues it; render threads rasterize snapshots and encode them while the
+ * board goes on updating, and a writer thread writes the frames in order,
+ * either one file per frame or all into the input of an encoder process.
+ *
+ * Live cells are black on white, as in the GUI, and each cell is drawn as
+ * a square of scale x scale pixels.
+ */
+class FrameExporter
+{
+public:
+    /// Image format of frames.
+    enum Format
+    {
+        FORMAT_PNG, /// 1-bit grayscale PNG, uncompressed so that it is quick to write.
+        FORMAT_PGM, /// Binary 8-bit PGM.
+        FORMAT_RAW  /// Bare 8-bit gray pixels, row after row, e.g. for "ffmpeg -f rawvideo".
+    };
+
+    /// Settings of an export.
+    struct Options
+    {
+        CellIndex row; /// Top row of the viewport.
+        CellIndex column; /// Leftmost column of the viewport.
+        int rows; /// Rows in the viewport.
+        int columns; /// Columns in the viewport.
+        int scale; /// Pixels per cell along each side.
+        Format format; /// Image format.
+
+        /// Frame files are named <prefix><frame number, 6 digits>.<format>.
+        /// Ignored if pipeCommand is given.
+        std::string prefix;
+
+        /// Command run through the shell to receive all frames on its
+        /// standard input, or empty to write files.
+        std::string pipeCommand;
+
+        int threads; /// Render threads.
+
+        Options();
+    };
+
+    /// Parse a format name ("png", "pgm" or "raw").
+    /// @return whether the name was recognized.
+    static bool parseFormat(const std::string& name, Format& format);
+
+    /**
+     * Draw a viewport of a board as 8-bit gray pixels, row after row.
+     * Works from Board::getBitmap(), which packed engines fill 64 cells at
+     * a time straight from their words.
+     */
+    static void rasterize(const Board& board, const Options& options, std::vector<uint8_t>& pixels);
+
+    /// Encode 8-bit gray pixels, black or white, as a 1-bit grayscale PNG.
+    static void encodePng(const std::vector<uint8_t>& pixels, int width, int height, std::vector<uint8_t>& out);
+
+    /// Encode 8-bit gray pixels as a binary PGM.
+    static void encodePgm(const std::vector<uint8_t>& pixels, int width, int height, std::vector<uint8_t>& out);
+
+protected:
+    /// A snapshot waiting to be rendered.
+    struct Job
+    {
+        uint64_t frame; /// Frame number, counting from 0.
+        std::shared_ptr<const Board> board; /// Snapshot to render.
+    };
+
+    /// A rendered frame waiting to be written.
+    struct Frame
+    {
+        uint64_t frame; /// Frame number, counting from 0.
+        std::vector<uint8_t> data; /// Encoded image.
+    };
+
+    Options mOptions; /// Settings of the export.
+    BoundedQueue<Job> mJobs; /// Snapshots waiting for a render thread.
+    BoundedQueue<Frame> mFrames; /// Frames waiting for the writer.
+    std::vector<std::thread> mRenderers; /// Threads rendering snapshots.
+    std::thread mWriter; /// Thread writing frames in order.
+    FILE* mPipe; /// Input of the encoder process, or null.
+    std::mutex mMutex; /// Guards the members below.
+    std::condition_variable mFinished; /// Signaled when a frame is done.
+    int mRunningRenderers; /// Render threads that haven't finished.
+    uint64_t mQueued; /// Frames queued so far.
+    uint64_t mWritten; /// Frames written so far.
+    uint64_t mFailed; /// Frames that couldn't be written.
+    uint64_t mBytes; /// Bytes written so far.
+    double mStallSeconds; /// Time addFrame() spent waiting for room.
+
+    /// Render loop: rasterize and encode snapshots until none are left.
+    void render();
+
+    /// Writer loop: write frames in order until none are left.
+    void write();
+
+    /// Write one encoded frame. @return whether it worked.
+    bool writeFrame(const Frame& frame);
+
+    /// Get width and height of frames, in pixels.
+    int getWidth() const { return mOptions.columns * mOptions.scale; }
+    int getHeight() const { return mOptions.rows * mOptions.scale; }
+
+public:
+    /**
+     * Constructor, starting the threads and, if there is one, the encoder
+     * process. Check isOpen() before adding frames.
+     */
+    explicit FrameExporter(const Options& options);
+
+    /// Destructor. Writes all queued frames and waits for the encoder.
+    ~FrameExporter();
+
+    /// Test whether frames can be written, i.e. the encoder started.
+    bool isOpen() const;
+
+    /**
+     * Queue a frame of the board as it is now. Must be called from the
+     * thread that updates the board, which may go on updating it as soon
+     * as this returns.
+     * @return false if the exporter is shutting down.
+     */
+    bool addFrame(const Board& board);
+
+    /// Wait until all queued frames are written.
+    void flush();
+
+    uint64_t getWritten(); /// Frames written so far.
+    uint64_t getFailed(); /// Frames that couldn't be written.
+    uint64_t getBytes(); /// Bytes written so far.
+    double getStallSeconds(); /// Time addFrame() spent waiting for room.
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef GOL_FROZEN_BOARD_H
+#define GOL_FROZEN_BOARD_H
+
+#include "Board.h"
+#include "BoundingBox.h"
+#include <vector>
+
+/**
+ * A read-only board holding a sorted list of live cells, as returned by
+ * Board::snapshot() for engines that can't share their cells. All of its
+ * const functions may be called from any number of threads at once.
+ *
+ * The functions that would change the board do nothing; a snapshot is only
+ * ever handed out as a const Board anyway.
+ */
+class FrozenBoard : public Board
+{
+protected:
+    std::vector<CellCoord> mCells; /// Live cells in (row, column) order.
+    BoundingBox mBox; /// Bounding box of live cells, never dirty.
+
+    /// Get first cell at or after (i, j) in row order.
+    std::vector<CellCoord>::const_iterator lowerBound(CellIndex i, CellIndex j) const;
+
+public:
+    /// Constructor taking over a sorted list of distinct live cells,
+    /// which is left empty.
+    explicit FrozenBoard(std::vector<CellCoord>& cells);
+
+    bool getCell(CellIndex i, CellIndex j) const;
+
+    void setCell(CellIndex i, CellIndex j, bool alive);
+
+    void clearBoard();
+
+    void update();
+
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
+
+    bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
+
+    bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+    int64_t getPopulation() const;
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    /// Binary searches each row in range.
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+    size_t getMemoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef GOL_HYBRID_BOARD_H
+#define GOL_HYBRID_BOARD_H
+
+#include "Board.h"
+#include "PackedBoard.h"
+#include "SparseBoard.h"
+#include <vector>
+
+/**
+ * An implementation of the Board API that accepts coordinates anywhere in
+ * the signed 64-bit range, and keeps the whole board either in a
+ * SparseBoard or in a PackedBoard fitted around the live cells, whichever
+ * is expected to update faster. The choice is revisited every few
+ * generations from the population and the density of its bounding box.
+ */
+class HybridBoard : public Board
+{
+public:
+    /// Record of a switch between representations.
+    struct SwitchEvent
+    {
+        uint64_t generation; /// Generation at which the switch happened.
+        bool toDense; /// Whether the switch was from sparse to dense.
+        int64_t population; /// Live cells at the time of the switch.
+        double density; /// Fraction of bounding box cells alive.
+    };
+
+    /// Density of the bounding box at or above which dense is used.
+    static const double DENSE_DENSITY;
+
+    /// Density below which a dense board goes back to sparse. Kept well
+    /// below DENSE_DENSITY so that boards near the threshold don't thrash.
+    static const double SPARSE_DENSITY;
+
+    /// Generations between checks of which representation to use.
+    static const uint64_t CHECK_INTERVAL = 8;
+
+    /// Minimum generations between two switches.
+    static const uint64_t MIN_SWITCH_INTERVAL = 64;
+
+    /// Largest number of cells a dense board may cover.
+    static const int64_t MAX_DENSE_CELLS = int64_t(1) << 30;
+
+    /// Dead cells kept around the live cells on each side of a dense board,
+    /// so that it needs to be regrown only every so often.
+    static const CellIndex DENSE_MARGIN = 64;
+
+protected:
+    SparseBoard mSparse; /// Board used in sparse mode.
+    PackedBoard* mDense; /// Board used in dense mode, or null in sparse mode.
+    uint64_t mGeneration; /// Number of updates so far.
+    uint64_t mLastSwitch; /// Generation of the last switch.
+    std::vector<SwitchEvent> mSwitchLog; /// All switches so far.
+
+    /// Board currently holding the cells.
+    Board* current() const;
+
+    /// Move cells into a new dense board covering the given rows and columns
+    /// plus a margin. @return whether it fit within MAX_DENSE_CELLS.
+    bool makeDense(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax);
+
+    /// Move cells from the dense board back to the sparse board.
+    void makeSparse();
+
+    /// Make sure a dense board covers the given rows and columns, by
+    /// regrowing it or by going back to sparse.
+    void coverDense(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax);
+
+    /// Switch representation if the density calls for it.
+    void chooseRepresentation();
+
+    /// Record and log a switch.
+    void logSwitch(bool toDense, int64_t population, double density);
+
+public:
+    HybridBoard(); /// Constructor.
+    ~HybridBoard(); /// Destructor.
+
+    bool getCell(CellIndex i, CellIndex j) const;
+
+    void setCell(CellIndex i, CellIndex j, bool alive);
+
+    void setCells(const CellCoord* cells, size_t count);
+
+    void clearBoard();
+
+    void update();
+
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
+
+    bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
+
+    bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+    int64_t getPopulation() const;
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+    size_t getMemoryUsage() const;
+
+    size_t estimateUpdateMemory() const;
+
+    /// Releases scratch memory, and goes sparse if that would be smaller.
+    size_t compact();
+
+    /// Takes a snapshot of whichever board holds the cells.
+    std::shared_ptr<const Board> snapshot() const;
+
+    /// Test whether the board is currently dense.
+    bool isDense() const { return mDense != NULL; }
+
+    /// Get all switches between representations so far.
+    const std::vector<SwitchEvent>& getSwitchLog() const { return mSwitchLog; }
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef GOL_INSTRUMENTATION_H
+#define GOL_INSTRUMENTATION_H
+
+#include "PerfCounters.h"
+#include <stdint.h>
+#include <chrono>
+#include <ostream>
+#include <string>
+
+/// Phases of Board::update() that are timed separately.
+/// Engines that don't have a given phase simply never report it.
+enum UpdatePhase
+{
+    PHASE_NEIGHBOR_COUNT = 0, /// Counting live neighbors of cells.
+    PHASE_BIRTH,              /// Bringing new cells to life.
+    PHASE_DEATH,              /// Killing lonely or overcrowded cells.
+    PHASE_COUNT               /// Number of phases; not a phase itself.
+};
+
+/// Counters collected over a single generation update.
+struct GenerationStats
+{
+    uint64_t generation;  /// Generation number reached by the update.
+    int64_t population;   /// Live cells after the update.
+    int64_t births;       /// Cells born during the update.
+    int64_t deaths;       /// Cells that died during the update.
+    int64_t allocations;  /// Heap blocks allocated by the engine during the update.
+    double startTime;     /// Start of update, in microseconds since instrumentation began.
+    double totalTime;     /// Duration of update in microseconds.
+    double phaseTime[PHASE_COUNT]; /// Time spent in each phase, in microseconds.
+    uint64_t counters[PERF_EVENT_COUNT]; /// Hardware events over the update, if counted.
+    uint64_t phaseCounters[PHASE_COUNT][PERF_EVENT_COUNT]; /// Hardware events in each phase.
+};
+
+/**
+ * Optional per-generation instrumentation for Board engines.
+ * A Board only does instrumentation work when one of these is attached
+ * with Board::setInstrumentation(), so the disabled cost is a null check.
+ * Stats for every generation are streamed to an output stream as CSV,
+ * JSON lines, or Chrome trace events (load in chrome://tracing or Perfetto).
+ *
+ * Hardware counters may be read at the same points as the clock, giving
+ * cycles, instructions, cache and branch misses per update and per phase.
+ */
+class Instrumentation
+{
+public:
+    /// Output format for the stats stream.
+    enum Format
+    {
+        FORMAT_CSV,
+        FORMAT_JSON,
+        FORMAT_CHROME_TRACE,
+        FORMAT_NONE /// Write nothing; stats are only read with getLastStats().
+    };
+
+    /**
+     * Constructor. The stream must outlive this object.
+     * @param perf - hardware counters to read too, or null; they must outlive
+     *               this object and belong to the thread running updates
+     */
+    Instrumentation(std::ostream& out, Format format, PerfCounters* perf = NULL);
+
+    /// Destructor; terminates the output if the format requires it.
+    ~Instrumentation();
+
+    /// Parse a format name ("csv", "json" or "chrome").
+    /// @return whether the name was recognized.
+    static bool parseFormat(const std::string& name, Format& format);
+
+    /// Name of a phase, as written to the output.
+    static const char* getPhaseName(UpdatePhase phase);
+
+    /// Mark the start of a generation update. Resets all counters.
+    void beginGeneration();
+
+    /// Mark the end of a generation update and write its stats.
+    void endGeneration(int64_t population);
+
+    /// Mark the start of a phase. Phases may be entered many times per update.
+    void beginPhase(UpdatePhase phase);
+
+    /// Mark the end of a phase started with beginPhase().
+    void endPhase(UpdatePhase phase);
+
+    void countBirths(int64_t n) { mCurrent.births += n; }
+    void countDeaths(int64_t n) { mCurrent.deaths += n; }
+    void countAllocations(int64_t n) { mCurrent.allocations += n; }
+
+    /// Stats of the most recently completed generation.
+    const GenerationStats& getLastStats() const { return mLast; }
+
+    /// Test whether hardware counters are being read.
+    bool hasCounters() const { return mPerf != NULL; }
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    std::ostream& mOut; /// Stream receiving stats.
+    Format mFormat; /// Format written to mOut.
+    bool mFirstRecord; /// Whether no stats have been written yet.
+    uint64_t mGeneration; /// Number of generations seen so far.
+    Clock::time_point mEpoch; /// Time at which instrumentation began.
+    Clock::time_point mGenerationStart; /// Time at which current update began.
+    Clock::time_point mPhaseStart[PHASE_COUNT]; /// Time at which each phase was last entered.
+    GenerationStats mCurrent; /// Stats of the update in progress.
+    GenerationStats mLast; /// Stats of the last completed update.
+    PerfCounters* mPerf; /// Hardware counters, or null if not counted.
+    uint64_t mGenerationCounters[PERF_EVENT_COUNT]; /// Counters when the update began.
+    uint64_t mPhaseCounters[PHASE_COUNT][PERF_EVENT_COUNT]; /// Counters when each phase was last entered.
+
+    /// Microseconds elapsed between two time points.
+    static double elapsed(Clock::time_point from, Clock::time_point to);
+
+    /// Add hardware events counted since start to total.
+    void addCountersSince(const uint64_t start[PERF_EVENT_COUNT], uint64_t total[PERF_EVENT_COUNT]);
+
+    /// Write counters as chrome trace arguments, each preceded by a comma.
+    void writeCounterArgs(const uint64_t counters[PERF_EVENT_COUNT]);
+
+    /// Write stats for one generation in the current format.
+    void writeStats(const GenerationStats& stats);
+};
+
+/**
+ * Times a phase for as long as this object is in scope.
+ * Does nothing if instrumentation is null.
+ */
+class PhaseScope
+{
+    Instrumentation* mInstrumentation;
+    UpdatePhase mPhase;
+
+public:
+    PhaseScope(Instrumentation* instrumentation, UpdatePhase phase) :
+        mInstrumentation(instrumentation), mPhase(phase)
+    {
+        if (mInstrumentation)
+        {
+            mInstrumentation->beginPhase(mPhase);
+        }
+    }
+
+    ~PhaseScope()
+    {
+        if (mInstrumentation)
+        {
+            mInstrumentation->endPhase(mPhase);
+        }
+    }
+};
+
+#endif
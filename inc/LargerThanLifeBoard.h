@@ -0,0 +1,102 @@
+#ifndef GOL_LARGER_THAN_LIFE_BOARD_H
+#define GOL_LARGER_THAN_LIFE_BOARD_H
+
+#include "PackedBoard.h"
+#include <string>
+#include <vector>
+
+/**
+ * A dense board running Larger than Life rules, where a cell's neighbors
+ * are all cells within a range of rows and columns around it rather than
+ * the 8 next to it. Cells are stored packed 64 to a word as in PackedBoard,
+ * which provides everything but update().
+ *
+ * Neighbors are counted with running sums instead of visiting the
+ * (2R+1)^2 cells around each cell: each row is summed along its columns,
+ * those row sums are kept summed down a window of 2R+1 rows, and the
+ * window slides one row at a time, adding the row entering it and
+ * subtracting the one leaving. This is a summed-area table built a row at
+ * a time, so the cost per cell doesn't depend on the range.
+ *
+ * Cells outside the board are dead.
+ */
+class LargerThanLifeBoard : public PackedBoard
+{
+public:
+    static const int MAX_RADIUS = 255; /// Largest supported range.
+
+    /// A Larger than Life rule with a Moore (square) neighborhood.
+    struct Rule
+    {
+        int radius; /// Range R: neighbors are within R rows and R columns.
+        bool countsSelf; /// Whether a cell counts among its own neighbors.
+        int birthMin, birthMax; /// A dead cell with this many live neighbors is born.
+        int survivalMin, survivalMax; /// A live cell with this many live neighbors survives.
+
+        /// Constructor for the rule of the Game of Life, R1,C0,M0,S2..3,B3..3,NM.
+        Rule();
+    };
+
+    /**
+     * Parse a rule in the usual notation, e.g. "R5,C0,M1,S34..58,B34..45,NM"
+     * for Bosco's rule. Only two-state rules (C0 or C2) with a Moore
+     * neighborhood (NM, or no N) are supported.
+     * @return false if the rule is malformed or unsupported.
+     */
+    static bool parseRule(const std::string& text, Rule& rule);
+
+    /// Format a rule in the usual notation.
+    static std::string formatRule(const Rule& rule);
+
+protected:
+    Rule mRule; /// Rule applied by update().
+
+    /// Live cells within range of each column, in the rows within range
+    /// of the row being updated.
+    std::vector<int32_t> mWindowSums;
+
+    /// Prefix sums of one row: entry k is the number of live cells left of
+    /// column k - R, so that a column's neighbors in the row are the
+    /// difference of two entries 2R + 1 apart. Scratch space.
+    std::vector<int32_t> mPrefix;
+
+    /// Add row offset r's live cells within range of each column to
+    /// mWindowSums, times sign (1 or -1).
+    /// @return number of live cells in the row.
+    int64_t addRowSums(CellIndex r, int sign);
+
+    /// Append the live cells of a rectangle, inclusive, in order.
+    void appendLiveCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax,
+        std::vector<CellCoord>& cells) const;
+
+public:
+    /// Constructor for a board covering rows [firstRow, firstRow + rows)
+    /// and columns [firstColumn, firstColumn + columns).
+    LargerThanLifeBoard(const Rule& rule, CellIndex rows, CellIndex columns,
+        CellIndex firstRow = 0, CellIndex firstColumn = 0);
+
+    /// Get the rule applied by update().
+    const Rule& getRule() const { return mRule; }
+
+    /// Set the rule applied by update(). The radius is clamped to [1, MAX_RADIUS].
+    void setRule(const Rule& rule);
+
+    void update();
+
+    /// Runs the rule on a board copied from the light cone, which is
+    /// widened by R cells per generation.
+    bool getFutureWindow(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax,
+        int64_t generations, std::vector<CellCoord>& cells) const;
+
+    size_t getMemoryUsage() const;
+
+    size_t estimateUpdateMemory() const;
+
+    /// Releases the scratch buffers used by update().
+    size_t compact();
+
+    /// Shares the cells with the snapshot, like PackedBoard's, and keeps the rule.
+    std::shared_ptr<const Board> snapshot() const;
+};
+
+#endif
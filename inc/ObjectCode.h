@@ -0,0 +1,45 @@
+#ifndef GOL_OBJECT_CODE_H
+#define GOL_OBJECT_CODE_H
+
+#include "Board.h"
+#include <string>
+#include <vector>
+
+/**
+ * Naming of small objects independently of their position, orientation and
+ * phase, in the apgcode notation used by soup searches: "xs4_33" for a
+ * block, "xp2_7" for a blinker, "xq4_153" for a glider. The prefix gives
+ * the kind of object (still life, oscillator or spaceship) with its
+ * population or period, and the rest is the object in extended Wechsler
+ * notation, in whichever orientation and phase gives the shortest string.
+ */
+
+/// Phases of an object, one sorted list of live cells per generation.
+typedef std::vector<std::vector<CellCoord> > ObjectPhases;
+
+/**
+ * Get the extended Wechsler notation of cells, as they are, without
+ * moving or turning them. Cells needn't start at (0, 0).
+ */
+std::string getWechsler(const std::vector<CellCoord>& cells);
+
+/**
+ * Get the apgcode of an object.
+ * @param phases - cells of the object over one full period; a still life
+ *                 has one phase
+ * @param moving - whether the object is a spaceship, in which case phases
+ *                 may be at different positions
+ */
+std::string getObjectCode(const ObjectPhases& phases, bool moving);
+
+/**
+ * Split live cells into objects of cells connected through cells at most
+ * reach rows and columns apart: through any of their eight neighbors for
+ * reach 1, or through any cells they could interact with for reach 2.
+ * @param cells - live cells, sorted
+ * @param objects - receives one sorted list of cells per object
+ */
+void findComponents(const std::vector<CellCoord>& cells, std::vector<std::vector<CellCoord> >& objects,
+    CellIndex reach = 1);
+
+#endif
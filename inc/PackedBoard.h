@@ -0,0 +1,122 @@
+#ifndef GOL_PACKED_BOARD_H
+#define GOL_PACKED_BOARD_H
+
+#include "Board.h"
+#include "BoundingBox.h"
+#include <vector>
+
+/**
+ * A dense implementation of the Board API that packs 64 cells into each
+ * machine word and updates a whole word of cells at once with bitwise
+ * operations. Like BasicBoard it covers a bounded rectangle of cells, but
+ * the rectangle may start at any row and column.
+ */
+class PackedBoard : public Board
+{
+protected:
+    CellIndex mRows; /// Number of rows in game board.
+    CellIndex mColumns; /// Number of columns in game board.
+    CellIndex mFirstRow; /// Row index of the top row.
+    CellIndex mFirstColumn; /// Column index of the leftmost column.
+    size_t mWordsPerRow; /// Number of words holding a row.
+
+    /// Words holding cells, row after row.
+    typedef std::vector<uint64_t> Words;
+
+    /// Cells, row after row. Bits past the last column are always 0.
+    /// Shared with snapshots, so ownCells() must be called before changing them.
+    std::shared_ptr<Words> mCells;
+
+    /// Scratch space for the next generation, kept between updates unless
+    /// a snapshot still holds it. May be null.
+    std::shared_ptr<Words> mNextCells;
+
+    /// Test whether words are also held by a snapshot. If not, they may be
+    /// changed as soon as this returns.
+    static bool isShared(const std::shared_ptr<Words>& words);
+
+    /// Copy mCells if a snapshot holds them, so that they may be changed.
+    void ownCells();
+
+    int64_t mPopulation; /// Number of live cells.
+    mutable BoundingBox mBox; /// Bounding box of live cells.
+
+    /// Widen mBox to hold the live cells of row r, and count them.
+    int64_t includeRow(CellIndex r, const uint64_t* row) const;
+
+    /// Add the cells of row r that differ between two states to mChangeSet.
+    void addChangedWords(CellIndex r, const uint64_t* before, const uint64_t* after);
+
+    /// Test whether (i, j) is inside the board.
+    bool contains(CellIndex i, CellIndex j) const
+    {
+        return (i >= mFirstRow) && (j >= mFirstColumn) &&
+            (i < mFirstRow + mRows) && (j < mFirstColumn + mColumns);
+    }
+
+    /// Get pointer to the words of row r, counting from the top row.
+    const uint64_t* getRow(CellIndex r) const
+    {
+        return &(*mCells)[r * mWordsPerRow];
+    }
+
+    /// Find live cell at or after row offset r, word w, bit b.
+    bool findLiveCell(CellIndex r, size_t w, int b, CellIndex& i, CellIndex& j) const;
+
+    /// Make an empty board a copy of this one that shares its cells, for snapshot().
+    void shareCells(PackedBoard& copy) const;
+
+public:
+    /// Constructor for a board covering rows [firstRow, firstRow + rows)
+    /// and columns [firstColumn, firstColumn + columns).
+    PackedBoard(CellIndex rows, CellIndex columns, CellIndex firstRow = 0, CellIndex firstColumn = 0);
+
+    CellIndex getRows() const { return mRows; }
+    CellIndex getColumns() const { return mColumns; }
+    CellIndex getFirstRow() const { return mFirstRow; }
+    CellIndex getFirstColumn() const { return mFirstColumn; }
+
+    bool getCell(CellIndex i, CellIndex j) const;
+
+    void setCell(CellIndex i, CellIndex j, bool alive);
+
+    /// ORs cells straight into their words.
+    void setCells(const CellCoord* cells, size_t count);
+
+    void clearBoard();
+
+    void update();
+
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
+
+    bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
+
+    bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+    int64_t getPopulation() const;
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    bool getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    /// Counts 64 cells at a time.
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+    size_t getMemoryUsage() const;
+
+    size_t estimateUpdateMemory() const;
+
+    /// Releases the scratch buffer used by update().
+    size_t compact();
+
+    /// Test whether any cell on the outermost rows or columns is alive,
+    /// i.e. whether the next update could need cells outside the board.
+    bool touchesEdge() const;
+
+    /// Shares the cells with the snapshot, so this costs no more than an
+    /// allocation. Setting a cell afterwards copies them once; update()
+    /// writes a new buffer anyway.
+    std::shared_ptr<const Board> snapshot() const;
+};
+
+#endif
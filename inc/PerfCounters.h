@@ -0,0 +1,68 @@
+#ifndef GOL_PERF_COUNTERS_H
+#define GOL_PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <string>
+
+/// Hardware events counted by PerfCounters.
+enum PerfEvent
+{
+    PERF_CYCLES = 0,     /// CPU cycles.
+    PERF_INSTRUCTIONS,   /// Instructions retired.
+    PERF_L1D_MISSES,     /// L1 data cache read misses.
+    PERF_LLC_MISSES,     /// Last level cache misses.
+    PERF_BRANCH_MISSES,  /// Mispredicted branches.
+    PERF_EVENT_COUNT     /// Number of events; not an event itself.
+};
+
+/**
+ * Hardware performance counters of the calling thread, read through
+ * perf_event_open on Linux. Only user-space work is counted, so that this
+ * works without privileges under the default perf_event_paranoid setting.
+ *
+ * Counters that can't be opened, e.g. in a VM without a virtual PMU or on
+ * other systems, read as zero; isAvailable() says which ones are real.
+ */
+class PerfCounters
+{
+public:
+    /// Constructor; opens and starts the counters for the calling thread.
+    PerfCounters();
+
+    /// Destructor; closes the counters.
+    ~PerfCounters();
+
+    /// Name of an event, as written to output.
+    static const char* getEventName(PerfEvent event);
+
+    /// Test whether any counter could be opened.
+    bool isAvailable() const;
+
+    /// Test whether the counter of an event could be opened.
+    bool isAvailable(PerfEvent event) const;
+
+    /// Why counters are unavailable, or empty if all of them opened.
+    const std::string& getError() const { return mError; }
+
+    /**
+     * Read the running totals of every event into values, indexed by
+     * PerfEvent. Totals are scaled up if the kernel had to share the
+     * hardware with other counters. Only differences between two reads
+     * mean anything.
+     */
+    void read(uint64_t values[PERF_EVENT_COUNT]) const;
+
+protected:
+    /// Descriptor of the group leader, which reads all counters at once,
+    /// or -1 if none opened.
+    int mGroup;
+
+    /// Position of each event in a group read, or -1 if it didn't open.
+    int mSlots[PERF_EVENT_COUNT];
+
+    int mFds[PERF_EVENT_COUNT]; /// Descriptor of each counter, or -1.
+    int mOpened; /// Number of counters opened.
+    std::string mError; /// Why counters are unavailable.
+};
+
+#endif
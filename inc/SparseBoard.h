@@ -5,6 +5,7 @@
 #include <map>
 #include <set>
 #include <utility>
+#include <vector>
 
 /// A single row of the board. For each index, record if that cell is alive.
 typedef std::set<CellIndex> BoardRow;
@@ -25,11 +26,71 @@ class SparseBoard : public Board
 protected:
     BoardRep mBoard;
 
+	int64_t mPopulation; /// Number of live cells.
+
+	/// First and last column of every row, so that the leftmost and
+	/// rightmost live columns are always at hand. Rows need no tracking
+	/// since mBoard is ordered by row.
+	std::multiset<CellIndex> mRowFirsts, mRowLasts;
+
+	/// Live cells laid out flat for countCells(), built when first needed
+	/// after a change: the columns of every row in order, and for each row
+	/// its index and the offset of its first column.
+	mutable std::vector<CellIndex> mIndexColumns;
+	mutable std::vector<std::pair<CellIndex, size_t> > mIndexRows;
+	mutable bool mIndexDirty; /// Whether cells changed since the index was built.
+
+	/// Ends of a row as they were before a change, for noteRowEnds().
+	struct RowEnds
+	{
+		bool empty; /// Whether the row had no cells.
+		CellIndex first, last; /// First and last columns, unless empty.
+
+		/// Ends of a row that didn't exist.
+		RowEnds() :
+			empty(true), first(0), last(0)
+		{
+		}
+
+		explicit RowEnds(const BoardRow& row) :
+			empty(row.empty()), first(empty ? 0 : *row.begin()), last(empty ? 0 : *row.rbegin())
+		{
+		}
+	};
+
+	/// Bring mRowFirsts and mRowLasts up to date after a row changed,
+	/// before it is removed if it is now empty.
+	void noteRowEnds(const RowEnds& before, const BoardRow& row);
+
+	/// Build mIndexColumns and mIndexRows if cells changed since.
+	void buildIndex() const;
+
+	/// Approximate bytes used by each node of a std::map or std::set:
+	/// three links and a color, plus the heap block header.
+	static const size_t TREE_NODE_OVERHEAD = 4 * sizeof(void*) + 16;
+
+	/// Approximate bytes used by a row of the board, excluding its cells.
+	static const size_t ROW_BYTES = TREE_NODE_OVERHEAD + sizeof(BoardRep::value_type);
+
+	/// Approximate bytes used by a live cell.
+	static const size_t CELL_BYTES = TREE_NODE_OVERHEAD + sizeof(CellIndex);
+
+	/// Approximate bytes used by the entries of a row in mRowFirsts and mRowLasts.
+	static const size_t ROW_ENDS_BYTES = 2 * (TREE_NODE_OVERHEAD + sizeof(CellIndex));
+
+	/// Approximate bytes used by a row of the neighbor count, excluding its cells.
+	static const size_t NBR_ROW_BYTES = TREE_NODE_OVERHEAD + sizeof(NeighborCount::value_type);
+
+	/// Approximate bytes used by a single neighbor count.
+	static const size_t NBR_CELL_BYTES = TREE_NODE_OVERHEAD + sizeof(NeighborCount::mapped_type::value_type);
+
 	/// Update neighbor count by looking at cells in row i.
-	void updateNeighborCount(CellIndex i, NeighborCount& nbrs) const;
+	/// @return approximate bytes added to the neighbor count.
+	size_t updateNeighborCount(CellIndex i, NeighborCount& nbrs) const;
 
 	/// Create new cells based on neighbor count in row i.
-	void birthCells(CellIndex i, const NeighborCount& nbrs);
+	/// @return number of cells born.
+	int64_t birthCells(CellIndex i, const NeighborCount& nbrs);
 
 public:
     SparseBoard();
@@ -38,15 +99,39 @@ public:
 
     void setCell(CellIndex i, CellIndex j, bool alive);
 
+    /// Sorts the cells if needed, then builds each row in one pass.
+    void setCells(const CellCoord* cells, size_t count);
+
     void clearBoard();
 
     void update();
 
-    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height);
+    int64_t getPopulation() const;
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    /// Takes a binary search in each row of the range, or in the rows
+    /// alone if the range spans every live column, once an index of the
+    /// cells is built. The index is built after cells change, in time
+    /// proportional to the population, so that many counts of the same
+    /// generation share it.
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+    size_t getMemoryUsage() const;
+
+    size_t estimateUpdateMemory() const;
+
+    /// Releases the index built by countCells().
+    size_t compact();
+
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
 
     bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
 
     bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+    /// Copies the live cells into a FrozenBoard in one pass over the rows.
+    std::shared_ptr<const Board> snapshot() const;
 };
 
 #endif
\ No newline at end of file
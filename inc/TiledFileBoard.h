@@ -0,0 +1,203 @@
+#ifndef GOL_TILED_FILE_BOARD_H
+#define GOL_TILED_FILE_BOARD_H
+
+#include "BitLife.h"
+#include "Board.h"
+#include "BoundingBox.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A dense implementation of the Board API for boards larger than memory.
+ * Cells are packed 64 to a word, as in PackedBoard, and split into square
+ * tiles kept in a backing file: one set of tiles for the current
+ * generation and one for the next. Tiles are mapped into memory as they
+ * are needed, and only a limited number stay mapped at once, the least
+ * recently used being unmapped first.
+ *
+ * update() sweeps the tiles once in row order, reading each tile with a
+ * halo of its neighbors and writing its next state to the other set of
+ * tiles, while the tiles of the next row of tiles are read ahead of time.
+ * advance() can take several generations per sweep, so that the file is
+ * read only once for all of them. Tiles without live cells around them
+ * are never read.
+ *
+ * The backing file is scratch space, removed as soon as it is created.
+ * Where memory-mapped files aren't supported, or the file can't be made,
+ * tiles are kept on the heap instead and the resident limit has no effect.
+ */
+class TiledFileBoard : public Board
+{
+public:
+    static const int TILE_ROWS = 1024; /// Rows in a tile.
+    static const int TILE_WORDS = 16; /// Words in a row of a tile.
+    static const int TILE_COLUMNS = TILE_WORDS * BITS_PER_WORD; /// Columns in a tile.
+
+    /// Bytes in a tile. A multiple of the page size, so tiles map on their own.
+    static const size_t TILE_BYTES = TILE_ROWS * TILE_WORDS * sizeof(uint64_t);
+
+    /// Most generations a sweep may take, as the halo is one word wide.
+    static const int MAX_SWEEP_GENERATIONS = BITS_PER_WORD;
+
+    /// Default limit on the memory used by mapped tiles.
+    static const size_t DEFAULT_RESIDENT_BYTES = size_t(256) << 20;
+
+protected:
+    /// A tile in memory.
+    struct ResidentTile
+    {
+        uint64_t* words; /// Cells of the tile, row after row.
+        std::list<size_t>::iterator use; /// Position in mUseOrder.
+    };
+
+    CellIndex mRows; /// Number of rows in game board.
+    CellIndex mColumns; /// Number of columns in game board.
+    CellIndex mWordsPerRow; /// Number of words holding a row.
+    CellIndex mTileRows; /// Number of rows of tiles.
+    CellIndex mTileColumns; /// Number of columns of tiles.
+    size_t mTileCount; /// Number of tiles in a generation.
+    int mCurrent; /// Which set of tiles holds the current generation, 0 or 1.
+
+    /// Live cells in each tile of each set. A tile without live cells is
+    /// all zero, and isn't read at all.
+    std::vector<uint32_t> mTilePopulation[2];
+
+    int mFile; /// Backing file descriptor, or -1 if tiles are on the heap.
+    size_t mResidentBytes; /// Limit on the memory used by mapped tiles.
+    int mSweepGenerations; /// Generations advance() takes per sweep.
+
+    /// Tiles in memory, by key; see getKey().
+    mutable std::unordered_map<size_t, ResidentTile> mResident;
+
+    /// Keys of tiles in memory, most recently used first.
+    mutable std::list<size_t> mUseOrder;
+
+    mutable uint64_t mTileLoads; /// Number of times a tile was mapped.
+    std::vector<uint64_t> mScratch; /// Two tiles with halos, for sweeps.
+
+    int64_t mPopulation; /// Number of live cells.
+    mutable BoundingBox mBox; /// Bounding box of live cells.
+
+    /// Get the key of tile (tr, tc) of a set.
+    size_t getKey(int set, CellIndex tr, CellIndex tc) const
+    {
+        return set * mTileCount + static_cast<size_t>(tr * mTileColumns + tc);
+    }
+
+    /// Get the cells of a tile, mapping it if needed. The pointer is good
+    /// until the next call, which may unmap it.
+    uint64_t* getTile(size_t key) const;
+
+    /// Get the cells of a tile of the current generation for reading,
+    /// or null if it has no live cells.
+    const uint64_t* readTile(CellIndex tr, CellIndex tc) const;
+
+    /// Unmap or free a tile in memory.
+    void releaseTile(const ResidentTile& tile) const;
+
+    /// Unmap or free all tiles in memory.
+    void releaseAll() const;
+
+    /// Hint that a tile of the current generation will be read soon.
+    void prefetchTile(CellIndex tr, CellIndex tc) const;
+
+    /// Test whether tile (tr, tc) or any tile next to it has live cells.
+    bool hasLiveNeighborhood(CellIndex tr, CellIndex tc) const;
+
+    /// Advance every tile by some generations in one sweep.
+    void sweep(int generations);
+
+    /// Copy tile (tr, tc) with a halo of rows and one word on each side into scratch.
+    void loadHalo(CellIndex tr, CellIndex tc, int halo, uint64_t* scratch) const;
+
+    /// Add the cells of tile (tr, tc) that differ between two scratch
+    /// buffers with halos of the given rows to mChangeSet.
+    void addChangedWords(CellIndex tr, CellIndex tc, const uint64_t* before, const uint64_t* after, int halo);
+
+    /// Widen mBox to hold the live cells of a row of tile column tc.
+    void includeRow(CellIndex i, CellIndex tc, const uint64_t* row) const;
+
+    /// Read 64 cells of row i starting at any column.
+    uint64_t extractBits(CellIndex i, CellIndex j) const;
+
+    /// Find live cell at or after (i, j).
+    bool findLiveCell(CellIndex i, CellIndex j, CellIndex& iFound, CellIndex& jFound) const;
+
+    /// Test whether (i, j) is inside the board.
+    bool contains(CellIndex i, CellIndex j) const
+    {
+        return (i >= 0) && (j >= 0) && (i < mRows) && (j < mColumns);
+    }
+
+public:
+    /**
+     * Constructor for a board covering rows [0, rows) and columns [0, columns).
+     * @param directory - where to make the backing file; empty for $TMPDIR or /tmp
+     * @param residentBytes - limit on the memory used by mapped tiles
+     */
+    TiledFileBoard(CellIndex rows, CellIndex columns, const std::string& directory = "",
+        size_t residentBytes = DEFAULT_RESIDENT_BYTES);
+
+    /// Destructor. Unmaps the tiles and closes the backing file.
+    ~TiledFileBoard();
+
+    CellIndex getRows() const { return mRows; }
+    CellIndex getColumns() const { return mColumns; }
+
+    /// Test whether tiles are kept in a backing file rather than on the heap.
+    bool isFileBacked() const { return mFile != -1; }
+
+    /// Number of times a tile was mapped since construction.
+    uint64_t getTileLoads() const { return mTileLoads; }
+
+    /// Set the limit on the memory used by mapped tiles. At least one tile
+    /// stays mapped whatever the limit.
+    void setResidentLimit(size_t bytes);
+
+    /**
+     * Set how many generations advance() takes per sweep, from 1 to
+     * MAX_SWEEP_GENERATIONS. More generations read the file less often,
+     * but redo more of the halo. Ignored while instrumentation or a change
+     * set is attached, so that they stay per generation.
+     */
+    void setSweepGenerations(int generations);
+
+    /// Update the board by some generations, in as few sweeps as allowed.
+    void advance(int64_t generations);
+
+    bool getCell(CellIndex i, CellIndex j) const;
+
+    void setCell(CellIndex i, CellIndex j, bool alive);
+
+    void clearBoard();
+
+    void update();
+
+    const int8_t* getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const;
+
+    bool getFirstLiveCell(CellIndex& i, CellIndex& j) const;
+
+    bool getNextLiveCell(CellIndex& i, CellIndex& j) const;
+
+    int64_t getPopulation() const;
+
+    bool getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    bool getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const;
+
+    /// Counts whole tiles from their populations, and 64 cells at a time elsewhere.
+    int64_t countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const;
+
+    /// Counts mapped tiles only; the rest are in the file.
+    size_t getMemoryUsage() const;
+
+    size_t estimateUpdateMemory() const;
+
+    /// Unmaps all tiles, or on the heap frees tiles without live cells,
+    /// and releases the sweep's scratch space.
+    size_t compact();
+};
+
+#endif
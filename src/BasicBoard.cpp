@@ -1,5 +1,8 @@
 #include "BasicBoard.h"
+#include "Instrumentation.h"
+#include <algorithm>
 #include <assert.h>
+#include <atomic>
 
 using namespace std;
 
@@ -8,41 +11,120 @@ BasicBoard::BasicBoard(CellIndex rows, CellIndex columns) :
 {
   mRows = rows;
   mColumns = columns;
+  mPopulation = 0;
+  mTreeDirty = true;
 
-  mBoard.resize(rows, vector<bool>());
-  for (vector<bool>& v : mBoard)
+  mBoard.resize(rows);
+  for (shared_ptr<Row>& row : mBoard)
   {
-    v.resize(columns, false);
+    row = make_shared<Row>(columns, false);
   }
 }
 
+bool BasicBoard::isShared(const shared_ptr<Row>& row)
+{
+  if (row.use_count() > 1)
+  {
+    return true;
+  }
+
+  // A snapshot may have just been released on another thread; make sure
+  // its last reads of the row happen before any writes to it here.
+  atomic_thread_fence(memory_order_acquire);
+  return false;
+}
+
+BasicBoard::Row& BasicBoard::ownRow(CellIndex i)
+{
+  if (isShared(mBoard[i]))
+  {
+    mBoard[i] = make_shared<Row>(*mBoard[i]);
+  }
+  return *mBoard[i];
+}
+
 bool BasicBoard::getCell(CellIndex i, CellIndex j) const
 {
     if ((i >= 0) && (j >= 0) && (i < mRows) && (j < mColumns))
     {
-        return mBoard[i][j];
+        return (*mBoard[i])[j];
     }
     return false;
 }
 
 void BasicBoard::setCell(CellIndex i, CellIndex j, bool alive)
 {
-    if ((i >= 0) && (j >= 0) && (i < mRows) && (j < mColumns))
+    if ((i >= 0) && (j >= 0) && (i < mRows) && (j < mColumns) && ((*mBoard[i])[j] != alive))
     {
-        mBoard[i][j] = alive;
+        ownRow(i)[j] = alive;
+        if (alive)
+        {
+            mPopulation++;
+            mBox.include(i, j);
+        }
+        else
+        {
+            mPopulation--;
+            mBox.exclude(i, j);
+        }
+        addToTree(i, j, alive ? 1 : -1);
     }
 }
 
+void BasicBoard::setCells(const CellCoord* cells, size_t count)
+{
+  for (size_t c = 0; c < count; c++)
+  {
+    CellIndex i = cells[c].first;
+    CellIndex j = cells[c].second;
+    if ((i >= 0) && (j >= 0) && (i < mRows) && (j < mColumns) && !(*mBoard[i])[j])
+    {
+      ownRow(i)[j] = true;
+      mPopulation++;
+      mBox.include(i, j);
+      addToTree(i, j, 1);
+    }
+  }
+}
+
 void BasicBoard::update()
 {
   // Do the dumbest thing possible: make a copy of the board and update that.
   // This is not an efficient way of doing things, but a simple implementation
-  // is still useful as a baseline output.
-  std::vector< std::vector<bool> > oldBoard = mBoard;
+  // is still useful as a baseline output. The copy shares its rows with the
+  // board, so only rows where a cell changes are actually copied.
+
+  // Counting and updating happen in the same pass, so all of it is timed
+  // as neighbor counting.
+  Instrumentation* instrumentation = mInstrumentation;
+  if (instrumentation)
+  {
+    instrumentation->beginGeneration();
+    instrumentation->beginPhase(PHASE_NEIGHBOR_COUNT);
+  }
+
+  if (mChangeSet)
+  {
+    mChangeSet->clear();
+  }
+
+  std::vector< std::shared_ptr<Row> > oldBoard = mBoard;
+
+  int64_t births = 0, deaths = 0, population = 0, rowsCopied = 0;
+  mBox.reset();
+  mTreeDirty = true;
 
   // Just count up neighbors of each cell one by one.
   for (CellIndex i = 0; i < mRows; i++)
   {
+    // Old rows i - 1 to i + 1, where they are on the board.
+    const Row* oldRows[3];
+    for (int di = -1; di <= 1; di++)
+    {
+      CellIndex iNbr = i + di;
+      oldRows[di + 1] = ((iNbr < 0) || (iNbr >= mRows)) ? NULL : oldBoard[iNbr].get();
+    }
+
     for (CellIndex j = 0; j < mColumns; j++)
     {
       int nbrCount = 0;
@@ -63,27 +145,221 @@ void BasicBoard::update()
 	        continue;
 	      }
 
-	      nbrCount += (oldBoard[iNbr][jNbr] == true);
+	      nbrCount += ((*oldRows[di + 1])[jNbr] == true);
 	    }
       }
 
       // Update cell according to neighbor count.
-      if (oldBoard[i][j])
+      if ((*oldRows[1])[j])
       {
 	    if ((nbrCount < 2) || (nbrCount > 3))
 	    {
-	      mBoard[i][j] = false;
+	      ownRow(i)[j] = false;
+	      deaths++;
 	    }
       }
       else
       {
 	    if (nbrCount == 3)
 	    {
-	      mBoard[i][j] = true;
+	      ownRow(i)[j] = true;
+	      births++;
 	    }
       }
+      if ((*mBoard[i])[j])
+      {
+        population++;
+        mBox.include(i, j);
+      }
+      if (mChangeSet && ((*mBoard[i])[j] != (*oldRows[1])[j]))
+      {
+        addChange(*mChangeSet, i, j);
+      }
+    }
+    rowsCopied += (mBoard[i] != oldBoard[i]) ? 1 : 0;
+  }
+  mPopulation = population;
+
+  // The rows that were copied are all still held by the old board.
+  notePeakMemory(getMemoryUsage() + mRows * sizeof(std::shared_ptr<Row>) + rowsCopied * getRowBytes());
+
+  if (instrumentation)
+  {
+    instrumentation->endPhase(PHASE_NEIGHBOR_COUNT);
+    instrumentation->countBirths(births);
+    instrumentation->countDeaths(deaths);
+    // The copy of the board allocates the outer vector plus one per row
+    // that changed.
+    instrumentation->countAllocations(rowsCopied + 1);
+    instrumentation->endGeneration(population);
+  }
+}
+
+int64_t BasicBoard::getPopulation() const
+{
+  return mPopulation;
+}
+
+/// Find the first of 0 to n - 1 that passes a test, which everything
+/// after it passes too. @return n - 1 if none does.
+template <typename Test>
+static CellIndex findFirst(CellIndex n, Test test)
+{
+  CellIndex low = 0, high = n - 1;
+  while (low < high)
+  {
+    CellIndex mid = low + (high - low) / 2;
+    if (test(mid))
+    {
+      high = mid;
+    }
+    else
+    {
+      low = mid + 1;
+    }
+  }
+  return low;
+}
+
+bool BasicBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+  if (mBox.dirty)
+  {
+    mBox.reset();
+    if (mPopulation > 0)
+    {
+      // Counts of cells up to a row or column only grow, so the first and
+      // last live ones are where they pass 0 and reach the population.
+      buildTree();
+      mBox.iMin = findFirst(mRows, [this](CellIndex i) { return countBefore(i + 1, mColumns) > 0; });
+      mBox.iMax = findFirst(mRows, [this](CellIndex i) { return countBefore(i + 1, mColumns) == mPopulation; });
+      mBox.jMin = findFirst(mColumns, [this](CellIndex j) { return countBefore(mRows, j + 1) > 0; });
+      mBox.jMax = findFirst(mColumns, [this](CellIndex j) { return countBefore(mRows, j + 1) == mPopulation; });
     }
   }
+  return mBox.get(iMin, jMin, iMax, jMax);
+}
+
+void BasicBoard::buildTree() const
+{
+  if (!mTreeDirty)
+  {
+    return;
+  }
+
+  // Start from the cells themselves, then pass each entry's count on to
+  // its parent along columns, then along rows, which builds the tree in
+  // linear time.
+  size_t stride = static_cast<size_t>(mColumns + 1);
+  mTree.assign(static_cast<size_t>(mRows + 1) * stride, 0);
+  for (CellIndex i = 0; i < mRows; i++)
+  {
+    const Row& row = *mBoard[i];
+    for (CellIndex j = 0; j < mColumns; j++)
+    {
+      mTree[(i + 1) * stride + (j + 1)] = row[j] ? 1 : 0;
+    }
+  }
+  for (CellIndex i = 1; i <= mRows; i++)
+  {
+    for (CellIndex j = 1; j <= mColumns; j++)
+    {
+      CellIndex parent = j + (j & -j);
+      if (parent <= mColumns)
+      {
+        mTree[i * stride + parent] += mTree[i * stride + j];
+      }
+    }
+  }
+  for (CellIndex i = 1; i <= mRows; i++)
+  {
+    CellIndex parent = i + (i & -i);
+    if (parent <= mRows)
+    {
+      for (CellIndex j = 1; j <= mColumns; j++)
+      {
+        mTree[parent * stride + j] += mTree[i * stride + j];
+      }
+    }
+  }
+  mTreeDirty = false;
+}
+
+void BasicBoard::addToTree(CellIndex i, CellIndex j, int32_t delta)
+{
+  if (mTreeDirty)
+  {
+    return;
+  }
+  size_t stride = static_cast<size_t>(mColumns + 1);
+  for (CellIndex r = i + 1; r <= mRows; r += r & -r)
+  {
+    for (CellIndex c = j + 1; c <= mColumns; c += c & -c)
+    {
+      mTree[r * stride + c] += delta;
+    }
+  }
+}
+
+int64_t BasicBoard::countBefore(CellIndex i, CellIndex j) const
+{
+  size_t stride = static_cast<size_t>(mColumns + 1);
+  int64_t count = 0;
+  for (CellIndex r = i; r > 0; r -= r & -r)
+  {
+    for (CellIndex c = j; c > 0; c -= c & -c)
+    {
+      count += mTree[r * stride + c];
+    }
+  }
+  return count;
+}
+
+bool BasicBoard::getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+  iMin = 0;
+  jMin = 0;
+  iMax = mRows - 1;
+  jMax = mColumns - 1;
+  return true;
+}
+
+int64_t BasicBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+  iMin = max<CellIndex>(iMin, 0);
+  jMin = max<CellIndex>(jMin, 0);
+  iMax = min<CellIndex>(iMax, mRows - 1);
+  jMax = min<CellIndex>(jMax, mColumns - 1);
+
+  if ((iMin > iMax) || (jMin > jMax) || (mPopulation == 0))
+  {
+    return 0;
+  }
+  buildTree();
+  return countBefore(iMax + 1, jMax + 1) - countBefore(iMin, jMax + 1) -
+    countBefore(iMax + 1, jMin) + countBefore(iMin, jMin);
+}
+
+size_t BasicBoard::getRowBytes() const
+{
+  // std::vector<bool> packs bits into whole machine words, and make_shared
+  // puts it in one block with its use counts.
+  size_t wordBits = 8 * sizeof(unsigned long);
+  return sizeof(shared_ptr<Row>) + sizeof(Row) + 2 * sizeof(long) +
+    ((mColumns + wordBits - 1) / wordBits) * sizeof(unsigned long);
+}
+
+size_t BasicBoard::getMemoryUsage() const
+{
+  return sizeof(*this) + mRows * getRowBytes() + mTree.capacity() * sizeof(int32_t);
+}
+
+size_t BasicBoard::compact()
+{
+  size_t before = getMemoryUsage();
+  vector<int32_t>().swap(mTree);
+  mTreeDirty = true;
+  return before - getMemoryUsage();
 }
 
 bool BasicBoard::getFirstLiveCell(CellIndex& i, CellIndex& j) const
@@ -100,7 +376,7 @@ bool BasicBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
     {
         for (; j < mColumns; j++)
         {
-            if (mBoard[i][j])
+            if ((*mBoard[i])[j])
             {
                 return true;
             }
@@ -113,11 +389,59 @@ bool BasicBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
 
 void BasicBoard::clearBoard()
 {
-    for (CellIndex i = 0; i < mRows; i++)
+    mPopulation = 0;
+    mBox.reset();
+    mTreeDirty = true;
+    for (shared_ptr<Row>& row : mBoard)
     {
-        for (CellIndex j = 0; j < mColumns; j++)
+        if (isShared(row))
+        {
+            row = make_shared<Row>(mColumns, false);
+        }
+        else
         {
-            mBoard[i][j] = false;
+            fill(row->begin(), row->end(), false);
         }
     }
+}
+
+void BasicBoard::shareRows(BasicBoard& copy) const
+{
+  // Find the bounding box first, so that the copy never has to.
+  CellIndex iMin, jMin, iMax, jMax;
+  getBoundingBox(iMin, jMin, iMax, jMax);
+
+  copy.mRows = mRows;
+  copy.mColumns = mColumns;
+  copy.mBoard = mBoard;
+  copy.mPopulation = mPopulation;
+  copy.mBox = mBox;
+}
+
+shared_ptr<const Board> BasicBoard::snapshot() const
+{
+  shared_ptr<FrozenBasicBoard> copy = make_shared<FrozenBasicBoard>();
+  shareRows(*copy);
+  return copy;
+}
+
+FrozenBasicBoard::FrozenBasicBoard() :
+  BasicBoard(0, 0)
+{
+}
+
+int64_t FrozenBasicBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+  iMin = max<CellIndex>(iMin, 0);
+  jMin = max<CellIndex>(jMin, 0);
+  iMax = min<CellIndex>(iMax, mRows - 1);
+  jMax = min<CellIndex>(jMax, mColumns - 1);
+
+  int64_t count = 0;
+  for (CellIndex i = iMin; (i <= iMax) && (jMin <= jMax); i++)
+  {
+    const Row& row = *mBoard[i];
+    count += std::count(row.begin() + jMin, row.begin() + jMax + 1, true);
+  }
+  return count;
 }
\ No newline at end of file
@@ -1,11 +1,24 @@
 #include "Board.h"
+#include "BitLife.h"
+#include "FrozenBoard.h"
 
 #include <algorithm>
 #include <assert.h>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
-Board::Board()
+const int64_t Board::MAX_LIGHT_CONE_SIDE;
+const int64_t Board::MAX_LIGHT_CONE_CELLS;
+
+Board::Board() :
+    mInstrumentation(NULL),
+    mChangeSet(NULL),
+    mPeakMemory(0),
+    mMemoryBudget(0),
+    mBudgetPolicy(BUDGET_FAIL)
 {
 }
 
@@ -13,6 +26,14 @@ Board::~Board()
 {
 }
 
+void Board::setCells(const CellCoord* cells, size_t count)
+{
+    for (size_t c = 0; c < count; c++)
+    {
+        setCell(cells[c].first, cells[c].second, true);
+    }
+}
+
 bool Board::loadBoard(const std::string& fileName)
 {
     clearBoard();
@@ -25,6 +46,7 @@ bool Board::loadBoard(const std::string& fileName)
     }
 
     // assuming line isn't malformed
+    std::vector<CellCoord> cells;
     while (!inFile.eof())
     {
 		std::string line;
@@ -42,29 +64,36 @@ bool Board::loadBoard(const std::string& fileName)
 
         std::string xStr = line.substr(start1, end1 - start1);
         std::string yStr = line.substr(start2);
-        CellIndex x = _atoi64(xStr.c_str());
-        CellIndex y = _atoi64(yStr.c_str());
+        CellIndex x = strtoll(xStr.c_str(), NULL, 10);
+        CellIndex y = strtoll(yStr.c_str(), NULL, 10);
 
-        setCell(y, x, true);
+        cells.push_back(CellCoord(y, x));
     }
 
     inFile.close();
 
+    setCells(cells.data(), cells.size());
+
     return true;
 }
 
-bool Board::writeBoard(const std::string& fileName)
+bool Board::writeBoard(const std::string& fileName) const
 {
     std::ofstream outFile(fileName.c_str());
+    if (!outFile.is_open())
+    {
+        std::cerr << "Failed to open " << fileName << std::endl;
+        return false;
+    }
 
     CellIndex i, j;
     if (getFirstLiveCell(i, j))
     {
         outFile << "(" << j << "," << i << ")" << std::endl;
-    }
-    while (getNextLiveCell(i, j))
-    {
-        outFile << "(" << j << "," << i << ")" << std::endl;
+        while (getNextLiveCell(i, j))
+        {
+            outFile << "(" << j << "," << i << ")" << std::endl;
+        }
     }
 
     outFile.close();
@@ -75,11 +104,18 @@ bool Board::writeBoard(const std::string& fileName)
 bool Board::matches(const Board& other) const
 {
   CellIndex i1, j1, i2, j2;
-  if (getFirstLiveCell(i1, j1) != other.getFirstLiveCell(i2, j2))
+  bool getThisFirst = getFirstLiveCell(i1, j1);
+  if (getThisFirst != other.getFirstLiveCell(i2, j2))
   {
       return false;
   }
 
+  // no live cells in either one.
+  if (!getThisFirst)
+  {
+      return true;
+  }
+
   while ((i1 == i2) && (j1 == j2))
   {
       bool getThis = getNextLiveCell(i1, j1);
@@ -101,7 +137,138 @@ bool Board::matches(const Board& other) const
   return false;
 }
 
-const int8_t* Board::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height)
+int64_t Board::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+    int64_t count = 0;
+    CellIndex i, j;
+    if (getFirstLiveCell(i, j))
+    {
+        do
+        {
+            count += (i >= iMin) && (i <= iMax) && (j >= jMin) && (j <= jMax);
+        } while (getNextLiveCell(i, j));
+    }
+    return count;
+}
+
+bool Board::getLimits(CellIndex&, CellIndex&, CellIndex&, CellIndex&) const
+{
+    return false;
+}
+
+bool Board::getFutureWindow(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax,
+    int64_t generations, std::vector<CellCoord>& cells) const
+{
+    cells.clear();
+    if ((iMin > iMax) || (jMin > jMax))
+    {
+        return true;
+    }
+
+    // Check the size of the cone before working in ints, which is what
+    // getBitmap() takes. Differences are taken unsigned so that they can't
+    // overflow however far apart the corners are.
+    int64_t t = std::max<int64_t>(generations, 0);
+    uint64_t rows = static_cast<uint64_t>(iMax) - static_cast<uint64_t>(iMin) + 1;
+    uint64_t columns = static_cast<uint64_t>(jMax) - static_cast<uint64_t>(jMin) + 1;
+    const uint64_t maxSide = static_cast<uint64_t>(MAX_LIGHT_CONE_SIDE);
+    if ((static_cast<uint64_t>(t) >= maxSide / 2) || (rows > maxSide - 2 * t) || (columns > maxSide - 2 * t) ||
+        ((rows + 2 * t) * (columns + 2 * t) > static_cast<uint64_t>(MAX_LIGHT_CONE_CELLS)))
+    {
+        std::cerr << "Light cone of a " << rows << " by " << columns << " window over " << t
+                  << " generations is too large" << std::endl;
+        return false;
+    }
+
+    // The light cone at the start: row r and column c of it are cell
+    // (top + r, left + c).
+    CellIndex top = iMin - t;
+    CellIndex left = jMin - t;
+    int height = static_cast<int>(rows + 2 * t);
+    int width = static_cast<int>(columns + 2 * t);
+    size_t words = static_cast<size_t>((width + BITS_PER_WORD - 1) / BITS_PER_WORD);
+
+    // Cells of the cone that a bounded board can't hold stay dead.
+    CellIndex rowFirst = 0, rowLast = height - 1;
+    CellIndex columnFirst = 0, columnLast = width - 1;
+    CellIndex limitIMin, limitJMin, limitIMax, limitJMax;
+    if (getLimits(limitIMin, limitJMin, limitIMax, limitJMax))
+    {
+        rowFirst = std::max(rowFirst, limitIMin - top);
+        rowLast = std::min(rowLast, limitIMax - top);
+        columnFirst = std::max(columnFirst, limitJMin - left);
+        columnLast = std::min(columnLast, limitJMax - left);
+        if ((rowFirst > rowLast) || (columnFirst > columnLast))
+        {
+            return true;
+        }
+    }
+    std::vector<uint64_t> columnMask(words, 0);
+    for (size_t w = static_cast<size_t>(columnFirst / BITS_PER_WORD); w <= static_cast<size_t>(columnLast / BITS_PER_WORD); w++)
+    {
+        CellIndex first = std::max<CellIndex>(columnFirst - w * BITS_PER_WORD, 0);
+        CellIndex last = std::min<CellIndex>(columnLast - w * BITS_PER_WORD, BITS_PER_WORD - 1);
+        columnMask[w] = bitRange(static_cast<int>(first), static_cast<int>(last));
+    }
+
+    // Bitmap bytes hold cells in the same bit order as packed words.
+    std::vector<uint64_t> now(height * words, 0);
+    std::vector<uint64_t> next(height * words, 0);
+    int bitmapWidth = width, bitmapHeight = height;
+    const int8_t* bitmap = getBitmap(top, left, bitmapWidth, bitmapHeight);
+    int bw = bitmapWidth / 8;
+    for (CellIndex r = rowFirst; r <= rowLast; r++)
+    {
+        uint64_t* row = &now[r * words];
+        for (int b = 0; b < bw; b++)
+        {
+            row[b / 8] |= uint64_t(static_cast<uint8_t>(bitmap[r * bw + b])) << (8 * (b % 8));
+        }
+        for (size_t w = 0; w < words; w++)
+        {
+            row[w] &= columnMask[w];
+        }
+    }
+    delete[] bitmap;
+
+    // After g generations only cells at least g from the edge of the cone
+    // are right, and only they are computed. Each needs its neighbors from
+    // the generation before, which were right then; anything the edges of
+    // a word range get wrong lies outside the cone.
+    for (int64_t g = 1; g <= t; g++)
+    {
+        CellIndex r0 = std::max<CellIndex>(g, rowFirst);
+        CellIndex r1 = std::min<CellIndex>(height - 1 - g, rowLast);
+        size_t w0 = static_cast<size_t>((g - 1) / BITS_PER_WORD);
+        size_t w1 = std::min(static_cast<size_t>((width - g) / BITS_PER_WORD), words - 1);
+        for (CellIndex r = r0; r <= r1; r++)
+        {
+            uint64_t* out = &next[r * words];
+            lifeRow(&now[(r - 1) * words + w0], &now[r * words + w0], &now[(r + 1) * words + w0],
+                out + w0, w1 - w0 + 1);
+            for (size_t w = w0; w <= w1; w++)
+            {
+                out[w] &= columnMask[w];
+            }
+        }
+        now.swap(next);
+    }
+
+    for (CellIndex r = t; r <= t + iMax - iMin; r++)
+    {
+        const uint64_t* row = &now[r * words];
+        for (CellIndex c = t; c <= t + jMax - jMin; c++)
+        {
+            if ((row[c / BITS_PER_WORD] >> (c % BITS_PER_WORD)) & 1)
+            {
+                cells.push_back(CellCoord(top + r, left + c));
+            }
+        }
+    }
+    return true;
+}
+
+const int8_t* Board::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
 {
     // round width up to nearest 8 (bits)
     if (width % 8 != 0)
@@ -130,4 +297,140 @@ const int8_t* Board::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width,
     }
 
     return bitmap;
+}
+
+std::shared_ptr<const Board> Board::snapshot() const
+{
+    std::vector<CellCoord> cells;
+    cells.reserve(static_cast<size_t>(getPopulation()));
+    CellIndex i, j;
+    if (getFirstLiveCell(i, j))
+    {
+        do
+        {
+            cells.push_back(CellCoord(i, j));
+        } while (getNextLiveCell(i, j));
+    }
+    return std::make_shared<FrozenBoard>(cells);
+}
+
+void Board::setInstrumentation(Instrumentation* instrumentation)
+{
+    mInstrumentation = instrumentation;
+}
+
+Instrumentation* Board::getInstrumentation() const
+{
+    return mInstrumentation;
+}
+
+void Board::setChangeSet(std::vector<ChangeSpan>* changes)
+{
+    mChangeSet = changes;
+}
+
+std::vector<ChangeSpan>* Board::getChangeSet() const
+{
+    return mChangeSet;
+}
+
+void Board::getChangedCells(const std::vector<ChangeSpan>& changes, std::vector<CellCoord>& cells)
+{
+    for (size_t s = 0; s < changes.size(); s++)
+    {
+        for (uint64_t mask = changes[s].mask; mask != 0; mask &= mask - 1)
+        {
+            cells.push_back(CellCoord(changes[s].i, changes[s].j + countTrailingZeros(mask)));
+        }
+    }
+}
+
+void Board::sortChangeSet()
+{
+    std::vector<ChangeSpan>& changes = *mChangeSet;
+    std::sort(changes.begin(), changes.end(), [](const ChangeSpan& a, const ChangeSpan& b)
+        {
+            return (a.i < b.i) || ((a.i == b.i) && (a.j < b.j));
+        });
+
+    // Spans found apart may overlap; if so, build them again cell by cell.
+    bool overlap = false;
+    for (size_t s = 1; !overlap && (s < changes.size()); s++)
+    {
+        overlap = (changes[s].i == changes[s - 1].i) &&
+            (static_cast<uint64_t>(changes[s].j) - static_cast<uint64_t>(changes[s - 1].j) < 64);
+    }
+    if (overlap)
+    {
+        std::vector<CellCoord> cells;
+        getChangedCells(changes, cells);
+        std::sort(cells.begin(), cells.end());
+        changes.clear();
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            addChange(changes, cells[c].first, cells[c].second);
+        }
+    }
+}
+
+void Board::notePeakMemory(size_t bytes)
+{
+    mPeakMemory = std::max(mPeakMemory, bytes);
+}
+
+size_t Board::estimateUpdateMemory() const
+{
+    return 2 * getMemoryUsage();
+}
+
+size_t Board::compact()
+{
+    return 0;
+}
+
+size_t Board::getPeakMemoryUsage() const
+{
+    return std::max(mPeakMemory, getMemoryUsage());
+}
+
+void Board::resetPeakMemoryUsage()
+{
+    mPeakMemory = getMemoryUsage();
+}
+
+void Board::setMemoryBudget(size_t bytes, MemoryBudgetPolicy policy, const std::string& dumpFile)
+{
+    mMemoryBudget = bytes;
+    mBudgetPolicy = policy;
+    mDumpFile = dumpFile;
+}
+
+bool Board::tryUpdate()
+{
+    if (mMemoryBudget > 0)
+    {
+        size_t estimate = estimateUpdateMemory();
+        if ((estimate > mMemoryBudget) && (mBudgetPolicy == BUDGET_COMPACT))
+        {
+            compact();
+            estimate = estimateUpdateMemory();
+        }
+
+        if (estimate > mMemoryBudget)
+        {
+            std::cerr << "Update would use about " << estimate
+                      << " bytes, over memory budget of " << mMemoryBudget << std::endl;
+            if (mBudgetPolicy == BUDGET_DUMP)
+            {
+                if (writeBoard(mDumpFile))
+                {
+                    std::cerr << "Board dumped to " << mDumpFile << std::endl;
+                }
+            }
+            return false;
+        }
+    }
+
+    update();
+    return true;
 }
\ No newline at end of file
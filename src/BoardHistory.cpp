@@ -0,0 +1,308 @@
+#include "BoardHistory.h"
+#include "CellCodec.h"
+#include <assert.h>
+#include <set>
+
+using namespace std;
+
+BoardHistory::BoardHistory(Board* board, uint64_t keyframeInterval, size_t memoryCap)
+{
+    mBoard = board;
+    mKeyframeInterval = (keyframeInterval > 0) ? keyframeInterval : 1;
+    mMemoryCap = memoryCap;
+    reset();
+}
+
+void BoardHistory::reset()
+{
+    mFrames.clear();
+    vector<CellCoord> cells;
+    getLiveCells(*mBoard, cells);
+
+    Frame frame;
+    frame.generation = 0;
+    frame.isKeyframe = true;
+    encodeCells(cells, frame.keyframe);
+    frame.keyframe.shrink_to_fit();
+    mFrames.push_back(frame);
+
+    mCurrent = 0;
+    mBytes = getFrameBytes(mFrames.back());
+}
+
+BoardHistory::Frame& BoardHistory::getFrame(uint64_t generation)
+{
+    assert((generation >= getFirstGeneration()) && (generation <= getLastGeneration()));
+    return mFrames[static_cast<size_t>(generation - getFirstGeneration())];
+}
+
+size_t BoardHistory::getFrameBytes(const Frame& frame)
+{
+    return sizeof(Frame) + frame.delta.capacity() + frame.keyframe.capacity();
+}
+
+size_t BoardHistory::getMemoryUsage() const
+{
+    return sizeof(*this) + mBytes + mChanges.capacity() * sizeof(ChangeSpan);
+}
+
+void BoardHistory::applyToggles(const vector<uint8_t>& encoded, bool noteChanges)
+{
+    vector<CellCoord> cells;
+    decodeCells(encoded.data(), encoded.size(), cells);
+    vector<ChangeSpan>* changes = noteChanges ? mBoard->getChangeSet() : NULL;
+    if (changes)
+    {
+        changes->clear();
+    }
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        CellIndex i = cells[c].first;
+        CellIndex j = cells[c].second;
+        mBoard->setCell(i, j, !mBoard->getCell(i, j));
+        if (changes)
+        {
+            Board::addChange(*changes, i, j);
+        }
+    }
+}
+
+void BoardHistory::reconstruct(uint64_t generation, vector<CellCoord>& cells)
+{
+    uint64_t keyGeneration = generation;
+    while (!getFrame(keyGeneration).isKeyframe)
+    {
+        keyGeneration--;
+    }
+
+    cells.clear();
+    const vector<uint8_t>& keyframe = getFrame(keyGeneration).keyframe;
+    decodeCells(keyframe.data(), keyframe.size(), cells);
+    if (keyGeneration == generation)
+    {
+        return;
+    }
+
+    set<CellCoord> live(cells.begin(), cells.end());
+    vector<CellCoord> toggled;
+    for (uint64_t g = keyGeneration + 1; g <= generation; g++)
+    {
+        const vector<uint8_t>& delta = getFrame(g).delta;
+        toggled.clear();
+        decodeCells(delta.data(), delta.size(), toggled);
+        for (size_t c = 0; c < toggled.size(); c++)
+        {
+            if (!live.insert(toggled[c]).second)
+            {
+                live.erase(toggled[c]);
+            }
+        }
+    }
+    cells.assign(live.begin(), live.end());
+}
+
+void BoardHistory::addFrame(const vector<CellCoord>& toggled)
+{
+    Frame frame;
+    frame.generation = getLastGeneration() + 1;
+    frame.isKeyframe = (frame.generation % mKeyframeInterval == 0);
+
+    encodeCells(toggled, frame.delta);
+    frame.delta.shrink_to_fit();
+    if (frame.isKeyframe)
+    {
+        vector<CellCoord> cells;
+        getLiveCells(*mBoard, cells);
+        encodeCells(cells, frame.keyframe);
+        frame.keyframe.shrink_to_fit();
+    }
+
+    mFrames.push_back(frame);
+    mBytes += getFrameBytes(mFrames.back());
+
+    enforceMemoryCap();
+}
+
+void BoardHistory::record()
+{
+    if (mCurrent < getLastGeneration())
+    {
+        // The board was updated from an earlier generation, so the future
+        // recorded after it no longer applies.
+        while (getLastGeneration() > mCurrent)
+        {
+            mBytes -= getFrameBytes(mFrames.back());
+            mFrames.pop_back();
+        }
+    }
+
+    vector<CellCoord> previous, cells, toggled;
+    reconstruct(mCurrent, previous);
+    getLiveCells(*mBoard, cells);
+    diffCells(previous, cells, toggled);
+    addFrame(toggled);
+    mCurrent = getLastGeneration();
+}
+
+void BoardHistory::step()
+{
+    if (mCurrent < getLastGeneration())
+    {
+        applyToggles(getFrame(mCurrent + 1).delta, true);
+        mCurrent++;
+        return;
+    }
+
+    // Have the board list the cells it changes, unless it already does for
+    // someone else, instead of comparing all of its cells afterwards.
+    vector<ChangeSpan>* changes = mBoard->getChangeSet();
+    if (!changes)
+    {
+        mBoard->setChangeSet(&mChanges);
+    }
+    mBoard->update();
+    mBoard->setChangeSet(changes);
+
+    vector<CellCoord> toggled;
+    Board::getChangedCells(changes ? *changes : mChanges, toggled);
+    addFrame(toggled);
+    mCurrent = getLastGeneration();
+}
+
+bool BoardHistory::stepBack()
+{
+    if (mCurrent <= getFirstGeneration())
+    {
+        return false;
+    }
+    applyToggles(getFrame(mCurrent).delta, true);
+    mCurrent--;
+    return true;
+}
+
+bool BoardHistory::seek(uint64_t generation)
+{
+    if ((generation < getFirstGeneration()) || (generation > getLastGeneration()))
+    {
+        return false;
+    }
+
+    // Estimate the cost of each route by the bytes it has to decode:
+    // stepping directly from the current generation, or loading the nearest
+    // keyframe before or after the target and stepping from there.
+    uint64_t from = min(mCurrent, generation);
+    uint64_t to = max(mCurrent, generation);
+    size_t directCost = 0;
+    for (uint64_t g = from + 1; g <= to; g++)
+    {
+        directCost += getFrame(g).delta.size();
+    }
+
+    size_t keyCost = 0;
+    uint64_t keyGeneration = generation;
+    while (!getFrame(keyGeneration).isKeyframe)
+    {
+        keyCost += getFrame(keyGeneration).delta.size();
+        keyGeneration--;
+    }
+    keyCost += getFrame(keyGeneration).keyframe.size();
+
+    size_t laterKeyCost = 0;
+    uint64_t laterKeyGeneration = generation;
+    while ((laterKeyGeneration < getLastGeneration()) && !getFrame(laterKeyGeneration).isKeyframe)
+    {
+        laterKeyGeneration++;
+        laterKeyCost += getFrame(laterKeyGeneration).delta.size();
+    }
+    bool hasLaterKey = getFrame(laterKeyGeneration).isKeyframe;
+    laterKeyCost += getFrame(laterKeyGeneration).keyframe.size();
+
+    if (hasLaterKey && (laterKeyCost < keyCost))
+    {
+        keyCost = laterKeyCost;
+        keyGeneration = laterKeyGeneration;
+    }
+
+    if (keyCost < directCost)
+    {
+        vector<CellCoord> cells;
+        const vector<uint8_t>& keyframe = getFrame(keyGeneration).keyframe;
+        decodeCells(keyframe.data(), keyframe.size(), cells);
+        mBoard->clearBoard();
+        mBoard->setCells(cells.data(), cells.size());
+        mCurrent = keyGeneration;
+    }
+
+    while (mCurrent < generation)
+    {
+        applyToggles(getFrame(mCurrent + 1).delta, false);
+        mCurrent++;
+    }
+    while (mCurrent > generation)
+    {
+        applyToggles(getFrame(mCurrent).delta, false);
+        mCurrent--;
+    }
+    return true;
+}
+
+void BoardHistory::enforceMemoryCap()
+{
+    while ((mMemoryCap > 0) && (mBytes > mMemoryCap) && (mFrames.size() > 1))
+    {
+        // First thin out keyframes in the older half of the history,
+        // dropping every other one so that their spacing doubles.
+        vector<size_t> keyframes;
+        for (size_t f = 1; f < mFrames.size() / 2; f++)
+        {
+            if (mFrames[f].isKeyframe)
+            {
+                keyframes.push_back(f);
+            }
+        }
+        bool thinned = false;
+        for (size_t k = 1; k < keyframes.size(); k += 2)
+        {
+            Frame& frame = mFrames[keyframes[k]];
+            mBytes -= getFrameBytes(frame);
+            vector<uint8_t>().swap(frame.keyframe);
+            frame.isKeyframe = false;
+            mBytes += getFrameBytes(frame);
+            thinned = true;
+        }
+        if (thinned)
+        {
+            continue;
+        }
+
+        // Then drop the oldest generations, up to the next keyframe or, if
+        // there is none, up to a new keyframe made halfway through.
+        size_t newFirst = keyframes.empty() ? mFrames.size() / 2 : keyframes[0];
+        uint64_t newFirstGeneration = mFrames[newFirst].generation;
+        if ((newFirst == 0) || (newFirstGeneration > mCurrent))
+        {
+            break;
+        }
+
+        Frame& first = mFrames[newFirst];
+        if (!first.isKeyframe)
+        {
+            vector<CellCoord> cells;
+            reconstruct(newFirstGeneration, cells);
+            mBytes -= getFrameBytes(first);
+            encodeCells(cells, first.keyframe);
+            first.keyframe.shrink_to_fit();
+            first.isKeyframe = true;
+            mBytes += getFrameBytes(first);
+        }
+        mBytes -= getFrameBytes(first);
+        vector<uint8_t>().swap(first.delta);
+        mBytes += getFrameBytes(first);
+
+        for (size_t f = 0; f < newFirst; f++)
+        {
+            mBytes -= getFrameBytes(mFrames.front());
+            mFrames.pop_front();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#include "CellCodec.h"
+
+using namespace std;
+
+/// Append a variable-length integer, 7 bits per byte, low bits first.
+static void writeVarint(uint64_t value, vector<uint8_t>& out)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/// Read a variable-length integer at data[pos], advancing pos.
+/// @return false if the data ends early or the value is too long.
+static bool readVarint(const uint8_t* data, size_t size, size_t& pos, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= size)
+        {
+            return false;
+        }
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Map signed to unsigned so that small magnitudes stay small.
+static uint64_t zigzag(uint64_t value)
+{
+    return (value << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+static uint64_t unzigzag(uint64_t value)
+{
+    return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+void encodeCells(const vector<CellCoord>& cells, vector<uint8_t>& out)
+{
+    // Differences are taken as unsigned so that they wrap instead of
+    // overflowing across the full 64-bit range.
+    uint64_t prevI = 0, prevJ = 0;
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        uint64_t i = static_cast<uint64_t>(cells[c].first);
+        uint64_t j = static_cast<uint64_t>(cells[c].second);
+        uint64_t rowStep = i - prevI;
+        writeVarint(rowStep, out);
+        if ((rowStep == 0) && (c > 0))
+        {
+            // Same row; columns always increase.
+            writeVarint(j - prevJ - 1, out);
+        }
+        else
+        {
+            writeVarint(zigzag(j - prevJ), out);
+        }
+        prevI = i;
+        prevJ = j;
+    }
+}
+
+bool decodeCells(const uint8_t* data, size_t size, vector<CellCoord>& cells)
+{
+    uint64_t prevI = 0, prevJ = 0;
+    size_t pos = 0;
+    bool first = true;
+    while (pos < size)
+    {
+        uint64_t rowStep, columnStep;
+        if (!readVarint(data, size, pos, rowStep) || !readVarint(data, size, pos, columnStep))
+        {
+            return false;
+        }
+
+        uint64_t i = prevI + rowStep;
+        uint64_t j;
+        if ((rowStep == 0) && !first)
+        {
+            j = prevJ + columnStep + 1;
+        }
+        else
+        {
+            j = prevJ + unzigzag(columnStep);
+        }
+        cells.push_back(CellCoord(static_cast<CellIndex>(i), static_cast<CellIndex>(j)));
+        prevI = i;
+        prevJ = j;
+        first = false;
+    }
+    return true;
+}
+
+void getLiveCells(const Board& board, vector<CellCoord>& cells)
+{
+    cells.clear();
+    CellIndex i, j;
+    if (board.getFirstLiveCell(i, j))
+    {
+        do
+        {
+            cells.push_back(CellCoord(i, j));
+        } while (board.getNextLiveCell(i, j));
+    }
+}
+
+void diffCells(const vector<CellCoord>& before, const vector<CellCoord>& after,
+    vector<CellCoord>& toggled)
+{
+    toggled.clear();
+    size_t b = 0, a = 0;
+    while ((b < before.size()) && (a < after.size()))
+    {
+        if (before[b] < after[a])
+        {
+            toggled.push_back(before[b++]);
+        }
+        else if (after[a] < before[b])
+        {
+            toggled.push_back(after[a++]);
+        }
+        else
+        {
+            b++;
+            a++;
+        }
+    }
+    toggled.insert(toggled.end(), before.begin() + b, before.end());
+    toggled.insert(toggled.end(), after.begin() + a, after.end());
+}
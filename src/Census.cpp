@@ -0,0 +1,642 @@
+#include "Census.h"
+#include "BoundedQueue.h"
+#include "BoundingBox.h"
+#include "CellCodec.h"
+#include "SparseBoard.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <thread>
+
+using namespace std;
+
+const char* const Census::UNSETTLED = "UNSETTLED";
+
+/// Items each queue between stages may hold.
+static const size_t QUEUE_CAPACITY = 256;
+
+/// Stages of the pipeline, in order.
+enum CensusStage
+{
+    STAGE_GENERATE = 0,
+    STAGE_RUN,
+    STAGE_SPLIT,
+    STAGE_NAME,
+    STAGE_TALLY
+};
+
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Mix the bits of a word, so that nearby inputs give unrelated outputs.
+static uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/// Hash of the live cells of a board, which doesn't depend on their order.
+static uint64_t hashBoard(const Board& board)
+{
+    uint64_t hash = 0;
+    CellIndex i, j;
+    if (board.getFirstLiveCell(i, j))
+    {
+        do
+        {
+            hash += mix(mix(static_cast<uint64_t>(i)) ^ static_cast<uint64_t>(j));
+        } while (board.getNextLiveCell(i, j));
+    }
+    return hash;
+}
+
+/// Get cells moved so that their bounding box starts at (0, 0).
+static void normalizeCells(const vector<CellCoord>& cells, vector<CellCoord>& out,
+    CellIndex& iMin, CellIndex& jMin)
+{
+    BoundingBox box;
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        box.include(cells[c].first, cells[c].second);
+    }
+    iMin = box.iMin;
+    jMin = box.jMin;
+    out.resize(cells.size());
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        out[c] = CellCoord(cells[c].first - iMin, cells[c].second - jMin);
+    }
+}
+
+/// Gap in cells between two boxes, along whichever axis it is larger.
+static CellIndex getGap(const BoundingBox& a, const BoundingBox& b)
+{
+    CellIndex rowGap = max(a.iMin - b.iMax, b.iMin - a.iMax);
+    CellIndex columnGap = max(a.jMin - b.jMax, b.jMin - a.jMax);
+    return max(rowGap, columnGap);
+}
+
+Census::Options::Options() :
+    seed(1),
+    soups(1000),
+    soupSize(16),
+    density(50),
+    maxGenerations(10000),
+    runThreads(max(1, static_cast<int>(thread::hardware_concurrency()))),
+    createBoard([]() -> Board* { return new SparseBoard(); })
+{
+}
+
+Census::Census(const Options& options) :
+    mOptions(options),
+    mSeconds(0)
+{
+    static const char* const names[] = { "generate", "run", "split", "name", "count" };
+    for (int s = 0; s < STAGES; s++)
+    {
+        mStages[s].name = names[s];
+        mStages[s].threads = (s == STAGE_RUN) ? max(mOptions.runThreads, 1) : 1;
+        mStages[s].items = 0;
+        mStages[s].busySeconds = 0;
+    }
+}
+
+void Census::addStageTime(int stage, uint64_t items, double seconds)
+{
+    lock_guard<mutex> lock(mStatsMutex);
+    mStages[stage].items += items;
+    mStages[stage].busySeconds += seconds;
+}
+
+void Census::generateSoup(uint64_t index, Soup& soup) const
+{
+    seed_seq seeds = { static_cast<uint32_t>(mOptions.seed), static_cast<uint32_t>(mOptions.seed >> 32),
+        static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32) };
+    mt19937_64 random(seeds);
+
+    soup.index = index;
+    soup.cells.clear();
+    for (CellIndex i = 0; i < mOptions.soupSize; i++)
+    {
+        for (CellIndex j = 0; j < mOptions.soupSize; j++)
+        {
+            if (static_cast<int>(random() % 100) < mOptions.density)
+            {
+                soup.cells.push_back(CellCoord(i, j));
+            }
+        }
+    }
+}
+
+const Census::Motion& Census::findMotion(const vector<CellCoord>& cells, MotionCache& cache) const
+{
+    vector<CellCoord> start;
+    CellIndex iStart, jStart;
+    normalizeCells(cells, start, iStart, jStart);
+    auto cached = cache.find(start);
+    if (cached != cache.end())
+    {
+        return cached->second;
+    }
+
+    Motion& motion = cache[start];
+    motion.period = 0;
+    motion.di = 0;
+    motion.dj = 0;
+    motion.phases.assign(1, start);
+
+    unique_ptr<Board> alone(mOptions.createBoard());
+    alone->setCells(start.data(), start.size());
+    vector<CellCoord> shape, now;
+    CellIndex iNow, jNow;
+    for (int period = 1; period <= MAX_SHIP_PERIOD; period++)
+    {
+        alone->update();
+        getLiveCells(*alone, now);
+        normalizeCells(now, shape, iNow, jNow);
+        if (shape == start)
+        {
+            motion.period = period;
+            motion.di = iNow;
+            motion.dj = jNow;
+            return motion;
+        }
+        motion.phases.push_back(now);
+    }
+    return motion;
+}
+
+void Census::removeShips(Board& board, MotionCache& cache, vector<ObjectPhases>& ships) const
+{
+    // Cells up to 2 apart can bring the same cell to life, so they are one
+    // object here: some phases of spaceships, such as the LWSS's, have a
+    // cell that touches none of the others.
+    vector<CellCoord> cells;
+    getLiveCells(board, cells);
+    vector<vector<CellCoord> > objects;
+    findComponents(cells, objects, 2);
+
+    vector<BoundingBox> boxes(objects.size());
+    for (size_t o = 0; o < objects.size(); o++)
+    {
+        for (size_t c = 0; c < objects[o].size(); c++)
+        {
+            boxes[o].include(objects[o][c].first, objects[o][c].second);
+        }
+    }
+
+    // Motions are found only when needed, as running large objects on
+    // their own takes a while.
+    vector<const Motion*> motions(objects.size(), NULL);
+    auto getMotion = [&](size_t o) -> const Motion&
+    {
+        if (!motions[o])
+        {
+            motions[o] = &findMotion(objects[o], cache);
+        }
+        return *motions[o];
+    };
+
+    for (size_t o = 0; o < objects.size(); o++)
+    {
+        // The ship has escaped if every other object either flies along
+        // with it, or is far from it and not getting any closer, taking
+        // each object to go on as it would on its own. Objects close by
+        // are checked first, since any of them that isn't a spaceship
+        // settles it.
+        bool escaped = true;
+        for (size_t other = 0; escaped && (other < objects.size()); other++)
+        {
+            if ((other != o) && (getGap(boxes[o], boxes[other]) < SHIP_ESCAPE_GAP))
+            {
+                escaped = getMotion(other).isShip();
+            }
+        }
+        if (!escaped || !getMotion(o).isShip())
+        {
+            continue;
+        }
+
+        const Motion& ship = getMotion(o);
+        for (size_t other = 0; escaped && (other < objects.size()); other++)
+        {
+            if (other == o)
+            {
+                continue;
+            }
+            const Motion& motion = getMotion(other);
+            CellIndex gap = getGap(boxes[o], boxes[other]);
+            if (gap < SHIP_ESCAPE_GAP)
+            {
+                escaped = motion.isShip() && (motion.period == ship.period) &&
+                    (motion.di == ship.di) && (motion.dj == ship.dj);
+                continue;
+            }
+
+            // Compare after a time in which both come back to their shapes.
+            // Since both move in straight lines, a gap that doesn't shrink
+            // over that time never shrinks.
+            CellIndex otherPeriod = max(motion.period, 1);
+            CellIndex shipShift = otherPeriod;
+            CellIndex otherShift = motion.isShip() ? ship.period : 0;
+            BoundingBox shipAfter, otherAfter;
+            shipAfter.include(boxes[o].iMin + ship.di * shipShift, boxes[o].jMin + ship.dj * shipShift);
+            shipAfter.include(boxes[o].iMax + ship.di * shipShift, boxes[o].jMax + ship.dj * shipShift);
+            otherAfter.include(boxes[other].iMin + motion.di * otherShift, boxes[other].jMin + motion.dj * otherShift);
+            otherAfter.include(boxes[other].iMax + motion.di * otherShift, boxes[other].jMax + motion.dj * otherShift);
+            escaped = (getGap(shipAfter, otherAfter) >= gap);
+        }
+
+        if (escaped)
+        {
+            for (size_t c = 0; c < objects[o].size(); c++)
+            {
+                board.setCell(objects[o][c].first, objects[o][c].second, false);
+            }
+            ships.push_back(ship.phases);
+            ObjectPhases& phases = ships.back();
+            for (size_t p = 0; p < phases.size(); p++)
+            {
+                for (size_t c = 0; c < phases[p].size(); c++)
+                {
+                    phases[p][c].first += boxes[o].iMin;
+                    phases[p][c].second += boxes[o].jMin;
+                }
+            }
+        }
+    }
+}
+
+void Census::runSoup(const Soup& soup, Ash& ash) const
+{
+    unique_ptr<Board> board(mOptions.createBoard());
+    board->setCells(soup.cells.data(), soup.cells.size());
+
+    // Hashes of the last MAX_PERIOD generations, oldest first. The ash
+    // repeats once the current hash is among them.
+    deque<uint64_t> hashes;
+    MotionCache motions;
+    for (uint64_t g = 0; g <= mOptions.maxGenerations; g++)
+    {
+        uint64_t hash = hashBoard(*board);
+        for (size_t p = 1; p <= hashes.size(); p++)
+        {
+            if (hashes[hashes.size() - p] == hash)
+            {
+                ash.settled = true;
+                ash.phases.resize(p);
+                for (size_t phase = 0; phase < p; phase++)
+                {
+                    getLiveCells(*board, ash.phases[phase]);
+                    board->update();
+                }
+                return;
+            }
+        }
+        hashes.push_back(hash);
+        if (hashes.size() > MAX_PERIOD)
+        {
+            hashes.pop_front();
+        }
+
+        if ((g > 0) && (g % SHIP_CHECK_INTERVAL == 0))
+        {
+            size_t shipCount = ash.ships.size();
+            removeShips(*board, motions, ash.ships);
+            if (ash.ships.size() > shipCount)
+            {
+                hashes.clear();
+            }
+        }
+
+        board->update();
+    }
+    ash.settled = false;
+}
+
+bool Census::evolvesAlone(const ObjectPhases& phases) const
+{
+    vector<CellCoord> next;
+    for (size_t p = 0; p < phases.size(); p++)
+    {
+        unique_ptr<Board> alone(mOptions.createBoard());
+        alone->setCells(phases[p].data(), phases[p].size());
+        alone->update();
+        getLiveCells(*alone, next);
+        if (next != phases[(p + 1) % phases.size()])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Find the group a piece of ash belongs to, given each piece's parent.
+static size_t findGroup(vector<size_t>& parents, size_t piece)
+{
+    while (parents[piece] != piece)
+    {
+        parents[piece] = parents[parents[piece]];
+        piece = parents[piece];
+    }
+    return piece;
+}
+
+void Census::splitAsh(const Ash& ash, vector<Object>& objects) const
+{
+    objects.clear();
+    for (size_t s = 0; s < ash.ships.size(); s++)
+    {
+        Object ship;
+        ship.moving = true;
+        ship.phases = ash.ships[s];
+        objects.push_back(ship);
+    }
+    if (!ash.settled)
+    {
+        // No phases marks a soup that didn't settle.
+        Object unsettled;
+        unsettled.moving = false;
+        objects.push_back(unsettled);
+        return;
+    }
+
+    // Pieces are found in all phases together, so that an oscillator
+    // whose phases touch different cells is still a single piece.
+    vector<CellCoord> all;
+    for (size_t p = 0; p < ash.phases.size(); p++)
+    {
+        all.insert(all.end(), ash.phases[p].begin(), ash.phases[p].end());
+    }
+    sort(all.begin(), all.end());
+    all.erase(unique(all.begin(), all.end()), all.end());
+
+    vector<vector<CellCoord> > pieces;
+    findComponents(all, pieces);
+    map<CellCoord, size_t> pieceOf;
+    for (size_t c = 0; c < pieces.size(); c++)
+    {
+        for (size_t k = 0; k < pieces[c].size(); k++)
+        {
+            pieceOf[pieces[c][k]] = c;
+        }
+    }
+
+    // A piece that doesn't go through its phases on its own, such as half
+    // of a still life whose halves only touch diagonally through a dead
+    // cell, leans on pieces near it. Group it with every piece it could
+    // interact with, and check again, until every group holds up alone.
+    vector<size_t> parents(pieces.size());
+    for (size_t c = 0; c < pieces.size(); c++)
+    {
+        parents[c] = c;
+    }
+    vector<bool> verified(pieces.size(), false);
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+        map<size_t, ObjectPhases> groupPhases;
+        for (size_t p = 0; p < ash.phases.size(); p++)
+        {
+            for (size_t k = 0; k < ash.phases[p].size(); k++)
+            {
+                ObjectPhases& phases = groupPhases[findGroup(parents, pieceOf[ash.phases[p][k]])];
+                phases.resize(ash.phases.size());
+                phases[p].push_back(ash.phases[p][k]);
+            }
+        }
+
+        for (auto iter = groupPhases.begin(); iter != groupPhases.end(); iter++)
+        {
+            size_t group = iter->first;
+            if (verified[group] || (findGroup(parents, group) != group))
+            {
+                continue;
+            }
+            if (evolvesAlone(iter->second))
+            {
+                verified[group] = true;
+                continue;
+            }
+
+            vector<size_t> near;
+            for (size_t c = 0; c < all.size(); c++)
+            {
+                if (findGroup(parents, pieceOf[all[c]]) != group)
+                {
+                    continue;
+                }
+                for (CellIndex di = -2; di <= 2; di++)
+                {
+                    auto cell = pieceOf.lower_bound(CellCoord(all[c].first + di, all[c].second - 2));
+                    for (; (cell != pieceOf.end()) && (cell->first <= CellCoord(all[c].first + di, all[c].second + 2)); cell++)
+                    {
+                        near.push_back(findGroup(parents, cell->second));
+                    }
+                }
+            }
+            for (size_t n = 0; n < near.size(); n++)
+            {
+                size_t other = findGroup(parents, near[n]);
+                if (other != group)
+                {
+                    parents[other] = group;
+                    merged = true;
+                }
+            }
+            verified[group] = false;
+        }
+    }
+
+    map<size_t, size_t> objectOf;
+    for (size_t c = 0; c < pieces.size(); c++)
+    {
+        size_t group = findGroup(parents, c);
+        if (objectOf.find(group) == objectOf.end())
+        {
+            size_t index = objects.size();
+            objectOf[group] = index;
+            objects.push_back(Object());
+            objects[index].moving = false;
+            objects[index].phases.resize(ash.phases.size());
+        }
+    }
+    for (size_t p = 0; p < ash.phases.size(); p++)
+    {
+        for (size_t k = 0; k < ash.phases[p].size(); k++)
+        {
+            size_t group = findGroup(parents, pieceOf[ash.phases[p][k]]);
+            objects[objectOf[group]].phases[p].push_back(ash.phases[p][k]);
+        }
+    }
+
+    // Each object may repeat sooner than the ash as a whole.
+    for (size_t o = 0; o < objects.size(); o++)
+    {
+        ObjectPhases& phases = objects[o].phases;
+        if (objects[o].moving)
+        {
+            continue;
+        }
+        for (size_t period = 1; period < phases.size(); period++)
+        {
+            if (phases[period] == phases[0])
+            {
+                phases.resize(period);
+                break;
+            }
+        }
+    }
+}
+
+void Census::run()
+{
+    Clock::time_point start = Clock::now();
+    BoundedQueue<Soup> soups(QUEUE_CAPACITY);
+    BoundedQueue<Ash> ashes(QUEUE_CAPACITY);
+    BoundedQueue<vector<Object> > objectLists(QUEUE_CAPACITY);
+    BoundedQueue<vector<string> > nameLists(QUEUE_CAPACITY);
+
+    thread generator([&]() {
+        double busy = 0;
+        for (uint64_t index = 0; index < mOptions.soups; index++)
+        {
+            Clock::time_point itemStart = Clock::now();
+            Soup soup;
+            generateSoup(index, soup);
+            busy += secondsSince(itemStart);
+            soups.push(move(soup));
+        }
+        soups.close();
+        addStageTime(STAGE_GENERATE, mOptions.soups, busy);
+    });
+
+    atomic<int> runnersLeft(mStages[STAGE_RUN].threads);
+    vector<thread> runners;
+    for (int t = 0; t < mStages[STAGE_RUN].threads; t++)
+    {
+        runners.push_back(thread([&]() {
+            double busy = 0;
+            uint64_t items = 0;
+            Soup soup;
+            while (soups.pop(soup))
+            {
+                Clock::time_point itemStart = Clock::now();
+                Ash ash;
+                runSoup(soup, ash);
+                busy += secondsSince(itemStart);
+                items++;
+                ashes.push(move(ash));
+            }
+            if (--runnersLeft == 0)
+            {
+                ashes.close();
+            }
+            addStageTime(STAGE_RUN, items, busy);
+        }));
+    }
+
+    thread splitter([&]() {
+        double busy = 0;
+        uint64_t items = 0;
+        Ash ash;
+        while (ashes.pop(ash))
+        {
+            Clock::time_point itemStart = Clock::now();
+            vector<Object> objects;
+            splitAsh(ash, objects);
+            busy += secondsSince(itemStart);
+            items++;
+            objectLists.push(move(objects));
+        }
+        objectLists.close();
+        addStageTime(STAGE_SPLIT, items, busy);
+    });
+
+    thread namer([&]() {
+        double busy = 0;
+        uint64_t items = 0;
+        vector<Object> objects;
+        while (objectLists.pop(objects))
+        {
+            Clock::time_point itemStart = Clock::now();
+            vector<string> names;
+            for (size_t o = 0; o < objects.size(); o++)
+            {
+                names.push_back(objects[o].phases.empty() ? string(UNSETTLED) :
+                    getObjectCode(objects[o].phases, objects[o].moving));
+            }
+            busy += secondsSince(itemStart);
+            items++;
+            nameLists.push(move(names));
+        }
+        nameLists.close();
+        addStageTime(STAGE_NAME, items, busy);
+    });
+
+    double busy = 0;
+    uint64_t items = 0;
+    vector<string> names;
+    while (nameLists.pop(names))
+    {
+        Clock::time_point itemStart = Clock::now();
+        for (size_t n = 0; n < names.size(); n++)
+        {
+            mCounts[names[n]]++;
+        }
+        busy += secondsSince(itemStart);
+        items++;
+    }
+    addStageTime(STAGE_TALLY, items, busy);
+
+    generator.join();
+    for (size_t t = 0; t < runners.size(); t++)
+    {
+        runners[t].join();
+    }
+    splitter.join();
+    namer.join();
+    mSeconds = secondsSince(start);
+}
+
+void Census::writeCounts(ostream& out) const
+{
+    vector<pair<uint64_t, string> > sorted;
+    for (auto iter = mCounts.begin(); iter != mCounts.end(); iter++)
+    {
+        sorted.push_back(make_pair(iter->second, iter->first));
+    }
+    sort(sorted.begin(), sorted.end(), [](const pair<uint64_t, string>& a, const pair<uint64_t, string>& b) {
+        return (a.first > b.first) || ((a.first == b.first) && (a.second < b.second));
+    });
+    for (size_t s = 0; s < sorted.size(); s++)
+    {
+        out << sorted[s].second << " " << sorted[s].first << "\n";
+    }
+}
+
+void Census::writeStats(ostream& out) const
+{
+    uint64_t soups = mStages[STAGE_RUN].items;
+    out << soups << " soups in " << mSeconds << " s, "
+        << ((mSeconds > 0) ? soups / mSeconds : 0) << " soups/s\n";
+    for (int s = 0; s < STAGES; s++)
+    {
+        const StageStats& stage = mStages[s];
+        double perItem = (stage.items > 0) ? 1e6 * stage.busySeconds / stage.items : 0;
+        double utilization = (mSeconds > 0) ? stage.busySeconds / (stage.threads * mSeconds) : 0;
+        out << "  " << stage.name << ": " << stage.threads << " thread(s), "
+            << stage.items << " items, " << perItem << " us/item, "
+            << static_cast<int>(100 * utilization + 0.5) << "% busy\n";
+    }
+}
@@ -0,0 +1,464 @@
+#include "Checkpointer.h"
+#include "CellCodec.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef GOL_HAVE_IO_URING
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/// First bytes of a binary checkpoint, including a format version.
+static const char BINARY_MAGIC[8] = { 'G', 'O', 'L', 'C', 'K', 'P', 'T', '1' };
+
+#ifdef GOL_HAVE_IO_URING
+
+/**
+ * Minimal io_uring client that writes a buffer to a file with a few chunks
+ * in flight at once. Talks to the kernel through raw system calls so that
+ * there is no dependency on liburing.
+ */
+class UringWriter
+{
+protected:
+    /// Writes in flight at once.
+    static const unsigned QUEUE_DEPTH = 8;
+
+    /// Bytes per write.
+    static const size_t CHUNK_BYTES = size_t(1) << 20;
+
+    int mRing; /// Ring file descriptor, or -1 if setup failed.
+    void* mSqRing; /// Mapped submission ring.
+    void* mCqRing; /// Mapped completion ring; may equal mSqRing.
+    size_t mSqRingBytes, mCqRingBytes; /// Sizes of the mapped rings.
+    size_t mSqesBytes; /// Size of the mapped submission entries.
+    io_uring_sqe* mSqes; /// Mapped submission entries.
+    unsigned* mSqTail; /// Submission ring tail, written by us.
+    unsigned* mSqMask; /// Submission ring index mask.
+    unsigned* mSqArray; /// Submission ring slots, indexing mSqes.
+    unsigned* mCqHead; /// Completion ring head, written by us.
+    unsigned* mCqTail; /// Completion ring tail, written by the kernel.
+    unsigned* mCqMask; /// Completion ring index mask.
+    io_uring_cqe* mCqes; /// Completion entries.
+
+    /// Queue a write of size bytes at offset; tag comes back in its completion.
+    void queueWrite(int fd, const uint8_t* data, size_t size, uint64_t offset, uint64_t tag)
+    {
+        unsigned tail = *mSqTail;
+        unsigned index = tail & *mSqMask;
+        io_uring_sqe& sqe = mSqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(data);
+        sqe.len = static_cast<uint32_t>(size);
+        sqe.off = offset;
+        sqe.user_data = tag;
+        mSqArray[index] = index;
+        __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+public:
+    UringWriter() :
+        mRing(-1), mSqRing(MAP_FAILED), mCqRing(MAP_FAILED), mSqRingBytes(0), mCqRingBytes(0),
+        mSqesBytes(0), mSqes(static_cast<io_uring_sqe*>(MAP_FAILED))
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        mRing = static_cast<int>(syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params));
+        if (mRing < 0)
+        {
+            return;
+        }
+
+        mSqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        mCqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            mSqRingBytes = mCqRingBytes = max(mSqRingBytes, mCqRingBytes);
+        }
+        mSqRing = mmap(NULL, mSqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            mRing, IORING_OFF_SQ_RING);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            mCqRing = mSqRing;
+        }
+        else
+        {
+            mCqRing = mmap(NULL, mCqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                mRing, IORING_OFF_CQ_RING);
+        }
+        mSqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+        mSqes = static_cast<io_uring_sqe*>(mmap(NULL, mSqesBytes, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQES));
+        if ((mSqRing == MAP_FAILED) || (mCqRing == MAP_FAILED) || (mSqes == MAP_FAILED))
+        {
+            close(mRing);
+            mRing = -1;
+            return;
+        }
+
+        uint8_t* sq = static_cast<uint8_t*>(mSqRing);
+        uint8_t* cq = static_cast<uint8_t*>(mCqRing);
+        mSqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        mSqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        mSqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        mCqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        mCqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        mCqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        mCqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~UringWriter()
+    {
+        if (mSqes != MAP_FAILED)
+        {
+            munmap(mSqes, mSqesBytes);
+        }
+        if ((mCqRing != MAP_FAILED) && (mCqRing != mSqRing))
+        {
+            munmap(mCqRing, mCqRingBytes);
+        }
+        if (mSqRing != MAP_FAILED)
+        {
+            munmap(mSqRing, mSqRingBytes);
+        }
+        if (mRing >= 0)
+        {
+            close(mRing);
+        }
+    }
+
+    /// Test whether the ring was set up.
+    bool isOpen() const
+    {
+        return mRing >= 0;
+    }
+
+    /**
+     * Write all of data to fd, starting at offset 0.
+     * @return 0 on success, or a negative errno.
+     */
+    int write(int fd, const uint8_t* data, size_t size)
+    {
+        // Each write in flight is tagged with its offset; short writes are
+        // queued again for the rest of their chunk.
+        size_t queued = 0;
+        unsigned inFlight = 0, toSubmit = 0;
+        int error = 0;
+        while ((queued < size) || (inFlight > 0))
+        {
+            while ((error == 0) && (queued < size) && (inFlight < QUEUE_DEPTH))
+            {
+                size_t bytes = min(CHUNK_BYTES, size - queued);
+                queueWrite(fd, data + queued, bytes, queued, queued);
+                queued += bytes;
+                inFlight++;
+                toSubmit++;
+            }
+            if (inFlight == 0)
+            {
+                break;
+            }
+
+            int result = static_cast<int>(syscall(__NR_io_uring_enter, mRing, toSubmit, 1,
+                IORING_ENTER_GETEVENTS, NULL, 0));
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return -errno;
+            }
+            toSubmit -= min<unsigned>(toSubmit, static_cast<unsigned>(result));
+
+            unsigned head = *mCqHead;
+            unsigned tail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++)
+            {
+                const io_uring_cqe& cqe = mCqes[head & *mCqMask];
+                uint64_t offset = cqe.user_data;
+                size_t end = min<size_t>(size, (offset / CHUNK_BYTES + 1) * CHUNK_BYTES);
+                inFlight--;
+                if (cqe.res < 0)
+                {
+                    error = (error != 0) ? error : cqe.res;
+                }
+                else if ((cqe.res == 0) && (offset < end))
+                {
+                    error = (error != 0) ? error : -EIO;
+                }
+                else if ((error == 0) && (offset + cqe.res < end))
+                {
+                    offset += cqe.res;
+                    queueWrite(fd, data + offset, end - offset, offset, offset);
+                    inFlight++;
+                    toSubmit++;
+                }
+            }
+            __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+        }
+        return error;
+    }
+};
+
+const unsigned UringWriter::QUEUE_DEPTH;
+const size_t UringWriter::CHUNK_BYTES;
+
+#else
+
+/// Stand-in where io_uring isn't available; never constructed.
+class UringWriter
+{
+};
+
+#endif
+
+/// Append the decimal digits of a number.
+static void appendNumber(vector<uint8_t>& out, CellIndex value)
+{
+    char digits[24];
+    size_t count = 0;
+    uint64_t magnitude = (value < 0) ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do
+    {
+        digits[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+    {
+        out.push_back('-');
+    }
+    while (count > 0)
+    {
+        out.push_back(static_cast<uint8_t>(digits[--count]));
+    }
+}
+
+void Checkpointer::serializeText(const Board& board, vector<uint8_t>& out)
+{
+    // Same as writeBoard(): (column,row) per line.
+    CellIndex i, j;
+    if (board.getFirstLiveCell(i, j))
+    {
+        do
+        {
+            out.push_back('(');
+            appendNumber(out, j);
+            out.push_back(',');
+            appendNumber(out, i);
+            out.push_back(')');
+            out.push_back('\n');
+        } while (board.getNextLiveCell(i, j));
+    }
+}
+
+void Checkpointer::serializeBinary(const Board& board, vector<uint8_t>& out)
+{
+    out.insert(out.end(), BINARY_MAGIC, BINARY_MAGIC + sizeof(BINARY_MAGIC));
+    vector<CellCoord> cells;
+    getLiveCells(board, cells);
+    encodeCells(cells, out);
+}
+
+bool Checkpointer::loadCheckpoint(Board& board, const string& fileName)
+{
+    ifstream inFile(fileName.c_str(), ios::binary);
+    if (!inFile.is_open())
+    {
+        cerr << "Failed to open " << fileName << endl;
+        return false;
+    }
+
+    char magic[sizeof(BINARY_MAGIC)];
+    if (!inFile.read(magic, sizeof(magic)) || (memcmp(magic, BINARY_MAGIC, sizeof(magic)) != 0))
+    {
+        inFile.close();
+        return board.loadBoard(fileName);
+    }
+
+    vector<uint8_t> data((istreambuf_iterator<char>(inFile)), istreambuf_iterator<char>());
+    vector<CellCoord> cells;
+    if (!decodeCells(data.data(), data.size(), cells))
+    {
+        cerr << "Malformed checkpoint " << fileName << endl;
+        return false;
+    }
+    board.clearBoard();
+    board.setCells(cells.data(), cells.size());
+    return true;
+}
+
+Checkpointer::Checkpointer(size_t maxQueued) :
+    mQueue(maxQueued),
+    mUring(NULL),
+    mQueued(0),
+    mWritten(0),
+    mFailed(0),
+    mBytes(0),
+    mStallSeconds(0)
+{
+#ifdef GOL_HAVE_IO_URING
+    mUring = new UringWriter();
+    if (!mUring->isOpen())
+    {
+        delete mUring;
+        mUring = NULL;
+    }
+#endif
+    mThread = thread(&Checkpointer::run, this);
+}
+
+Checkpointer::~Checkpointer()
+{
+    mQueue.close();
+    mThread.join();
+    delete mUring;
+}
+
+bool Checkpointer::checkpoint(const Board& board, const string& fileName, const Serializer& serializer)
+{
+    Job job;
+    job.board = board.snapshot();
+    job.fileName = fileName;
+    job.serializer = serializer;
+
+    {
+        lock_guard<mutex> lock(mMutex);
+        mQueued++;
+    }
+    auto start = chrono::steady_clock::now();
+    bool queued = mQueue.push(job);
+    double waited = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    lock_guard<mutex> lock(mMutex);
+    mStallSeconds += waited;
+    if (!queued)
+    {
+        mQueued--;
+        mFinished.notify_all();
+    }
+    return queued;
+}
+
+void Checkpointer::flush()
+{
+    unique_lock<mutex> lock(mMutex);
+    while (mWritten + mFailed < mQueued)
+    {
+        mFinished.wait(lock);
+    }
+}
+
+void Checkpointer::run()
+{
+    Job job;
+    vector<uint8_t> data;
+    while (mQueue.pop(job))
+    {
+        data.clear();
+        job.serializer(*job.board, data);
+        job.board.reset();
+        bool written = writeFile(job.fileName, data);
+
+        lock_guard<mutex> lock(mMutex);
+        if (written)
+        {
+            mWritten++;
+            mBytes += data.size();
+        }
+        else
+        {
+            mFailed++;
+        }
+        mFinished.notify_all();
+    }
+}
+
+bool Checkpointer::writeFile(const string& fileName, const vector<uint8_t>& data)
+{
+#ifdef GOL_HAVE_IO_URING
+    if (mUring)
+    {
+        int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            cerr << "Failed to open " << fileName << endl;
+            return false;
+        }
+        int error = mUring->write(fd, data.data(), data.size());
+        close(fd);
+        if ((error == -EINVAL) || (error == -EOPNOTSUPP))
+        {
+            // The kernel has io_uring but not its write operation.
+            lock_guard<mutex> lock(mMutex);
+            delete mUring;
+            mUring = NULL;
+        }
+        else if (error != 0)
+        {
+            cerr << "Failed to write " << fileName << ": " << strerror(-error) << endl;
+            return false;
+        }
+        else
+        {
+            return true;
+        }
+    }
+#endif
+
+    ofstream outFile(fileName.c_str(), ios::binary | ios::trunc);
+    if (!outFile.is_open())
+    {
+        cerr << "Failed to open " << fileName << endl;
+        return false;
+    }
+    outFile.write(reinterpret_cast<const char*>(data.data()), data.size());
+    outFile.close();
+    if (!outFile)
+    {
+        cerr << "Failed to write " << fileName << endl;
+        return false;
+    }
+    return true;
+}
+
+bool Checkpointer::usesUring()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mUring != NULL;
+}
+
+uint64_t Checkpointer::getWritten()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mWritten;
+}
+
+uint64_t Checkpointer::getFailed()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mFailed;
+}
+
+uint64_t Checkpointer::getBytes()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mBytes;
+}
+
+double Checkpointer::getStallSeconds()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mStallSeconds;
+}
@@ -0,0 +1,952 @@
+// Command-line runner for game of life, for batch jobs that don't need the GUI.
+
+#include "BasicBoard.h"
+#include "Census.h"
+#include "Checkpointer.h"
+#include "EnsembleBoard.h"
+#include "FixedBoard.h"
+#include "FlatSparseBoard.h"
+#include "FrameExporter.h"
+#include "HybridBoard.h"
+#include "Instrumentation.h"
+#include "LargerThanLifeBoard.h"
+#include "PackedBoard.h"
+#include "PerfCounters.h"
+#include "SparseBoard.h"
+#include "TiledFileBoard.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Parsed command line: positional arguments plus "--name value" options.
+ */
+struct CommandLine
+{
+    vector<string> args; /// Positional arguments, starting with the command.
+    map<string, string> options; /// Option values, keyed by name without "--".
+
+    /// Get string option, or a default if not given.
+    string get(const string& name, const string& defaultValue) const
+    {
+        auto iter = options.find(name);
+        return (iter != options.end()) ? iter->second : defaultValue;
+    }
+
+    /// Get integer option, or a default if not given.
+    int64_t getInt(const string& name, int64_t defaultValue) const
+    {
+        auto iter = options.find(name);
+        return (iter != options.end()) ? strtoll(iter->second.c_str(), NULL, 10) : defaultValue;
+    }
+
+    /// Test whether an option was given.
+    bool has(const string& name) const
+    {
+        return options.find(name) != options.end();
+    }
+};
+
+static void printUsage()
+{
+    cerr << "Usage: gol_cli <command> [options]\n"
+         << "\n"
+         << "Commands:\n"
+         << "  run <input>   Run a board loaded from a file.\n"
+         << "  run --soup <n>  Run a random soup of about n live cells.\n"
+         << "  census        Run many small random soups and count the objects left.\n"
+         << "  bench         Run the same soup on several engines and compare them.\n"
+         << "  window <input> --window <row,column,rows,columns>\n"
+         << "                Show a window as it will be after --generations, simulating\n"
+         << "                only its light cone; --verify 1 checks it against a full run.\n"
+         << "\n"
+         << "Options:\n"
+         << "  --engine <sparse|flat|basic|packed|fixed|hybrid|tiled|ltl>  Board engine (default sparse).\n"
+         << "  --rows <n>, --columns <n> Size of bounded engines (default 100; fixed\n"
+         << "                            takes square boards of 32, 64, 128 or 256).\n"
+         << "  --rule <rule>             Larger than Life rule for ltl, e.g. R5,C0,M1,S34..58,B34..45,NM\n"
+         << "                            (default R1,C0,M0,S2..3,B3..3,NM, i.e. Life).\n"
+         << "  --tile-dir <dir>          Where tiled keeps its backing file (default $TMPDIR or /tmp).\n"
+         << "  --resident-mb <n>         Memory tiled may map at once (default 256).\n"
+         << "  --sweep-generations <n>   Generations tiled takes per pass over its tiles when\n"
+         << "                            nothing is written per generation (default 1, at most 64).\n"
+         << "  --generations <n>         Generations to run (default 100).\n"
+         << "  --output <file>           Write final board to file.\n"
+         << "  --stats <file|->          Write per-generation stats to file or stdout.\n"
+         << "  --stats-format <csv|json|chrome>  Format of stats (default csv).\n"
+         << "  --counters <0|1>          Add hardware counters to stats (default 0).\n"
+         << "  --changes <file|->        Write the cells each generation changed, as lines of\n"
+         << "                            generation, row, first column and a hex mask of 64 columns.\n"
+         << "  --memory-budget <bytes>   Stop before an update would use more memory.\n"
+         << "  --budget-policy <fail|compact|dump>  What to do when over budget (default fail);\n"
+         << "                            dump writes the board to a file and stops, so the run\n"
+         << "                            can be started again from it elsewhere.\n"
+         << "  --dump-file <file>        Where the dump policy writes the board (default dump.txt).\n"
+         << "  --soup-density <percent>  Live cells in a soup (default 37).\n"
+         << "  --seed <n>                Random seed for a soup (default 1).\n"
+         << "  --checkpoint <file>       Write checkpoints to <file>.<generation> in the background.\n"
+         << "  --checkpoint-every <n>    Generations between checkpoints (default 100).\n"
+         << "  --checkpoint-format <text|binary>  Format of checkpoints (default text).\n"
+         << "  --frames <prefix>         Write frames to <prefix><frame>.<format> in the background.\n"
+         << "  --frame-pipe <command>    Write all frames to the input of an encoder command instead.\n"
+         << "  --frame-every <n>         Generations between frames (default 1).\n"
+         << "  --frame-format <png|pgm|raw>  Format of frames (default png).\n"
+         << "  --viewport <row,column,rows,columns>  Cells in frames (default the starting bounding box).\n"
+         << "  --frame-scale <n>         Pixels per cell along each side (default 1).\n"
+         << "  --frame-threads <n>       Threads rendering frames (default 1).\n"
+         << "\n"
+         << "Census options:\n"
+         << "  --engine <sparse|flat|hybrid>  Board engine (default sparse).\n"
+         << "  --soups <n>               Soups to run (default 1000).\n"
+         << "  --seed <n>                Search seed (default 1).\n"
+         << "  --soup-size <n>           Side of each soup (default 16).\n"
+         << "  --soup-density <percent>  Live cells in each soup (default 50).\n"
+         << "  --max-generations <n>     Generations before a soup is given up (default 10000).\n"
+         << "  --threads <n>             Threads running soups (default one per core).\n"
+         << "  --output <file>           Write counts to file instead of stdout.\n"
+         << "\n"
+         << "Bench options:\n"
+         << "  --engine <a,b,...>        Engines to compare (default sparse,flat,basic,packed,hybrid).\n"
+         << "                            ensemble runs 64 soups at once, seeds seed to seed + 63,\n"
+         << "                            and checks each against packed; ensemble256 and\n"
+         << "                            ensemble512 run 256 or 512 when built for AVX2 or AVX-512.\n"
+         << "  --size <n>                Side of the board and of the soup (default 256).\n"
+         << "  --generations <n>         Generations to run (default 100).\n"
+         << "  --soup-density <percent>  Live cells in the soup (default 37).\n"
+         << "  --seed <n>                Random seed for the soup (default 1).\n"
+         << "  --counters <0|1>          Report IPC and misses per cell (default 1).\n";
+}
+
+/**
+ * Create a FixedBoard of one of the sizes built in.
+ * @return new board to be deleted by caller, or null if there is no such size.
+ */
+static Board* createFixedBoard(CellIndex rows, CellIndex columns)
+{
+    if (rows == columns)
+    {
+        switch (rows)
+        {
+        case 32:
+            return new FixedBoard<32, 32>();
+        case 64:
+            return new FixedBoard<64, 64>();
+        case 128:
+            return new FixedBoard<128, 128>();
+        case 256:
+            return new FixedBoard<256, 256>();
+        default:
+            break;
+        }
+    }
+
+    cerr << "No fixed board of " << rows << "x" << columns << endl;
+    return NULL;
+}
+
+/**
+ * Create a board engine by name.
+ * @param rows, columns - size of bounded engines
+ * @return new board to be deleted by caller, or null if name is unknown.
+ */
+static Board* createEngine(const string& engine, CellIndex rows, CellIndex columns)
+{
+    if (engine == "sparse")
+    {
+        return new SparseBoard();
+    }
+    else if (engine == "flat")
+    {
+        return new FlatSparseBoard();
+    }
+    else if (engine == "basic")
+    {
+        return new BasicBoard(rows, columns);
+    }
+    else if (engine == "packed")
+    {
+        return new PackedBoard(rows, columns);
+    }
+    else if (engine == "fixed")
+    {
+        return createFixedBoard(rows, columns);
+    }
+    else if (engine == "hybrid")
+    {
+        return new HybridBoard();
+    }
+    else if (engine == "tiled")
+    {
+        return new TiledFileBoard(rows, columns);
+    }
+    else if (engine == "ltl")
+    {
+        return new LargerThanLifeBoard(LargerThanLifeBoard::Rule(), rows, columns);
+    }
+
+    cerr << "Unknown engine " << engine << endl;
+    return NULL;
+}
+
+/**
+ * Create the board engine named on the command line.
+ * @return new board to be deleted by caller, or null if name is unknown.
+ */
+static Board* createBoard(const CommandLine& cmd)
+{
+    string engine = cmd.get("engine", "sparse");
+    if (engine == "tiled")
+    {
+        TiledFileBoard* board = new TiledFileBoard(cmd.getInt("rows", 100), cmd.getInt("columns", 100),
+            cmd.get("tile-dir", ""), static_cast<size_t>(cmd.getInt("resident-mb", 256)) << 20);
+        board->setSweepGenerations(static_cast<int>(cmd.getInt("sweep-generations", 1)));
+        return board;
+    }
+    if (engine == "ltl")
+    {
+        LargerThanLifeBoard::Rule rule;
+        if (!LargerThanLifeBoard::parseRule(cmd.get("rule", "R1,C0,M0,S2..3,B3..3,NM"), rule))
+        {
+            cerr << "Unknown or unsupported rule " << cmd.get("rule", "") << endl;
+            return NULL;
+        }
+        return new LargerThanLifeBoard(rule, cmd.getInt("rows", 100), cmd.getInt("columns", 100));
+    }
+    return createEngine(engine, cmd.getInt("rows", 100), cmd.getInt("columns", 100));
+}
+
+/**
+ * Seed a board with a square of random cells, starting at (0, 0).
+ * @param cells - number of live cells wanted, approximately
+ * @param density - percentage of cells in the square that are alive
+ */
+static void seedSoup(Board& board, int64_t cells, int64_t density, uint64_t seed)
+{
+    density = min<int64_t>(max<int64_t>(density, 1), 100);
+    CellIndex side = static_cast<CellIndex>(ceil(sqrt(cells * 100.0 / density)));
+
+    // Cells are generated in order, which is what setCells() likes best.
+    mt19937_64 random(seed);
+    vector<CellCoord> soup;
+    soup.reserve(static_cast<size_t>(cells + cells / 8));
+    for (CellIndex i = 0; i < side; i++)
+    {
+        for (CellIndex j = 0; j < side; j++)
+        {
+            if (static_cast<int64_t>(random() % 100) < density)
+            {
+                soup.push_back(CellCoord(i, j));
+            }
+        }
+    }
+    board.setCells(soup.data(), soup.size());
+}
+
+/**
+ * Set up frame export as asked on the command line.
+ * @param board - board to be exported, whose bounding box is the default viewport
+ * @param exporter - receives new exporter to be deleted by caller, or null
+ *                   if no frames were asked for
+ * @return false if the options were wrong or the encoder didn't start.
+ */
+static bool createFrameExporter(const CommandLine& cmd, const Board& board, FrameExporter*& exporter)
+{
+    exporter = NULL;
+    if (!cmd.has("frames") && !cmd.has("frame-pipe"))
+    {
+        return true;
+    }
+
+    FrameExporter::Options options;
+    if (!FrameExporter::parseFormat(cmd.get("frame-format", "png"), options.format))
+    {
+        cerr << "Unknown frame format " << cmd.get("frame-format", "") << endl;
+        return false;
+    }
+
+    if (cmd.has("viewport"))
+    {
+        long long row, column;
+        if ((sscanf(cmd.get("viewport", "").c_str(), "%lld,%lld,%d,%d", &row, &column,
+                &options.rows, &options.columns) != 4) || (options.rows <= 0) || (options.columns <= 0))
+        {
+            cerr << "Viewport must be <row>,<column>,<rows>,<columns>" << endl;
+            return false;
+        }
+        options.row = row;
+        options.column = column;
+    }
+    else
+    {
+        CellIndex iMin, jMin, iMax, jMax;
+        if (board.getBoundingBox(iMin, jMin, iMax, jMax))
+        {
+            options.row = iMin;
+            options.column = jMin;
+            options.rows = static_cast<int>(iMax - iMin + 1);
+            options.columns = static_cast<int>(jMax - jMin + 1);
+        }
+    }
+
+    options.scale = static_cast<int>(max<int64_t>(cmd.getInt("frame-scale", 1), 1));
+    options.threads = static_cast<int>(max<int64_t>(cmd.getInt("frame-threads", 1), 1));
+    options.prefix = cmd.get("frames", "");
+    options.pipeCommand = cmd.get("frame-pipe", "");
+    exporter = new FrameExporter(options);
+    if (!exporter->isOpen())
+    {
+        delete exporter;
+        exporter = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Write the cells a generation changed, one span of up to 64 columns per line.
+ */
+static void writeChanges(ostream& out, int64_t generation, const vector<ChangeSpan>& changes)
+{
+    for (size_t s = 0; s < changes.size(); s++)
+    {
+        out << generation << ' ' << changes[s].i << ' ' << changes[s].j << ' '
+            << hex << changes[s].mask << dec << '\n';
+    }
+}
+
+/// Run a board loaded from a file for some number of generations.
+static int runCommand(const CommandLine& cmd)
+{
+    if ((cmd.args.size() < 2) && !cmd.has("soup"))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Board* board = createBoard(cmd);
+    if (!board)
+    {
+        return 1;
+    }
+    if (cmd.has("soup"))
+    {
+        seedSoup(*board, cmd.getInt("soup", 0), cmd.getInt("soup-density", 37), cmd.getInt("seed", 1));
+    }
+    else if (!Checkpointer::loadCheckpoint(*board, cmd.args[1]))
+    {
+        delete board;
+        return 1;
+    }
+
+    // Set up instrumentation only if stats were requested.
+    Instrumentation* instrumentation = NULL;
+    PerfCounters* perf = NULL;
+    ofstream statsFile;
+    if (cmd.has("stats"))
+    {
+        Instrumentation::Format format;
+        if (!Instrumentation::parseFormat(cmd.get("stats-format", "csv"), format))
+        {
+            cerr << "Unknown stats format " << cmd.get("stats-format", "") << endl;
+            delete board;
+            return 1;
+        }
+
+        string statsName = cmd.get("stats", "-");
+        ostream* statsOut = &cout;
+        if (statsName != "-")
+        {
+            statsFile.open(statsName.c_str());
+            if (!statsFile.is_open())
+            {
+                cerr << "Failed to open " << statsName << endl;
+                delete board;
+                return 1;
+            }
+            statsOut = &statsFile;
+        }
+        if (cmd.getInt("counters", 0) != 0)
+        {
+            perf = new PerfCounters();
+            if (!perf->isAvailable())
+            {
+                cerr << "Hardware counters unavailable (" << perf->getError() << ")" << endl;
+            }
+        }
+        instrumentation = new Instrumentation(*statsOut, format, perf);
+        board->setInstrumentation(instrumentation);
+    }
+
+    // Likewise, engines only list changed cells if they were requested.
+    vector<ChangeSpan> changes;
+    ostream* changesOut = NULL;
+    ofstream changesFile;
+    if (cmd.has("changes"))
+    {
+        string changesName = cmd.get("changes", "-");
+        changesOut = &cout;
+        if (changesName != "-")
+        {
+            changesFile.open(changesName.c_str());
+            if (!changesFile.is_open())
+            {
+                cerr << "Failed to open " << changesName << endl;
+                board->setInstrumentation(NULL);
+                delete instrumentation;
+                delete perf;
+                delete board;
+                return 1;
+            }
+            changesOut = &changesFile;
+        }
+        board->setChangeSet(&changes);
+    }
+
+    if (cmd.has("memory-budget"))
+    {
+        string policyName = cmd.get("budget-policy", "fail");
+        Board::MemoryBudgetPolicy policy = Board::BUDGET_FAIL;
+        if (policyName == "compact")
+        {
+            policy = Board::BUDGET_COMPACT;
+        }
+        else if (policyName == "dump")
+        {
+            policy = Board::BUDGET_DUMP;
+        }
+        else if (policyName != "fail")
+        {
+            cerr << "Unknown budget policy " << policyName << endl;
+            delete instrumentation;
+            delete perf;
+            delete board;
+            return 1;
+        }
+        board->setMemoryBudget(static_cast<size_t>(cmd.getInt("memory-budget", 0)), policy,
+            cmd.get("dump-file", "dump.txt"));
+    }
+
+    // Frames are rendered and written by background threads too.
+    FrameExporter* exporter = NULL;
+    int64_t frameEvery = max<int64_t>(cmd.getInt("frame-every", 1), 1);
+    if (!createFrameExporter(cmd, *board, exporter))
+    {
+        board->setInstrumentation(NULL);
+        delete instrumentation;
+        delete perf;
+        delete board;
+        return 1;
+    }
+    if (exporter)
+    {
+        exporter->addFrame(*board);
+    }
+
+    // Checkpoints are written by a background thread while the board runs.
+    Checkpointer* checkpointer = NULL;
+    Checkpointer::Serializer serializer = Checkpointer::serializeText;
+    int64_t checkpointEvery = max<int64_t>(cmd.getInt("checkpoint-every", 100), 1);
+    if (cmd.has("checkpoint"))
+    {
+        string formatName = cmd.get("checkpoint-format", "text");
+        if (formatName == "binary")
+        {
+            serializer = Checkpointer::serializeBinary;
+        }
+        else if (formatName != "text")
+        {
+            cerr << "Unknown checkpoint format " << formatName << endl;
+            delete exporter;
+            board->setInstrumentation(NULL);
+            delete instrumentation;
+            delete perf;
+            delete board;
+            return 1;
+        }
+        checkpointer = new Checkpointer();
+    }
+
+    int result = 0;
+    int64_t generations = cmd.getInt("generations", 100);
+
+    // With nothing to write per generation, an out-of-core board may take
+    // several generations per pass over its tiles.
+    TiledFileBoard* tiled = dynamic_cast<TiledFileBoard*>(board);
+    if (tiled && !checkpointer && !exporter && !changesOut && !cmd.has("memory-budget"))
+    {
+        tiled->advance(generations);
+        generations = 0;
+    }
+
+    for (int64_t g = 0; g < generations; g++)
+    {
+        if (!board->tryUpdate())
+        {
+            cerr << "Stopped after " << g << " generations" << endl;
+            result = 2;
+            break;
+        }
+        if (changesOut)
+        {
+            writeChanges(*changesOut, g + 1, changes);
+        }
+        if (checkpointer && ((g + 1) % checkpointEvery == 0))
+        {
+            checkpointer->checkpoint(*board, cmd.get("checkpoint", "") + "." + to_string(g + 1), serializer);
+        }
+        if (exporter && ((g + 1) % frameEvery == 0))
+        {
+            exporter->addFrame(*board);
+        }
+    }
+
+    if (exporter)
+    {
+        exporter->flush();
+        cerr << "Frames: " << exporter->getWritten() << " written ("
+             << exporter->getBytes() << " bytes), "
+             << exporter->getFailed() << " failed, "
+             << exporter->getStallSeconds() << " s waiting for the renderers" << endl;
+        if (exporter->getFailed() > 0)
+        {
+            result = 1;
+        }
+        delete exporter;
+    }
+
+    if (checkpointer)
+    {
+        checkpointer->flush();
+        cerr << "Checkpoints: " << checkpointer->getWritten() << " written ("
+             << checkpointer->getBytes() << " bytes, "
+             << (checkpointer->usesUring() ? "io_uring" : "blocking writes") << "), "
+             << checkpointer->getFailed() << " failed, "
+             << checkpointer->getStallSeconds() << " s waiting for the writer" << endl;
+        if (checkpointer->getFailed() > 0)
+        {
+            result = 1;
+        }
+        delete checkpointer;
+    }
+
+    if (tiled)
+    {
+        cerr << "Tiles: " << tiled->getTileLoads() << " loaded, "
+             << (tiled->isFileBacked() ? "file-backed" : "on the heap") << endl;
+    }
+
+    if (cmd.has("memory-budget"))
+    {
+        cerr << "Memory: " << board->getMemoryUsage() << " bytes resident, "
+             << board->getPeakMemoryUsage() << " bytes peak" << endl;
+    }
+
+    if (cmd.has("output"))
+    {
+        board->writeBoard(cmd.get("output", ""));
+    }
+
+    board->setInstrumentation(NULL);
+    delete instrumentation;
+    delete perf;
+    delete board;
+    return result;
+}
+
+/// Run a census of random soups and write the counts.
+static int censusCommand(const CommandLine& cmd)
+{
+    Census::Options options;
+    string engine = cmd.get("engine", "sparse");
+    if (engine == "sparse")
+    {
+        options.createBoard = []() -> Board* { return new SparseBoard(); };
+    }
+    else if (engine == "flat")
+    {
+        options.createBoard = []() -> Board* { return new FlatSparseBoard(); };
+    }
+    else if (engine == "hybrid")
+    {
+        options.createBoard = []() -> Board* { return new HybridBoard(); };
+    }
+    else
+    {
+        cerr << "Census needs an unbounded engine, not " << engine << endl;
+        return 1;
+    }
+    options.seed = static_cast<uint64_t>(cmd.getInt("seed", static_cast<int64_t>(options.seed)));
+    options.soups = static_cast<uint64_t>(cmd.getInt("soups", static_cast<int64_t>(options.soups)));
+    options.soupSize = cmd.getInt("soup-size", options.soupSize);
+    options.density = static_cast<int>(cmd.getInt("soup-density", options.density));
+    options.maxGenerations = static_cast<uint64_t>(cmd.getInt("max-generations",
+        static_cast<int64_t>(options.maxGenerations)));
+    options.runThreads = static_cast<int>(cmd.getInt("threads", options.runThreads));
+
+    Census census(options);
+    census.run();
+
+    if (cmd.has("output"))
+    {
+        ofstream outFile(cmd.get("output", "").c_str());
+        if (!outFile.is_open())
+        {
+            cerr << "Failed to open " << cmd.get("output", "") << endl;
+            return 1;
+        }
+        census.writeCounts(outFile);
+    }
+    else
+    {
+        census.writeCounts(cout);
+    }
+    census.writeStats(cerr);
+    return 0;
+}
+
+/**
+ * Write one line of benchmark results.
+ * @param micros - time taken over all generations
+ * @param counters - hardware events over all generations
+ * @param perf - counters that were read, or null
+ * @param cellUpdates - cells updated over all generations
+ */
+static void writeBenchLine(ostream& out, const string& name, double micros, const uint64_t counters[PERF_EVENT_COUNT],
+    const PerfCounters* perf, int64_t generations, double cellUpdates)
+{
+    out << name << ": " << micros / generations << " us/gen, "
+        << micros * 1000 / cellUpdates << " ns/cell";
+    if (!perf)
+    {
+        out << "\n";
+        return;
+    }
+
+    out << ", IPC ";
+    if (perf->isAvailable(PERF_CYCLES) && perf->isAvailable(PERF_INSTRUCTIONS) && (counters[PERF_CYCLES] > 0))
+    {
+        out << static_cast<double>(counters[PERF_INSTRUCTIONS]) / counters[PERF_CYCLES];
+    }
+    else
+    {
+        out << "n/a";
+    }
+
+    // Misses are given per cell update, so engines can be compared directly.
+    const PerfEvent misses[] = { PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES };
+    for (size_t m = 0; m < sizeof(misses) / sizeof(misses[0]); m++)
+    {
+        out << ", " << PerfCounters::getEventName(misses[m]) << "/cell ";
+        if (perf->isAvailable(misses[m]))
+        {
+            out << counters[misses[m]] / cellUpdates;
+        }
+        else
+        {
+            out << "n/a";
+        }
+    }
+    out << "\n";
+}
+
+/**
+ * Run a soup on every lane of an ensemble, each lane with its own seed,
+ * write how fast it went, and check each lane against a PackedBoard run of
+ * the same soup.
+ * @param seed - seed of the soup on lane 0; lane k takes seed + k
+ * @return false if any lane differs from its PackedBoard
+ */
+template <typename Word>
+static bool benchEnsemble(const string& name, CellIndex size, int64_t generations, int64_t density,
+    uint64_t seed, const PerfCounters* perf)
+{
+    EnsembleBoard<Word> ensemble(size, size);
+    vector<PackedBoard*> boards;
+    for (int lane = 0; lane < EnsembleBoard<Word>::LANES; lane++)
+    {
+        boards.push_back(new PackedBoard(size, size));
+        seedSoup(*boards.back(), size * size * density / 100, density, seed + lane);
+        ensemble.seedLane(lane, *boards.back());
+    }
+
+    uint64_t before[PERF_EVENT_COUNT] = { 0 };
+    uint64_t counters[PERF_EVENT_COUNT] = { 0 };
+    if (perf)
+    {
+        perf->read(before);
+    }
+    auto start = chrono::steady_clock::now();
+    for (int64_t g = 0; g < generations; g++)
+    {
+        ensemble.update();
+    }
+    double micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    if (perf)
+    {
+        perf->read(counters);
+        for (int e = 0; e < PERF_EVENT_COUNT; e++)
+        {
+            counters[e] -= before[e];
+        }
+    }
+
+    // Figures are per cell of each board, so they compare with one engine
+    // running one soup.
+    double cellUpdates = static_cast<double>(size) * size * generations * EnsembleBoard<Word>::LANES;
+    writeBenchLine(cout, name, micros, counters, perf, generations, cellUpdates);
+
+    bool same = true;
+    for (int lane = 0; lane < EnsembleBoard<Word>::LANES; lane++)
+    {
+        for (int64_t g = 0; g < generations; g++)
+        {
+            boards[lane]->update();
+        }
+        for (CellIndex i = 0; same && (i < size); i++)
+        {
+            for (CellIndex j = 0; same && (j < size); j++)
+            {
+                if (ensemble.getCell(lane, i, j) != boards[lane]->getCell(i, j))
+                {
+                    cerr << name << " lane " << lane << " differs from packed at (" << i << ", " << j << ")" << endl;
+                    same = false;
+                }
+            }
+        }
+        delete boards[lane];
+    }
+    return same;
+}
+
+/// Run the same soup on several engines and compare their speed.
+static int benchCommand(const CommandLine& cmd)
+{
+    CellIndex size = max<CellIndex>(cmd.getInt("size", 256), 1);
+    int64_t generations = max<int64_t>(cmd.getInt("generations", 100), 1);
+    int64_t density = min<int64_t>(max<int64_t>(cmd.getInt("soup-density", 37), 1), 100);
+    uint64_t seed = static_cast<uint64_t>(cmd.getInt("seed", 1));
+
+    // Counters are opened once, on this thread, which runs every update.
+    PerfCounters* perf = NULL;
+    if (cmd.getInt("counters", 1) != 0)
+    {
+        perf = new PerfCounters();
+        if (!perf->isAvailable())
+        {
+            cerr << "Hardware counters unavailable (" << perf->getError() << "); reporting time only" << endl;
+            delete perf;
+            perf = NULL;
+        }
+    }
+    Instrumentation instrumentation(cout, Instrumentation::FORMAT_NONE, perf);
+
+    // Every engine is charged for the whole square each generation, which
+    // is the work a dense engine does, so that figures per cell compare.
+    double cellUpdates = static_cast<double>(size) * size * generations;
+    int result = 0;
+    istringstream engines(cmd.get("engine", "sparse,flat,basic,packed,hybrid"));
+    string engine;
+    while (getline(engines, engine, ','))
+    {
+        // Ensembles run many soups at once rather than one board.
+        if (engine == "ensemble")
+        {
+            result |= benchEnsemble<uint64_t>(engine, size, generations, density, seed, perf) ? 0 : 1;
+            continue;
+        }
+#ifdef GOL_HAVE_ENSEMBLE_WORD256
+        if (engine == "ensemble256")
+        {
+            result |= benchEnsemble<EnsembleWord256>(engine, size, generations, density, seed, perf) ? 0 : 1;
+            continue;
+        }
+#endif
+#ifdef GOL_HAVE_ENSEMBLE_WORD512
+        if (engine == "ensemble512")
+        {
+            result |= benchEnsemble<EnsembleWord512>(engine, size, generations, density, seed, perf) ? 0 : 1;
+            continue;
+        }
+#endif
+
+        Board* board = createEngine(engine, size, size);
+        if (!board)
+        {
+            result = 1;
+            continue;
+        }
+        seedSoup(*board, size * size * density / 100, density, seed);
+        board->setInstrumentation(&instrumentation);
+
+        GenerationStats total = GenerationStats();
+        for (int64_t g = 0; g < generations; g++)
+        {
+            board->update();
+            const GenerationStats& stats = instrumentation.getLastStats();
+            total.totalTime += stats.totalTime;
+            for (int e = 0; e < PERF_EVENT_COUNT; e++)
+            {
+                total.counters[e] += stats.counters[e];
+            }
+            for (int p = 0; p < PHASE_COUNT; p++)
+            {
+                total.phaseTime[p] += stats.phaseTime[p];
+                for (int e = 0; e < PERF_EVENT_COUNT; e++)
+                {
+                    total.phaseCounters[p][e] += stats.phaseCounters[p][e];
+                }
+            }
+        }
+
+        writeBenchLine(cout, engine, total.totalTime, total.counters, perf, generations, cellUpdates);
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            if (total.phaseTime[p] > 0)
+            {
+                writeBenchLine(cout, "  " + string(Instrumentation::getPhaseName(static_cast<UpdatePhase>(p))),
+                    total.phaseTime[p], total.phaseCounters[p], perf, generations, cellUpdates);
+            }
+        }
+
+        board->setInstrumentation(NULL);
+        delete board;
+    }
+
+    delete perf;
+    return result;
+}
+
+/// Compute a window at a future generation from its light cone alone.
+static int windowCommand(const CommandLine& cmd)
+{
+    long long row, column, rows, columns;
+    if ((cmd.args.size() < 2) || (sscanf(cmd.get("window", "").c_str(), "%lld,%lld,%lld,%lld",
+            &row, &column, &rows, &columns) != 4) || (rows <= 0) || (columns <= 0))
+    {
+        printUsage();
+        return 1;
+    }
+    CellIndex iMin = row, jMin = column;
+    CellIndex iMax = row + rows - 1, jMax = column + columns - 1;
+    int64_t generations = max<int64_t>(cmd.getInt("generations", 100), 0);
+
+    Board* board = createBoard(cmd);
+    if (!board)
+    {
+        return 1;
+    }
+    if (!Checkpointer::loadCheckpoint(*board, cmd.args[1]))
+    {
+        delete board;
+        return 1;
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<CellCoord> cells;
+    if (!board->getFutureWindow(iMin, jMin, iMax, jMax, generations, cells))
+    {
+        delete board;
+        return 1;
+    }
+    double coneSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Light cone: " << cells.size() << " live cells in window after "
+         << generations << " generations, " << coneSeconds << " s" << endl;
+
+    // Draw the window, live cells as 'O', as long as it fits on a screen.
+    if ((rows <= 200) && (columns <= 200))
+    {
+        size_t c = 0;
+        for (CellIndex i = iMin; i <= iMax; i++)
+        {
+            string line(static_cast<size_t>(columns), '.');
+            for (; (c < cells.size()) && (cells[c].first == i); c++)
+            {
+                line[static_cast<size_t>(cells[c].second - jMin)] = 'O';
+            }
+            cout << line << "\n";
+        }
+    }
+
+    int result = 0;
+    if (cmd.getInt("verify", 0) != 0)
+    {
+        // Run the whole board and compare every cell of the window.
+        start = chrono::steady_clock::now();
+        for (int64_t g = 0; g < generations; g++)
+        {
+            board->update();
+        }
+        double fullSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        int64_t mismatches = 0;
+        size_t c = 0;
+        for (CellIndex i = iMin; i <= iMax; i++)
+        {
+            for (CellIndex j = jMin; j <= jMax; j++)
+            {
+                bool inCone = (c < cells.size()) && (cells[c] == CellCoord(i, j));
+                c += inCone;
+                mismatches += (inCone != board->getCell(i, j));
+            }
+        }
+        cerr << "Full run: " << fullSeconds << " s, " << mismatches << " cells differ" << endl;
+        result = (mismatches == 0) ? 0 : 2;
+    }
+
+    delete board;
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    CommandLine cmd;
+    for (int a = 1; a < argc; a++)
+    {
+        string arg = argv[a];
+        if ((arg.size() > 2) && (arg.compare(0, 2, "--") == 0) && (a + 1 < argc))
+        {
+            cmd.options[arg.substr(2)] = argv[++a];
+        }
+        else
+        {
+            cmd.args.push_back(arg);
+        }
+    }
+
+    if (cmd.args.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (cmd.args[0] == "run")
+    {
+        return runCommand(cmd);
+    }
+    else if (cmd.args[0] == "census")
+    {
+        return censusCommand(cmd);
+    }
+    else if (cmd.args[0] == "bench")
+    {
+        return benchCommand(cmd);
+    }
+    else if (cmd.args[0] == "window")
+    {
+        return windowCommand(cmd);
+    }
+
+    printUsage();
+    return 1;
+}
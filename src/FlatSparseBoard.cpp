@@ -0,0 +1,445 @@
+#include "FlatSparseBoard.h"
+#include "FrozenBoard.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+void FlatSparseBoard::Cells::clear()
+{
+    rows.clear();
+    rowStarts.assign(1, 0);
+    columns.clear();
+}
+
+size_t FlatSparseBoard::Cells::getMemoryUsage() const
+{
+    return rows.capacity() * sizeof(CellIndex) + rowStarts.capacity() * sizeof(size_t) +
+        columns.capacity() * sizeof(CellIndex);
+}
+
+FlatSparseBoard::FlatSparseBoard() :
+    Board()
+{
+    mCells.clear();
+    mNextCells.clear();
+}
+
+size_t FlatSparseBoard::findRow(CellIndex i) const
+{
+    return lower_bound(mCells.rows.begin(), mCells.rows.end(), i) - mCells.rows.begin();
+}
+
+bool FlatSparseBoard::getCell(CellIndex i, CellIndex j) const
+{
+    size_t r = findRow(i);
+    return isRow(r, i) && binary_search(beginRow(r), endRow(r), j);
+}
+
+void FlatSparseBoard::setCell(CellIndex i, CellIndex j, bool alive)
+{
+    size_t r = findRow(i);
+    if (alive)
+    {
+        if (!isRow(r, i))
+        {
+            // Start an empty row, ending where the row after it starts.
+            mCells.rows.insert(mCells.rows.begin() + r, i);
+            mCells.rowStarts.insert(mCells.rowStarts.begin() + r, mCells.rowStarts[r]);
+        }
+        const CellIndex* position = lower_bound(beginRow(r), endRow(r), j);
+        if ((position != endRow(r)) && (*position == j))
+        {
+            return;
+        }
+        mCells.columns.insert(mCells.columns.begin() + (position - mCells.columns.data()), j);
+        for (size_t s = r + 1; s < mCells.rowStarts.size(); s++)
+        {
+            mCells.rowStarts[s]++;
+        }
+        mBox.include(i, j);
+    }
+    else if (isRow(r, i))
+    {
+        const CellIndex* position = lower_bound(beginRow(r), endRow(r), j);
+        if ((position == endRow(r)) || (*position != j))
+        {
+            return;
+        }
+        mCells.columns.erase(mCells.columns.begin() + (position - mCells.columns.data()));
+        for (size_t s = r + 1; s < mCells.rowStarts.size(); s++)
+        {
+            mCells.rowStarts[s]--;
+        }
+        if (mCells.rowStarts[r] == mCells.rowStarts[r + 1])
+        {
+            mCells.rows.erase(mCells.rows.begin() + r);
+            mCells.rowStarts.erase(mCells.rowStarts.begin() + r);
+        }
+        mBox.exclude(i, j);
+    }
+}
+
+void FlatSparseBoard::setCells(const CellCoord* cells, size_t count)
+{
+    vector<CellCoord> sorted(cells, cells + count);
+    if (!is_sorted(sorted.begin(), sorted.end()))
+    {
+        sort(sorted.begin(), sorted.end());
+    }
+
+    // Merge the new cells with the live ones, row by row, into the scratch
+    // arrays, then swap them in.
+    mNextCells.clear();
+    size_t r = 0, c = 0;
+    while ((r < mCells.rows.size()) || (c < sorted.size()))
+    {
+        CellIndex i = (r < mCells.rows.size()) ? mCells.rows[r] : sorted[c].first;
+        if ((c < sorted.size()) && (sorted[c].first < i))
+        {
+            i = sorted[c].first;
+        }
+
+        const CellIndex* column = NULL;
+        const CellIndex* columnEnd = NULL;
+        if (isRow(r, i))
+        {
+            column = beginRow(r);
+            columnEnd = endRow(r);
+            r++;
+        }
+        while ((column != columnEnd) || ((c < sorted.size()) && (sorted[c].first == i)))
+        {
+            CellIndex j;
+            if ((column != columnEnd) && ((c >= sorted.size()) || (sorted[c].first != i) || (*column <= sorted[c].second)))
+            {
+                j = *column++;
+            }
+            else
+            {
+                j = sorted[c++].second;
+                mBox.include(i, j);
+            }
+            if (mNextCells.columns.empty() || (mNextCells.rowStarts.back() == mNextCells.columns.size()) ||
+                (mNextCells.columns.back() != j))
+            {
+                mNextCells.columns.push_back(j);
+            }
+        }
+        mNextCells.rows.push_back(i);
+        mNextCells.rowStarts.push_back(mNextCells.columns.size());
+    }
+    swap(mCells, mNextCells);
+}
+
+void FlatSparseBoard::clearBoard()
+{
+    mCells.clear();
+    mBox.reset();
+}
+
+int64_t FlatSparseBoard::updateRow(CellIndex i, ptrdiff_t above, ptrdiff_t row, ptrdiff_t below)
+{
+    // Merge the three rows into a count of live cells in each column.
+    const CellIndex* heads[3] = { NULL, NULL, NULL };
+    const CellIndex* ends[3] = { NULL, NULL, NULL };
+    const ptrdiff_t rows[3] = { above, row, below };
+    for (int k = 0; k < 3; k++)
+    {
+        if (rows[k] >= 0)
+        {
+            heads[k] = beginRow(static_cast<size_t>(rows[k]));
+            ends[k] = endRow(static_cast<size_t>(rows[k]));
+        }
+    }
+
+    mSums.clear();
+    while ((heads[0] != ends[0]) || (heads[1] != ends[1]) || (heads[2] != ends[2]))
+    {
+        ColumnSum sum;
+        sum.column = INT64_MAX;
+        for (int k = 0; k < 3; k++)
+        {
+            if ((heads[k] != ends[k]) && (*heads[k] < sum.column))
+            {
+                sum.column = *heads[k];
+            }
+        }
+        sum.count = 0;
+        sum.alive = false;
+        for (int k = 0; k < 3; k++)
+        {
+            if ((heads[k] != ends[k]) && (*heads[k] == sum.column))
+            {
+                sum.count++;
+                sum.alive = sum.alive || (k == 1);
+                heads[k]++;
+            }
+        }
+        mSums.push_back(sum);
+    }
+
+    // Visit each column next to a live cell once, in order, adding the
+    // counts of the columns on either side.
+    int64_t survivors = 0;
+    size_t low = 0;
+    CellIndex nextColumn = 0;
+    for (size_t s = 0; s < mSums.size(); s++)
+    {
+        CellIndex first = mSums[s].column - 1;
+        if ((s > 0) && (nextColumn > first))
+        {
+            first = nextColumn;
+        }
+        for (CellIndex j = first; j <= mSums[s].column + 1; j++)
+        {
+            while (mSums[low].column < j - 1)
+            {
+                low++;
+            }
+            int count = 0;
+            bool alive = false;
+            for (size_t t = low; (t < mSums.size()) && (mSums[t].column <= j + 1); t++)
+            {
+                count += mSums[t].count;
+                alive = alive || ((mSums[t].column == j) && mSums[t].alive);
+            }
+
+            int neighbors = count - (alive ? 1 : 0);
+            bool next = (neighbors == NEIGHBOR_COUNT_BIRTH) ||
+                (alive && (neighbors >= NEIGHBOR_COUNT_MIN) && (neighbors <= NEIGHBOR_COUNT_MAX));
+            if (next)
+            {
+                mNextCells.columns.push_back(j);
+                survivors += alive;
+            }
+            if (mChangeSet && (next != alive))
+            {
+                addChange(*mChangeSet, i, j);
+            }
+        }
+        nextColumn = mSums[s].column + 2;
+    }
+    return survivors;
+}
+
+void FlatSparseBoard::update()
+{
+    // Counting and updating happen in the same merge, so all of it is timed
+    // as neighbor counting.
+    Instrumentation* instrumentation = mInstrumentation;
+    if (instrumentation)
+    {
+        instrumentation->beginGeneration();
+        instrumentation->beginPhase(PHASE_NEIGHBOR_COUNT);
+    }
+
+    size_t capacities[4] = { mNextCells.rows.capacity(), mNextCells.rowStarts.capacity(),
+        mNextCells.columns.capacity(), mSums.capacity() };
+
+    if (mChangeSet)
+    {
+        mChangeSet->clear();
+    }
+
+    // Visit each row next to a live row once, in order.
+    const vector<CellIndex>& rows = mCells.rows;
+    mNextCells.clear();
+    mBox.reset();
+    int64_t survivors = 0;
+    size_t low = 0;
+    CellIndex nextRow = 0;
+    for (size_t r = 0; r < rows.size(); r++)
+    {
+        CellIndex first = rows[r] - 1;
+        if ((r > 0) && (nextRow > first))
+        {
+            first = nextRow;
+        }
+        for (CellIndex i = first; i <= rows[r] + 1; i++)
+        {
+            while (rows[low] < i - 1)
+            {
+                low++;
+            }
+            size_t position = low;
+            ptrdiff_t above = -1, row = -1, below = -1;
+            if (isRow(position, i - 1))
+            {
+                above = static_cast<ptrdiff_t>(position++);
+            }
+            if (isRow(position, i))
+            {
+                row = static_cast<ptrdiff_t>(position++);
+            }
+            if (isRow(position, i + 1))
+            {
+                below = static_cast<ptrdiff_t>(position);
+            }
+
+            size_t start = mNextCells.columns.size();
+            survivors += updateRow(i, above, row, below);
+            if (mNextCells.columns.size() > start)
+            {
+                mNextCells.rows.push_back(i);
+                mNextCells.rowStarts.push_back(mNextCells.columns.size());
+                mBox.include(i, mNextCells.columns[start]);
+                mBox.include(i, mNextCells.columns.back());
+            }
+        }
+        nextRow = rows[r] + 2;
+    }
+    notePeakMemory(getMemoryUsage());
+
+    if (instrumentation)
+    {
+        instrumentation->endPhase(PHASE_NEIGHBOR_COUNT);
+        int64_t population = static_cast<int64_t>(mNextCells.columns.size());
+        instrumentation->countBirths(population - survivors);
+        instrumentation->countDeaths(static_cast<int64_t>(mCells.columns.size()) - survivors);
+        instrumentation->countAllocations((mNextCells.rows.capacity() != capacities[0]) +
+            (mNextCells.rowStarts.capacity() != capacities[1]) +
+            (mNextCells.columns.capacity() != capacities[2]) + (mSums.capacity() != capacities[3]));
+        swap(mCells, mNextCells);
+        instrumentation->endGeneration(population);
+    }
+    else
+    {
+        swap(mCells, mNextCells);
+    }
+}
+
+int64_t FlatSparseBoard::getPopulation() const
+{
+    return static_cast<int64_t>(mCells.columns.size());
+}
+
+void FlatSparseBoard::findBoundingBox() const
+{
+    mBox.reset();
+    for (size_t r = 0; r < mCells.rows.size(); r++)
+    {
+        mBox.include(mCells.rows[r], *beginRow(r));
+        mBox.include(mCells.rows[r], *(endRow(r) - 1));
+    }
+}
+
+bool FlatSparseBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    if (mBox.dirty)
+    {
+        findBoundingBox();
+    }
+    return mBox.get(iMin, jMin, iMax, jMax);
+}
+
+int64_t FlatSparseBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+    int64_t count = 0;
+    for (size_t r = findRow(iMin); (r < mCells.rows.size()) && (mCells.rows[r] <= iMax); r++)
+    {
+        count += upper_bound(beginRow(r), endRow(r), jMax) - lower_bound(beginRow(r), endRow(r), jMin);
+    }
+    return (count > 0) ? count : 0;
+}
+
+size_t FlatSparseBoard::getMemoryUsage() const
+{
+    return sizeof(*this) + mCells.getMemoryUsage() + mNextCells.getMemoryUsage() +
+        mSums.capacity() * sizeof(ColumnSum);
+}
+
+size_t FlatSparseBoard::estimateUpdateMemory() const
+{
+    return sizeof(*this) + 2 * mCells.getMemoryUsage() + mSums.capacity() * sizeof(ColumnSum);
+}
+
+size_t FlatSparseBoard::compact()
+{
+    size_t before = getMemoryUsage();
+    mNextCells = Cells();
+    mNextCells.clear();
+    vector<ColumnSum>().swap(mSums);
+    mCells.rows.shrink_to_fit();
+    mCells.rowStarts.shrink_to_fit();
+    mCells.columns.shrink_to_fit();
+    return before - getMemoryUsage();
+}
+
+const int8_t* FlatSparseBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
+{
+    // round width up to nearest 8 (bits)
+    if (width % 8 != 0)
+    {
+        width += 8 - (width % 8);
+    }
+    int bw = width / 8;
+
+    int8_t* bitmap = new int8_t[height * bw];
+    memset(bitmap, 0, height * bw * sizeof(int8_t));
+
+    // Visit only the live cells of each row in range.
+    CellIndex maxRow = iOffset + height;
+    CellIndex maxColumn = jOffset + width;
+    for (size_t r = findRow(iOffset); (r < mCells.rows.size()) && (mCells.rows[r] < maxRow); r++)
+    {
+        int iCount = static_cast<int>(mCells.rows[r] - iOffset);
+        const CellIndex* end = lower_bound(beginRow(r), endRow(r), maxColumn);
+        for (const CellIndex* column = lower_bound(beginRow(r), end, jOffset); column != end; column++)
+        {
+            int jCount = static_cast<int>(*column - jOffset);
+            int8_t &c = bitmap[iCount * bw + (jCount / 8)];
+            c |= 1 << (jCount % 8);
+        }
+    }
+
+    return bitmap;
+}
+
+bool FlatSparseBoard::getFirstLiveCell(CellIndex& i, CellIndex& j) const
+{
+    if (mCells.rows.empty())
+    {
+        return false;
+    }
+    i = mCells.rows[0];
+    j = mCells.columns[0];
+    return true;
+}
+
+bool FlatSparseBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
+{
+    size_t r = findRow(i);
+    if (isRow(r, i))
+    {
+        const CellIndex* column = upper_bound(beginRow(r), endRow(r), j);
+        if (column != endRow(r))
+        {
+            j = *column;
+            return true;
+        }
+        r++;
+    }
+    if (r >= mCells.rows.size())
+    {
+        return false;
+    }
+    i = mCells.rows[r];
+    j = *beginRow(r);
+    return true;
+}
+
+shared_ptr<const Board> FlatSparseBoard::snapshot() const
+{
+    vector<CellCoord> cells;
+    cells.reserve(mCells.columns.size());
+    for (size_t r = 0; r < mCells.rows.size(); r++)
+    {
+        for (const CellIndex* column = beginRow(r); column != endRow(r); column++)
+        {
+            cells.push_back(CellCoord(mCells.rows[r], *column));
+        }
+    }
+    return make_shared<FrozenBoard>(cells);
+}
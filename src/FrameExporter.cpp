@@ -0,0 +1,451 @@
+#include "FrameExporter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <signal.h>
+#endif
+
+using namespace std;
+
+/// Gray level of a live cell.
+static const uint8_t LIVE_PIXEL = 0;
+
+/// Gray level of a dead cell.
+static const uint8_t DEAD_PIXEL = 255;
+
+/// Most bytes in one stored deflate block.
+static const size_t STORED_BLOCK_BYTES = 65535;
+
+FrameExporter::Options::Options() :
+    row(0),
+    column(0),
+    rows(100),
+    columns(100),
+    scale(1),
+    format(FORMAT_PNG),
+    prefix("frame"),
+    threads(1)
+{
+}
+
+bool FrameExporter::parseFormat(const string& name, Format& format)
+{
+    if (name == "png")
+    {
+        format = FORMAT_PNG;
+    }
+    else if (name == "pgm")
+    {
+        format = FORMAT_PGM;
+    }
+    else if (name == "raw")
+    {
+        format = FORMAT_RAW;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void FrameExporter::rasterize(const Board& board, const Options& options, vector<uint8_t>& pixels)
+{
+    int scale = max(options.scale, 1);
+    int width = options.columns;
+    int height = options.rows;
+    int pixelWidth = options.columns * scale;
+    pixels.assign(static_cast<size_t>(pixelWidth) * height * scale, DEAD_PIXEL);
+    if ((width <= 0) || (height <= 0))
+    {
+        return;
+    }
+
+    const int8_t* bitmap = board.getBitmap(options.row, options.column, width, height);
+    int bw = width / 8;
+    for (int r = 0; r < options.rows; r++)
+    {
+        // Draw the first pixel row of the cell row, then copy it down.
+        uint8_t* out = &pixels[static_cast<size_t>(r) * scale * pixelWidth];
+        const int8_t* bits = &bitmap[r * bw];
+        for (int byte = 0; byte < bw; byte++)
+        {
+            if (bits[byte] == 0)
+            {
+                continue;
+            }
+            for (int b = 0; b < 8; b++)
+            {
+                int c = byte * 8 + b;
+                if ((c < options.columns) && ((bits[byte] >> b) & 1))
+                {
+                    memset(out + c * scale, LIVE_PIXEL, scale);
+                }
+            }
+        }
+        for (int s = 1; s < scale; s++)
+        {
+            memcpy(out + s * pixelWidth, out, pixelWidth);
+        }
+    }
+    delete[] bitmap;
+}
+
+/// Table for computing the CRC-32 of PNG chunks a byte at a time.
+struct CrcTable
+{
+    uint32_t entries[256];
+
+    CrcTable()
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+            }
+            entries[n] = c;
+        }
+    }
+};
+
+/// Get the CRC-32 of some bytes, as used by PNG chunks.
+static uint32_t getCrc(const uint8_t* data, size_t size)
+{
+    static const CrcTable table;
+    uint32_t crc = 0xffffffffu;
+    for (size_t n = 0; n < size; n++)
+    {
+        crc = table.entries[(crc ^ data[n]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/// Get the Adler-32 of some bytes, as ending a zlib stream.
+static uint32_t getAdler(const uint8_t* data, size_t size)
+{
+    // Sums can go 5552 bytes before they may overflow 32 bits.
+    uint32_t a = 1, b = 0;
+    while (size > 0)
+    {
+        size_t block = min<size_t>(size, 5552);
+        for (size_t n = 0; n < block; n++)
+        {
+            a += data[n];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+/// Append a 32-bit big-endian number.
+static void appendBigEndian(vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 24));
+    out.push_back(static_cast<uint8_t>(value >> 16));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/// Append a PNG chunk: length, type, data and CRC of type and data.
+static void appendChunk(vector<uint8_t>& out, const char type[4], const uint8_t* data, size_t size)
+{
+    appendBigEndian(out, static_cast<uint32_t>(size));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + size);
+    appendBigEndian(out, getCrc(&out[start], size + 4));
+}
+
+void FrameExporter::encodePng(const vector<uint8_t>& pixels, int width, int height, vector<uint8_t>& out)
+{
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.assign(SIGNATURE, SIGNATURE + 8);
+
+    // Bit depth 1, grayscale, default compression and filter, no interlace.
+    vector<uint8_t> header;
+    appendBigEndian(header, static_cast<uint32_t>(width));
+    appendBigEndian(header, static_cast<uint32_t>(height));
+    const uint8_t format[5] = { 1, 0, 0, 0, 0 };
+    header.insert(header.end(), format, format + 5);
+    appendChunk(out, "IHDR", header.data(), header.size());
+
+    // Each row is a filter type byte of 0 followed by the pixels, 8 to a
+    // byte, first pixel in the high bit; white is 1.
+    size_t rowBytes = 1 + (static_cast<size_t>(width) + 7) / 8;
+    vector<uint8_t> raw(rowBytes * height, 0);
+    for (int r = 0; r < height; r++)
+    {
+        const uint8_t* in = &pixels[static_cast<size_t>(r) * width];
+        uint8_t* row = &raw[r * rowBytes + 1];
+        for (int c = 0; c < width; c++)
+        {
+            if (in[c] != LIVE_PIXEL)
+            {
+                row[c / 8] |= 0x80 >> (c % 8);
+            }
+        }
+    }
+
+    // zlib stream of stored deflate blocks: no compression, so encoding
+    // costs no more than copying, then an Adler-32 of the raw data.
+    vector<uint8_t> zlib;
+    zlib.reserve(raw.size() + raw.size() / STORED_BLOCK_BYTES * 5 + 16);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    size_t offset = 0;
+    do
+    {
+        size_t size = min(raw.size() - offset, STORED_BLOCK_BYTES);
+        bool last = (offset + size == raw.size());
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(size & 0xff));
+        zlib.push_back(static_cast<uint8_t>(size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~size & 0xff));
+        zlib.push_back(static_cast<uint8_t>((~size >> 8) & 0xff));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        offset += size;
+    } while (offset < raw.size());
+
+    appendBigEndian(zlib, getAdler(raw.data(), raw.size()));
+
+    appendChunk(out, "IDAT", zlib.data(), zlib.size());
+    appendChunk(out, "IEND", NULL, 0);
+}
+
+void FrameExporter::encodePgm(const vector<uint8_t>& pixels, int width, int height, vector<uint8_t>& out)
+{
+    ostringstream header;
+    header << "P5\n" << width << " " << height << "\n255\n";
+    string text = header.str();
+    out.assign(text.begin(), text.end());
+    out.insert(out.end(), pixels.begin(), pixels.end());
+}
+
+FrameExporter::FrameExporter(const Options& options) :
+    mOptions(options),
+    mJobs(max(options.threads, 1) * 2),
+    mFrames(max(options.threads, 1) * 2),
+    mPipe(NULL),
+    mQueued(0),
+    mWritten(0),
+    mFailed(0),
+    mBytes(0),
+    mStallSeconds(0)
+{
+    mOptions.scale = max(mOptions.scale, 1);
+    mOptions.threads = max(mOptions.threads, 1);
+    if (!mOptions.pipeCommand.empty())
+    {
+#ifndef _WIN32
+        // If the encoder quits, writes should fail rather than kill us.
+        signal(SIGPIPE, SIG_IGN);
+#endif
+        mPipe = popen(mOptions.pipeCommand.c_str(), "w");
+        if (!mPipe)
+        {
+            cerr << "Failed to run " << mOptions.pipeCommand << endl;
+        }
+    }
+
+    mRunningRenderers = mOptions.threads;
+    for (int t = 0; t < mOptions.threads; t++)
+    {
+        mRenderers.push_back(thread(&FrameExporter::render, this));
+    }
+    mWriter = thread(&FrameExporter::write, this);
+}
+
+FrameExporter::~FrameExporter()
+{
+    mJobs.close();
+    for (size_t t = 0; t < mRenderers.size(); t++)
+    {
+        mRenderers[t].join();
+    }
+    mWriter.join();
+    if (mPipe)
+    {
+        pclose(mPipe);
+    }
+}
+
+bool FrameExporter::isOpen() const
+{
+    return mOptions.pipeCommand.empty() || (mPipe != NULL);
+}
+
+bool FrameExporter::addFrame(const Board& board)
+{
+    Job job;
+    job.board = board.snapshot();
+    {
+        lock_guard<mutex> lock(mMutex);
+        job.frame = mQueued++;
+    }
+
+    auto start = chrono::steady_clock::now();
+    bool queued = mJobs.push(job);
+    double waited = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    lock_guard<mutex> lock(mMutex);
+    mStallSeconds += waited;
+    if (!queued)
+    {
+        // Later frames can't have been numbered yet, since only the thread
+        // updating the board adds them.
+        mQueued--;
+        mFinished.notify_all();
+    }
+    return queued;
+}
+
+void FrameExporter::flush()
+{
+    unique_lock<mutex> lock(mMutex);
+    while (mWritten + mFailed < mQueued)
+    {
+        mFinished.wait(lock);
+    }
+}
+
+void FrameExporter::render()
+{
+    Job job;
+    vector<uint8_t> pixels;
+    while (mJobs.pop(job))
+    {
+        rasterize(*job.board, mOptions, pixels);
+        job.board.reset();
+
+        Frame frame;
+        frame.frame = job.frame;
+        switch (mOptions.format)
+        {
+        case FORMAT_PNG:
+            encodePng(pixels, getWidth(), getHeight(), frame.data);
+            break;
+        case FORMAT_PGM:
+            encodePgm(pixels, getWidth(), getHeight(), frame.data);
+            break;
+        default:
+            frame.data = pixels;
+            break;
+        }
+        mFrames.push(move(frame));
+    }
+
+    // The last renderer to finish tells the writer there is no more.
+    lock_guard<mutex> lock(mMutex);
+    if (--mRunningRenderers == 0)
+    {
+        mFrames.close();
+    }
+}
+
+void FrameExporter::write()
+{
+    // Renderers may finish frames out of order; hold frames back until the
+    // ones before them are written.
+    map<uint64_t, Frame> waiting;
+    uint64_t next = 0;
+    Frame frame;
+    while (mFrames.pop(frame))
+    {
+        uint64_t number = frame.frame;
+        waiting[number] = move(frame);
+        for (auto iter = waiting.find(next); iter != waiting.end(); iter = waiting.find(next))
+        {
+            bool written = writeFrame(iter->second);
+            size_t bytes = iter->second.data.size();
+            waiting.erase(iter);
+            next++;
+
+            lock_guard<mutex> lock(mMutex);
+            if (written)
+            {
+                mWritten++;
+                mBytes += bytes;
+            }
+            else
+            {
+                mFailed++;
+            }
+            mFinished.notify_all();
+        }
+    }
+}
+
+bool FrameExporter::writeFrame(const Frame& frame)
+{
+    if (!mOptions.pipeCommand.empty())
+    {
+        if (!mPipe || (fwrite(frame.data.data(), 1, frame.data.size(), mPipe) != frame.data.size()) ||
+            (fflush(mPipe) != 0))
+        {
+            cerr << "Failed to write frame " << frame.frame << " to " << mOptions.pipeCommand << endl;
+            return false;
+        }
+        return true;
+    }
+
+    static const char* const EXTENSIONS[] = { ".png", ".pgm", ".raw" };
+    ostringstream fileName;
+    fileName << mOptions.prefix;
+    fileName.width(6);
+    fileName.fill('0');
+    fileName << frame.frame << EXTENSIONS[mOptions.format];
+
+    ofstream outFile(fileName.str().c_str(), ios::binary | ios::trunc);
+    if (!outFile.is_open())
+    {
+        cerr << "Failed to open " << fileName.str() << endl;
+        return false;
+    }
+    outFile.write(reinterpret_cast<const char*>(frame.data.data()), frame.data.size());
+    outFile.close();
+    if (!outFile)
+    {
+        cerr << "Failed to write " << fileName.str() << endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t FrameExporter::getWritten()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mWritten;
+}
+
+uint64_t FrameExporter::getFailed()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mFailed;
+}
+
+uint64_t FrameExporter::getBytes()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mBytes;
+}
+
+double FrameExporter::getStallSeconds()
+{
+    lock_guard<mutex> lock(mMutex);
+    return mStallSeconds;
+}
@@ -0,0 +1,147 @@
+#include "FrozenBoard.h"
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+using namespace std;
+
+FrozenBoard::FrozenBoard(vector<CellCoord>& cells) :
+    Board()
+{
+    assert(is_sorted(cells.begin(), cells.end()));
+    mCells.swap(cells);
+    for (size_t c = 0; c < mCells.size(); c++)
+    {
+        mBox.include(mCells[c].first, mCells[c].second);
+    }
+}
+
+vector<CellCoord>::const_iterator FrozenBoard::lowerBound(CellIndex i, CellIndex j) const
+{
+    return lower_bound(mCells.begin(), mCells.end(), CellCoord(i, j));
+}
+
+bool FrozenBoard::getCell(CellIndex i, CellIndex j) const
+{
+    return binary_search(mCells.begin(), mCells.end(), CellCoord(i, j));
+}
+
+void FrozenBoard::setCell(CellIndex, CellIndex, bool)
+{
+}
+
+void FrozenBoard::clearBoard()
+{
+}
+
+void FrozenBoard::update()
+{
+    if (mChangeSet)
+    {
+        mChangeSet->clear();
+    }
+}
+
+const int8_t* FrozenBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
+{
+    // round width up to nearest 8 (bits)
+    if (width % 8 != 0)
+    {
+        width += 8 - (width % 8);
+    }
+    int bw = width / 8;
+
+    int8_t* bitmap = new int8_t[height * bw];
+    memset(bitmap, 0, height * bw * sizeof(int8_t));
+
+    // Visit only the live cells of each row in range.
+    CellIndex maxRow = iOffset + height;
+    CellIndex maxColumn = jOffset + width;
+    auto iter = lowerBound(iOffset, jOffset);
+    while ((iter != mCells.end()) && (iter->first < maxRow))
+    {
+        CellIndex i = iter->first;
+        if (iter->second < jOffset)
+        {
+            // Landed at the start of a later row, left of the range.
+            iter = lowerBound(i, jOffset);
+            continue;
+        }
+        for (; (iter != mCells.end()) && (iter->first == i) && (iter->second < maxColumn); iter++)
+        {
+            int iCount = static_cast<int>(i - iOffset);
+            int jCount = static_cast<int>(iter->second - jOffset);
+            int8_t &c = bitmap[iCount * bw + (jCount / 8)];
+            c |= 1 << (jCount % 8);
+        }
+        if (i + 1 >= maxRow)
+        {
+            break;
+        }
+        iter = lowerBound(i + 1, jOffset);
+    }
+
+    return bitmap;
+}
+
+bool FrozenBoard::getFirstLiveCell(CellIndex& i, CellIndex& j) const
+{
+    if (mCells.empty())
+    {
+        return false;
+    }
+    i = mCells.front().first;
+    j = mCells.front().second;
+    return true;
+}
+
+bool FrozenBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
+{
+    auto iter = upper_bound(mCells.begin(), mCells.end(), CellCoord(i, j));
+    if (iter == mCells.end())
+    {
+        return false;
+    }
+    i = iter->first;
+    j = iter->second;
+    return true;
+}
+
+int64_t FrozenBoard::getPopulation() const
+{
+    return static_cast<int64_t>(mCells.size());
+}
+
+bool FrozenBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    return mBox.get(iMin, jMin, iMax, jMax);
+}
+
+int64_t FrozenBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+    int64_t count = 0;
+    auto iter = lowerBound(iMin, jMin);
+    while ((iter != mCells.end()) && (iter->first <= iMax))
+    {
+        CellIndex i = iter->first;
+        if (iter->second < jMin)
+        {
+            // Landed at the start of a later row, left of the range.
+            iter = lowerBound(i, jMin);
+            continue;
+        }
+        auto rowEnd = upper_bound(iter, mCells.cend(), CellCoord(i, jMax));
+        count += rowEnd - iter;
+        if (i >= iMax)
+        {
+            break;
+        }
+        iter = lowerBound(i + 1, jMin);
+    }
+    return count;
+}
+
+size_t FrozenBoard::getMemoryUsage() const
+{
+    return sizeof(*this) + mCells.capacity() * sizeof(CellCoord);
+}
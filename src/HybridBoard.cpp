@@ -0,0 +1,294 @@
+#include "HybridBoard.h"
+#include <algorithm>
+#include <assert.h>
+#include <iostream>
+
+using namespace std;
+
+const double HybridBoard::DENSE_DENSITY = 1.0 / 256;
+const double HybridBoard::SPARSE_DENSITY = 1.0 / 1024;
+
+HybridBoard::HybridBoard() :
+    Board()
+{
+    mDense = NULL;
+    mGeneration = 0;
+    mLastSwitch = 0;
+}
+
+HybridBoard::~HybridBoard()
+{
+    delete mDense;
+}
+
+Board* HybridBoard::current() const
+{
+    if (mDense)
+    {
+        return mDense;
+    }
+    return const_cast<SparseBoard*>(&mSparse);
+}
+
+bool HybridBoard::makeDense(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax)
+{
+    double rows = static_cast<double>(iMax) - iMin + 1 + 2 * DENSE_MARGIN;
+    double columns = static_cast<double>(jMax) - jMin + 1 + 2 * DENSE_MARGIN;
+    if (rows * columns > MAX_DENSE_CELLS)
+    {
+        return false;
+    }
+
+    PackedBoard* dense = new PackedBoard(static_cast<CellIndex>(rows), static_cast<CellIndex>(columns),
+        iMin - DENSE_MARGIN, jMin - DENSE_MARGIN);
+    notePeakMemory(getMemoryUsage() + dense->getMemoryUsage());
+
+    vector<CellCoord> cells;
+    cells.reserve(static_cast<size_t>(getPopulation()));
+    CellIndex i, j;
+    Board* from = current();
+    if (from->getFirstLiveCell(i, j))
+    {
+        do
+        {
+            cells.push_back(CellCoord(i, j));
+        } while (from->getNextLiveCell(i, j));
+    }
+    dense->setCells(cells.data(), cells.size());
+
+    delete mDense;
+    mSparse.clearBoard();
+    mDense = dense;
+    return true;
+}
+
+void HybridBoard::makeSparse()
+{
+    assert(mDense);
+    vector<CellCoord> cells;
+    cells.reserve(static_cast<size_t>(getPopulation()));
+    CellIndex i, j;
+    if (mDense->getFirstLiveCell(i, j))
+    {
+        do
+        {
+            cells.push_back(CellCoord(i, j));
+        } while (mDense->getNextLiveCell(i, j));
+    }
+    mSparse.setCells(cells.data(), cells.size());
+    notePeakMemory(getMemoryUsage());
+
+    delete mDense;
+    mDense = NULL;
+}
+
+void HybridBoard::logSwitch(bool toDense, int64_t population, double density)
+{
+    SwitchEvent event;
+    event.generation = mGeneration;
+    event.toDense = toDense;
+    event.population = population;
+    event.density = density;
+    mSwitchLog.push_back(event);
+    mLastSwitch = mGeneration;
+
+    clog << "Generation " << mGeneration << ": switched to "
+         << (toDense ? "dense" : "sparse") << " board (population "
+         << population << ", density " << density << ")" << endl;
+}
+
+void HybridBoard::chooseRepresentation()
+{
+    if (!mSwitchLog.empty() && (mGeneration - mLastSwitch < MIN_SWITCH_INTERVAL))
+    {
+        return;
+    }
+
+    int64_t population = getPopulation();
+    CellIndex iMin, jMin, iMax, jMax;
+    if (!getBoundingBox(iMin, jMin, iMax, jMax))
+    {
+        if (mDense)
+        {
+            makeSparse();
+            logSwitch(false, 0, 0);
+        }
+        return;
+    }
+
+    // Density is measured over the area a dense board would cover, margin
+    // included, since that is what a dense update has to sweep.
+    double area = (static_cast<double>(iMax) - iMin + 1 + 2 * DENSE_MARGIN) *
+        (static_cast<double>(jMax) - jMin + 1 + 2 * DENSE_MARGIN);
+    double density = population / area;
+
+    if (!mDense && (density >= DENSE_DENSITY))
+    {
+        if (makeDense(iMin, jMin, iMax, jMax))
+        {
+            logSwitch(true, population, density);
+        }
+    }
+    else if (mDense && (density < SPARSE_DENSITY))
+    {
+        makeSparse();
+        logSwitch(false, population, density);
+    }
+}
+
+bool HybridBoard::getCell(CellIndex i, CellIndex j) const
+{
+    return current()->getCell(i, j);
+}
+
+void HybridBoard::coverDense(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax)
+{
+    if (!mDense ||
+        ((iMin >= mDense->getFirstRow()) && (iMax < mDense->getFirstRow() + mDense->getRows()) &&
+         (jMin >= mDense->getFirstColumn()) && (jMax < mDense->getFirstColumn() + mDense->getColumns())))
+    {
+        return;
+    }
+
+    // Regrow the dense board to take in the new cells, or give up on it.
+    int64_t population = getPopulation();
+    CellIndex iLive, jLive, iLiveMax, jLiveMax;
+    if (getBoundingBox(iLive, jLive, iLiveMax, jLiveMax))
+    {
+        iMin = min(iMin, iLive);
+        jMin = min(jMin, jLive);
+        iMax = max(iMax, iLiveMax);
+        jMax = max(jMax, jLiveMax);
+    }
+    if (!makeDense(iMin, jMin, iMax, jMax))
+    {
+        makeSparse();
+        logSwitch(false, population, 0);
+    }
+}
+
+void HybridBoard::setCell(CellIndex i, CellIndex j, bool alive)
+{
+    if (alive)
+    {
+        coverDense(i, j, i, j);
+    }
+    current()->setCell(i, j, alive);
+}
+
+void HybridBoard::setCells(const CellCoord* cells, size_t count)
+{
+    if (mDense && (count > 0))
+    {
+        BoundingBox box;
+        for (size_t c = 0; c < count; c++)
+        {
+            box.include(cells[c].first, cells[c].second);
+        }
+        coverDense(box.iMin, box.jMin, box.iMax, box.jMax);
+    }
+    current()->setCells(cells, count);
+}
+
+void HybridBoard::clearBoard()
+{
+    delete mDense;
+    mDense = NULL;
+    mSparse.clearBoard();
+}
+
+void HybridBoard::update()
+{
+    // Cells on the edge of a dense board may give birth outside of it.
+    if (mDense && mDense->touchesEdge())
+    {
+        CellIndex iMin, jMin, iMax, jMax;
+        getBoundingBox(iMin, jMin, iMax, jMax);
+        coverDense(iMin - 1, jMin - 1, iMax + 1, jMax + 1);
+    }
+
+    Board* board = current();
+    board->setInstrumentation(mInstrumentation);
+    board->setChangeSet(mChangeSet);
+    board->update();
+    board->setInstrumentation(NULL);
+    board->setChangeSet(NULL);
+    notePeakMemory(getMemoryUsage() - board->getMemoryUsage() + board->getPeakMemoryUsage());
+
+    mGeneration++;
+    if (mGeneration % CHECK_INTERVAL == 0)
+    {
+        chooseRepresentation();
+    }
+}
+
+const int8_t* HybridBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
+{
+    return current()->getBitmap(iOffset, jOffset, width, height);
+}
+
+bool HybridBoard::getFirstLiveCell(CellIndex& i, CellIndex& j) const
+{
+    return current()->getFirstLiveCell(i, j);
+}
+
+bool HybridBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
+{
+    return current()->getNextLiveCell(i, j);
+}
+
+int64_t HybridBoard::getPopulation() const
+{
+    return current()->getPopulation();
+}
+
+bool HybridBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    return current()->getBoundingBox(iMin, jMin, iMax, jMax);
+}
+
+int64_t HybridBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+    return current()->countCells(iMin, jMin, iMax, jMax);
+}
+
+size_t HybridBoard::getMemoryUsage() const
+{
+    size_t bytes = sizeof(*this) - sizeof(mSparse) + mSparse.getMemoryUsage();
+    if (mDense)
+    {
+        bytes += mDense->getMemoryUsage();
+    }
+    return bytes;
+}
+
+size_t HybridBoard::estimateUpdateMemory() const
+{
+    return getMemoryUsage() - current()->getMemoryUsage() + current()->estimateUpdateMemory();
+}
+
+size_t HybridBoard::compact()
+{
+    size_t before = getMemoryUsage();
+    if (mDense)
+    {
+        // A sparse board costs on the order of 64 bytes per live cell.
+        int64_t population = mDense->getPopulation();
+        if (static_cast<size_t>(population) * 64 < mDense->estimateUpdateMemory())
+        {
+            makeSparse();
+            logSwitch(false, population, 0);
+        }
+        else
+        {
+            mDense->compact();
+        }
+    }
+    size_t after = getMemoryUsage();
+    return (before > after) ? (before - after) : 0;
+}
+
+shared_ptr<const Board> HybridBoard::snapshot() const
+{
+    return current()->snapshot();
+}
@@ -0,0 +1,274 @@
+#include "Instrumentation.h"
+
+using namespace std;
+
+Instrumentation::Instrumentation(ostream& out, Format format, PerfCounters* perf) :
+    mOut(out), mFormat(format), mFirstRecord(true), mGeneration(0)
+{
+    mPerf = (perf && perf->isAvailable()) ? perf : NULL;
+    mEpoch = Clock::now();
+    mGenerationStart = mEpoch;
+    for (int p = 0; p < PHASE_COUNT; p++)
+    {
+        mPhaseStart[p] = mEpoch;
+    }
+    mCurrent = GenerationStats();
+    mLast = GenerationStats();
+
+    if (mFormat == FORMAT_CSV)
+    {
+        mOut << "generation,population,births,deaths,allocations,total_us";
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            mOut << "," << getPhaseName(static_cast<UpdatePhase>(p)) << "_us";
+        }
+        if (mPerf)
+        {
+            for (int e = 0; e < PERF_EVENT_COUNT; e++)
+            {
+                mOut << "," << PerfCounters::getEventName(static_cast<PerfEvent>(e));
+            }
+            for (int p = 0; p < PHASE_COUNT; p++)
+            {
+                for (int e = 0; e < PERF_EVENT_COUNT; e++)
+                {
+                    mOut << "," << getPhaseName(static_cast<UpdatePhase>(p)) << "_"
+                         << PerfCounters::getEventName(static_cast<PerfEvent>(e));
+                }
+            }
+        }
+        mOut << "\n";
+    }
+    else if (mFormat == FORMAT_CHROME_TRACE)
+    {
+        mOut << "[\n";
+    }
+}
+
+Instrumentation::~Instrumentation()
+{
+    if (mFormat == FORMAT_CHROME_TRACE)
+    {
+        mOut << "\n]\n";
+    }
+    mOut.flush();
+}
+
+bool Instrumentation::parseFormat(const string& name, Format& format)
+{
+    if (name == "csv")
+    {
+        format = FORMAT_CSV;
+    }
+    else if (name == "json")
+    {
+        format = FORMAT_JSON;
+    }
+    else if (name == "chrome")
+    {
+        format = FORMAT_CHROME_TRACE;
+    }
+    else if (name == "none")
+    {
+        format = FORMAT_NONE;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char* Instrumentation::getPhaseName(UpdatePhase phase)
+{
+    switch (phase)
+    {
+    case PHASE_NEIGHBOR_COUNT:
+        return "neighbor_count";
+    case PHASE_BIRTH:
+        return "birth";
+    case PHASE_DEATH:
+        return "death";
+    default:
+        return "unknown";
+    }
+}
+
+double Instrumentation::elapsed(Clock::time_point from, Clock::time_point to)
+{
+    return chrono::duration<double, micro>(to - from).count();
+}
+
+void Instrumentation::beginGeneration()
+{
+    mCurrent = GenerationStats();
+    mCurrent.generation = ++mGeneration;
+    mGenerationStart = Clock::now();
+    mCurrent.startTime = elapsed(mEpoch, mGenerationStart);
+    if (mPerf)
+    {
+        mPerf->read(mGenerationCounters);
+    }
+}
+
+void Instrumentation::endGeneration(int64_t population)
+{
+    if (mPerf)
+    {
+        addCountersSince(mGenerationCounters, mCurrent.counters);
+    }
+    mCurrent.population = population;
+    mCurrent.totalTime = elapsed(mGenerationStart, Clock::now());
+    mLast = mCurrent;
+    writeStats(mLast);
+}
+
+void Instrumentation::beginPhase(UpdatePhase phase)
+{
+    mPhaseStart[phase] = Clock::now();
+    if (mPerf)
+    {
+        mPerf->read(mPhaseCounters[phase]);
+    }
+}
+
+void Instrumentation::endPhase(UpdatePhase phase)
+{
+    if (mPerf)
+    {
+        addCountersSince(mPhaseCounters[phase], mCurrent.phaseCounters[phase]);
+    }
+    mCurrent.phaseTime[phase] += elapsed(mPhaseStart[phase], Clock::now());
+}
+
+void Instrumentation::addCountersSince(const uint64_t start[PERF_EVENT_COUNT], uint64_t total[PERF_EVENT_COUNT])
+{
+    uint64_t now[PERF_EVENT_COUNT];
+    mPerf->read(now);
+    for (int e = 0; e < PERF_EVENT_COUNT; e++)
+    {
+        // Scaling can make a multiplexed counter appear to step back.
+        total[e] += (now[e] > start[e]) ? now[e] - start[e] : 0;
+    }
+}
+
+void Instrumentation::writeCounterArgs(const uint64_t counters[PERF_EVENT_COUNT])
+{
+    if (mPerf)
+    {
+        for (int e = 0; e < PERF_EVENT_COUNT; e++)
+        {
+            mOut << ",\"" << PerfCounters::getEventName(static_cast<PerfEvent>(e)) << "\":" << counters[e];
+        }
+    }
+}
+
+void Instrumentation::writeStats(const GenerationStats& stats)
+{
+    switch (mFormat)
+    {
+    case FORMAT_CSV:
+        mOut << stats.generation << "," << stats.population << ","
+             << stats.births << "," << stats.deaths << ","
+             << stats.allocations << "," << stats.totalTime;
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            mOut << "," << stats.phaseTime[p];
+        }
+        if (mPerf)
+        {
+            for (int e = 0; e < PERF_EVENT_COUNT; e++)
+            {
+                mOut << "," << stats.counters[e];
+            }
+            for (int p = 0; p < PHASE_COUNT; p++)
+            {
+                for (int e = 0; e < PERF_EVENT_COUNT; e++)
+                {
+                    mOut << "," << stats.phaseCounters[p][e];
+                }
+            }
+        }
+        mOut << "\n";
+        break;
+
+    case FORMAT_JSON:
+        mOut << "{\"generation\":" << stats.generation
+             << ",\"population\":" << stats.population
+             << ",\"births\":" << stats.births
+             << ",\"deaths\":" << stats.deaths
+             << ",\"allocations\":" << stats.allocations
+             << ",\"total_us\":" << stats.totalTime;
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            mOut << ",\"" << getPhaseName(static_cast<UpdatePhase>(p)) << "_us\":"
+                 << stats.phaseTime[p];
+        }
+        if (mPerf)
+        {
+            for (int e = 0; e < PERF_EVENT_COUNT; e++)
+            {
+                mOut << ",\"" << PerfCounters::getEventName(static_cast<PerfEvent>(e)) << "\":"
+                     << stats.counters[e];
+            }
+            for (int p = 0; p < PHASE_COUNT; p++)
+            {
+                for (int e = 0; e < PERF_EVENT_COUNT; e++)
+                {
+                    mOut << ",\"" << getPhaseName(static_cast<UpdatePhase>(p)) << "_"
+                         << PerfCounters::getEventName(static_cast<PerfEvent>(e)) << "\":"
+                         << stats.phaseCounters[p][e];
+                }
+            }
+        }
+        mOut << "}\n";
+        break;
+
+    case FORMAT_CHROME_TRACE:
+    {
+        // Phases may be interleaved many times within an update (e.g. row by
+        // row in SparseBoard), so each phase is drawn as one slice holding
+        // its total time, laid end to end inside the update slice.
+        if (!mFirstRecord)
+        {
+            mOut << ",\n";
+        }
+        mOut << "{\"name\":\"update\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+             << ",\"ts\":" << stats.startTime << ",\"dur\":" << stats.totalTime
+             << ",\"args\":{\"generation\":" << stats.generation
+             << ",\"allocations\":" << stats.allocations;
+        writeCounterArgs(stats.counters);
+        mOut << "}}";
+        double ts = stats.startTime;
+        for (int p = 0; p < PHASE_COUNT; p++)
+        {
+            if (stats.phaseTime[p] <= 0)
+            {
+                continue;
+            }
+            mOut << ",\n{\"name\":\"" << getPhaseName(static_cast<UpdatePhase>(p))
+                 << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+                 << ",\"ts\":" << ts << ",\"dur\":" << stats.phaseTime[p];
+            if (mPerf)
+            {
+                mOut << ",\"args\":{\"generation\":" << stats.generation;
+                writeCounterArgs(stats.phaseCounters[p]);
+                mOut << "}";
+            }
+            mOut << "}";
+            ts += stats.phaseTime[p];
+        }
+        mOut << ",\n{\"name\":\"cells\",\"ph\":\"C\",\"pid\":1,\"tid\":1"
+             << ",\"ts\":" << stats.startTime
+             << ",\"args\":{\"population\":" << stats.population
+             << ",\"births\":" << stats.births
+             << ",\"deaths\":" << stats.deaths << "}}";
+        break;
+    }
+
+    case FORMAT_NONE:
+        return;
+    }
+
+    mFirstRecord = false;
+}
@@ -0,0 +1,423 @@
+#include "LargerThanLifeBoard.h"
+#include "BitLife.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+using namespace std;
+
+LargerThanLifeBoard::Rule::Rule() :
+    radius(1),
+    countsSelf(false),
+    birthMin(3),
+    birthMax(3),
+    survivalMin(2),
+    survivalMax(3)
+{
+}
+
+/**
+ * Read a number of at most 6 digits at pos, moving pos past it.
+ * @return false if there are no digits at pos.
+ */
+static bool parseNumber(const string& text, size_t& pos, int& value)
+{
+    size_t start = pos;
+    value = 0;
+    while ((pos < text.size()) && isdigit(static_cast<unsigned char>(text[pos])) && (pos - start < 6))
+    {
+        value = value * 10 + (text[pos] - '0');
+        pos++;
+    }
+    return pos > start;
+}
+
+/**
+ * Read a range of neighbor counts, "a..b" or just "a", that makes up the
+ * rest of a rule item after its letter.
+ */
+static bool parseRange(const string& item, int& low, int& high)
+{
+    size_t pos = 1;
+    if (!parseNumber(item, pos, low))
+    {
+        return false;
+    }
+    high = low;
+    if (item.compare(pos, 2, "..") == 0)
+    {
+        pos += 2;
+        if (!parseNumber(item, pos, high))
+        {
+            return false;
+        }
+    }
+    return (pos == item.size()) && (low <= high);
+}
+
+bool LargerThanLifeBoard::parseRule(const string& text, Rule& rule)
+{
+    Rule parsed;
+    bool hasRadius = false, hasBirth = false, hasSurvival = false;
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        if (item.empty())
+        {
+            return false;
+        }
+        transform(item.begin(), item.end(), item.begin(), ::toupper);
+
+        size_t pos = 1;
+        int value = 0;
+        switch (item[0])
+        {
+        case 'R':
+            if (!parseNumber(item, pos, value) || (pos != item.size()) ||
+                (value < 1) || (value > MAX_RADIUS))
+            {
+                return false;
+            }
+            parsed.radius = value;
+            hasRadius = true;
+            break;
+        case 'C':
+            // Rules with more states decay through them like Generations,
+            // which a board of live and dead cells can't show.
+            if (!parseNumber(item, pos, value) || (pos != item.size()) || ((value != 0) && (value != 2)))
+            {
+                return false;
+            }
+            break;
+        case 'M':
+            if (!parseNumber(item, pos, value) || (pos != item.size()) || (value > 1))
+            {
+                return false;
+            }
+            parsed.countsSelf = (value == 1);
+            break;
+        case 'S':
+            if (!parseRange(item, parsed.survivalMin, parsed.survivalMax))
+            {
+                return false;
+            }
+            hasSurvival = true;
+            break;
+        case 'B':
+            if (!parseRange(item, parsed.birthMin, parsed.birthMax))
+            {
+                return false;
+            }
+            hasBirth = true;
+            break;
+        case 'N':
+            if (item != "NM")
+            {
+                return false;
+            }
+            break;
+        default:
+            return false;
+        }
+    }
+
+    if (!hasRadius || !hasBirth || !hasSurvival)
+    {
+        return false;
+    }
+    rule = parsed;
+    return true;
+}
+
+string LargerThanLifeBoard::formatRule(const Rule& rule)
+{
+    ostringstream text;
+    text << "R" << rule.radius << ",C0,M" << (rule.countsSelf ? 1 : 0)
+         << ",S" << rule.survivalMin << ".." << rule.survivalMax
+         << ",B" << rule.birthMin << ".." << rule.birthMax << ",NM";
+    return text.str();
+}
+
+LargerThanLifeBoard::LargerThanLifeBoard(const Rule& rule, CellIndex rows, CellIndex columns,
+    CellIndex firstRow, CellIndex firstColumn) :
+    PackedBoard(rows, columns, firstRow, firstColumn)
+{
+    setRule(rule);
+}
+
+void LargerThanLifeBoard::setRule(const Rule& rule)
+{
+    mRule = rule;
+    mRule.radius = min(max(mRule.radius, 1), static_cast<int>(MAX_RADIUS));
+}
+
+int64_t LargerThanLifeBoard::addRowSums(CellIndex r, int sign)
+{
+    const uint64_t* row = getRow(r);
+    int64_t population = 0;
+    for (size_t w = 0; w < mWordsPerRow; w++)
+    {
+        population += popCount(row[w]);
+    }
+    if (population == 0)
+    {
+        return 0;
+    }
+
+    // Entries before column 0 and past the last column are padding, so
+    // that the sums need no checks at the edges.
+    size_t radius = static_cast<size_t>(mRule.radius);
+    size_t columns = static_cast<size_t>(mColumns);
+    int32_t* prefix = mPrefix.data();
+    int32_t sum = 0;
+    for (size_t k = 0; k <= radius; k++)
+    {
+        prefix[k] = 0;
+    }
+    for (size_t w = 0; w < mWordsPerRow; w++)
+    {
+        uint64_t word = row[w];
+        size_t first = w * BITS_PER_WORD;
+        size_t last = min(first + BITS_PER_WORD, columns);
+        if (word == 0)
+        {
+            fill(prefix + radius + 1 + first, prefix + radius + 1 + last, sum);
+            continue;
+        }
+        for (size_t c = first; c < last; c++, word >>= 1)
+        {
+            sum += static_cast<int32_t>(word & 1);
+            prefix[radius + 1 + c] = sum;
+        }
+    }
+    fill(prefix + radius + 1 + columns, prefix + mPrefix.size(), sum);
+
+    int32_t* windowSums = mWindowSums.data();
+    size_t span = 2 * radius + 1;
+    if (sign > 0)
+    {
+        for (size_t c = 0; c < columns; c++)
+        {
+            windowSums[c] += prefix[c + span] - prefix[c];
+        }
+    }
+    else
+    {
+        for (size_t c = 0; c < columns; c++)
+        {
+            windowSums[c] -= prefix[c + span] - prefix[c];
+        }
+    }
+    return population;
+}
+
+void LargerThanLifeBoard::update()
+{
+    // Counting and updating happen in the same pass, so all of it is timed
+    // as neighbor counting.
+    Instrumentation* instrumentation = mInstrumentation;
+    if (instrumentation)
+    {
+        instrumentation->beginGeneration();
+        instrumentation->beginPhase(PHASE_NEIGHBOR_COUNT);
+    }
+
+    if (mChangeSet)
+    {
+        mChangeSet->clear();
+    }
+
+    // The scratch buffer held the previous generation, which a snapshot may
+    // still be reading.
+    if (!mNextCells || isShared(mNextCells))
+    {
+        mNextCells = make_shared<Words>(mCells->size());
+        if (instrumentation)
+        {
+            instrumentation->countAllocations(1);
+        }
+    }
+    size_t columns = static_cast<size_t>(mColumns);
+    mWindowSums.assign(columns, 0);
+    mPrefix.resize(columns + 2 * mRule.radius + 1);
+    notePeakMemory(getMemoryUsage());
+
+    // With no live cells in range, a cell can only be born if no neighbors
+    // are enough.
+    bool emptyStaysEmpty = (mRule.birthMin > 0);
+    uint32_t birthSpan = static_cast<uint32_t>(mRule.birthMax - mRule.birthMin);
+    uint32_t survivalSpan = static_cast<uint32_t>(mRule.survivalMax - mRule.survivalMin);
+    int32_t self = mRule.countsSelf ? 0 : 1;
+
+    mPopulation = 0;
+    mBox.reset();
+    int64_t windowPopulation = 0;
+    for (CellIndex r = 0; r < mRows; r++)
+    {
+        // Slide the window of rows down to [r - R, r + R].
+        if (r == 0)
+        {
+            for (CellIndex k = 0; (k < mRule.radius) && (k < mRows); k++)
+            {
+                windowPopulation += addRowSums(k, 1);
+            }
+        }
+        if (r + mRule.radius < mRows)
+        {
+            windowPopulation += addRowSums(r + mRule.radius, 1);
+        }
+        if (r - mRule.radius - 1 >= 0)
+        {
+            windowPopulation -= addRowSums(r - mRule.radius - 1, -1);
+        }
+
+        uint64_t* out = &(*mNextCells)[r * mWordsPerRow];
+        if ((windowPopulation == 0) && emptyStaysEmpty)
+        {
+            fill(out, out + mWordsPerRow, uint64_t(0));
+            continue;
+        }
+
+        const uint64_t* row = getRow(r);
+        const int32_t* windowSums = mWindowSums.data();
+        for (size_t w = 0; w < mWordsPerRow; w++)
+        {
+            uint64_t word = row[w];
+            uint64_t next = 0;
+            size_t first = w * BITS_PER_WORD;
+            size_t last = min(first + BITS_PER_WORD, columns);
+            for (size_t c = first; c < last; c++)
+            {
+                int32_t alive = static_cast<int32_t>((word >> (c - first)) & 1);
+                int32_t count = windowSums[c] - alive * self;
+                bool lives = alive ?
+                    (static_cast<uint32_t>(count - mRule.survivalMin) <= survivalSpan) :
+                    (static_cast<uint32_t>(count - mRule.birthMin) <= birthSpan);
+                next |= static_cast<uint64_t>(lives) << (c - first);
+            }
+            out[w] = next;
+        }
+        mPopulation += includeRow(r, out);
+        if (mChangeSet)
+        {
+            addChangedWords(r, row, out);
+        }
+    }
+
+    if (instrumentation)
+    {
+        instrumentation->endPhase(PHASE_NEIGHBOR_COUNT);
+        int64_t births = 0, deaths = 0;
+        const Words& cells = *mCells;
+        const Words& nextCells = *mNextCells;
+        for (size_t w = 0; w < cells.size(); w++)
+        {
+            births += popCount(nextCells[w] & ~cells[w]);
+            deaths += popCount(cells[w] & ~nextCells[w]);
+        }
+        instrumentation->countBirths(births);
+        instrumentation->countDeaths(deaths);
+        mCells.swap(mNextCells);
+        instrumentation->endGeneration(mPopulation);
+    }
+    else
+    {
+        mCells.swap(mNextCells);
+    }
+}
+
+void LargerThanLifeBoard::appendLiveCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax,
+    vector<CellCoord>& cells) const
+{
+    iMin = max(iMin, mFirstRow);
+    jMin = max(jMin, mFirstColumn);
+    iMax = min(iMax, mFirstRow + mRows - 1);
+    jMax = min(jMax, mFirstColumn + mColumns - 1);
+    if ((iMin > iMax) || (jMin > jMax))
+    {
+        return;
+    }
+
+    CellIndex cMin = jMin - mFirstColumn;
+    CellIndex cMax = jMax - mFirstColumn;
+    for (CellIndex i = iMin; i <= iMax; i++)
+    {
+        const uint64_t* row = getRow(i - mFirstRow);
+        for (CellIndex w = cMin / BITS_PER_WORD; w <= cMax / BITS_PER_WORD; w++)
+        {
+            CellIndex first = max<CellIndex>(cMin - w * BITS_PER_WORD, 0);
+            CellIndex last = min<CellIndex>(cMax - w * BITS_PER_WORD, BITS_PER_WORD - 1);
+            uint64_t word = row[w] & bitRange(static_cast<int>(first), static_cast<int>(last));
+            for (; word != 0; word &= word - 1)
+            {
+                cells.push_back(CellCoord(i, mFirstColumn + w * BITS_PER_WORD + countTrailingZeros(word)));
+            }
+        }
+    }
+}
+
+bool LargerThanLifeBoard::getFutureWindow(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax,
+    int64_t generations, vector<CellCoord>& cells) const
+{
+    cells.clear();
+    if ((iMin > iMax) || (jMin > jMax))
+    {
+        return true;
+    }
+
+    // Cells further than R per generation can't reach the window, and cells
+    // off the board are dead, so a board over the cone clipped to this one
+    // ends with the same window. That is never bigger than the board, so
+    // only the reach needs keeping from overflowing.
+    int64_t t = max<int64_t>(generations, 0);
+    CellIndex reach = min<int64_t>(t, MAX_LIGHT_CONE_SIDE) * mRule.radius;
+    CellIndex top = max(iMin - reach, mFirstRow);
+    CellIndex left = max(jMin - reach, mFirstColumn);
+    CellIndex bottom = min(iMax + reach, mFirstRow + mRows - 1);
+    CellIndex right = min(jMax + reach, mFirstColumn + mColumns - 1);
+    if ((top > bottom) || (left > right))
+    {
+        return true;
+    }
+
+    LargerThanLifeBoard cone(mRule, bottom - top + 1, right - left + 1, top, left);
+    vector<CellCoord> live;
+    appendLiveCells(top, left, bottom, right, live);
+    cone.setCells(live.data(), live.size());
+    for (int64_t g = 0; g < t; g++)
+    {
+        cone.update();
+    }
+    cone.appendLiveCells(iMin, jMin, iMax, jMax, cells);
+    return true;
+}
+
+size_t LargerThanLifeBoard::getMemoryUsage() const
+{
+    return PackedBoard::getMemoryUsage() + (sizeof(*this) - sizeof(PackedBoard)) +
+        (mWindowSums.capacity() + mPrefix.capacity()) * sizeof(int32_t);
+}
+
+size_t LargerThanLifeBoard::estimateUpdateMemory() const
+{
+    size_t sums = 2 * static_cast<size_t>(mColumns) + 2 * mRule.radius + 1;
+    return PackedBoard::estimateUpdateMemory() + (sizeof(*this) - sizeof(PackedBoard)) +
+        sums * sizeof(int32_t);
+}
+
+size_t LargerThanLifeBoard::compact()
+{
+    size_t released = (mWindowSums.capacity() + mPrefix.capacity()) * sizeof(int32_t);
+    vector<int32_t>().swap(mWindowSums);
+    vector<int32_t>().swap(mPrefix);
+    return released + PackedBoard::compact();
+}
+
+shared_ptr<const Board> LargerThanLifeBoard::snapshot() const
+{
+    shared_ptr<LargerThanLifeBoard> copy = make_shared<LargerThanLifeBoard>(mRule, 0, 0);
+    shareCells(*copy);
+    return copy;
+}
@@ -2,6 +2,8 @@
 // Adapted from Image Panel example at: https://wiki.wxwidgets.org/An_image_panel
 
 #include "BasicBoard.h"
+#include "BitLife.h"
+#include "BoardHistory.h"
 #include "SparseBoard.h"
 #include <algorithm>
 #include <wx/wx.h>
@@ -22,6 +24,9 @@ protected:
     int mDisplayHeight; /// Number of cells to draw, top to bottom
     int mRowOffset; /// Row at which to start display
     int mColumnOffset; /// Column at which to start display
+    int mBitmapColumns, mBitmapRows; /// Number of cells drawn in mBitmap
+    std::vector<ChangeSpan> mChanges; /// Cells changed by the board since the last draw
+    bool mRedrawAll; /// Whether mBitmap must be drawn from scratch on the next paint
 
 public:
     static const int INIT_DISPLAY_WIDTH = 64; /// Initial width of display
@@ -36,11 +41,13 @@ public:
 	void sizeEvent(wxSizeEvent& evt);
 	void eraseEvent(wxEraseEvent& evt);
     void render(wxDC& dc);
+    void applyChanges();
 
     void zoomOut();
     void zoomIn();
     void changeRow(int r);
     void changeColumn(int c);
+    void fitToBoard();
 
     DECLARE_EVENT_TABLE()
 };
@@ -64,6 +71,12 @@ wxPanel(parent)
     mDisplayHeight = INIT_DISPLAY_HEIGHT;
     mRowOffset = 0;
     mColumnOffset = 0;
+    mBitmapColumns = 0;
+    mBitmapRows = 0;
+    mRedrawAll = true;
+
+    // Let the board list the cells it changes, so that only those are redrawn.
+    mBoard->setChangeSet(&mChanges);
 }
 
 /*
@@ -98,15 +111,66 @@ void wxImagePanel::render(wxDC&  dc)
     neww = std::min(neww, newh);
     newh = std::min(neww, newh);
 
-    int boardWidth = mDisplayWidth, boardHeight = mDisplayHeight;
-    const char* bits = (const char*)mBoard->getBitmap(mRowOffset, mColumnOffset, boardWidth, boardHeight);
+    // Cells changed by updates were already drawn into mBitmap by
+    // applyChanges(), so only get the whole view from the board when the
+    // view itself changed.
+    if (mRedrawAll || !mBitmap.IsOk() || (neww != mPanelWidth) || (newh != mPanelHeight))
+    {
+        int boardWidth = mDisplayWidth, boardHeight = mDisplayHeight;
+        const char* bits = (const char*)mBoard->getBitmap(mRowOffset, mColumnOffset, boardWidth, boardHeight);
+
+        mBitmap = wxBitmap(wxBitmap(bits, boardWidth, boardHeight).ConvertToImage().Scale(neww, newh));
+        mBitmapColumns = boardWidth;
+        mBitmapRows = boardHeight;
+        mPanelWidth = neww;
+        mPanelHeight = newh;
+        mRedrawAll = false;
 
-    mBitmap = wxBitmap(wxBitmap(bits, boardWidth, boardHeight).ConvertToImage().Scale(neww, newh));
-    mPanelWidth = neww;
-    mPanelHeight = newh;
+        delete[] bits;
+    }
     dc.DrawBitmap(mBitmap, 0, 0, false);
+}
+
+/**
+ * Draw the cells the board changed in its last update into the bitmap,
+ * without getting the rest of the view from the board.
+ */
+void wxImagePanel::applyChanges()
+{
+    if (mRedrawAll || !mBitmap.IsOk())
+    {
+        return;
+    }
 
-    delete bits;
+    wxMemoryDC dc(mBitmap);
+    dc.SetPen(*wxTRANSPARENT_PEN);
+    for (size_t s = 0; s < mChanges.size(); s++)
+    {
+        const ChangeSpan& span = mChanges[s];
+        CellIndex row = span.i - mRowOffset;
+        if ((row < 0) || (row >= mBitmapRows))
+        {
+            continue;
+        }
+        for (uint64_t mask = span.mask; mask != 0; mask &= mask - 1)
+        {
+            CellIndex j = span.j + countTrailingZeros(mask);
+            CellIndex column = j - mColumnOffset;
+            if ((column < 0) || (column >= mBitmapColumns))
+            {
+                continue;
+            }
+
+            // Cover the same pixels the scaled bitmap gives the cell.
+            int x0 = static_cast<int>(column * mPanelWidth / mBitmapColumns);
+            int x1 = static_cast<int>((column + 1) * mPanelWidth / mBitmapColumns);
+            int y0 = static_cast<int>(row * mPanelHeight / mBitmapRows);
+            int y1 = static_cast<int>((row + 1) * mPanelHeight / mBitmapRows);
+            dc.SetBrush(mBoard->getCell(span.i, j) ? *wxBLACK_BRUSH : *wxWHITE_BRUSH);
+            dc.DrawRectangle(x0, y0, x1 - x0, y1 - y0);
+        }
+    }
+    dc.SelectObject(wxNullBitmap);
 }
 
 /**
@@ -114,6 +178,7 @@ void wxImagePanel::render(wxDC&  dc)
  */
 void wxImagePanel::sizeEvent(wxSizeEvent& evt)
 {
+    mRedrawAll = true;
     Refresh();
     //skip the event.
     evt.Skip();
@@ -128,6 +193,7 @@ void wxImagePanel::eraseEvent(wxEraseEvent& evt)
 
 void wxImagePanel::zoomOut()
 {
+    mRedrawAll = true;
     if (mDisplayWidth < MAX_DISPLAY_WIDTH)
     {
         mDisplayHeight *= 2;
@@ -137,6 +203,7 @@ void wxImagePanel::zoomOut()
 
 void wxImagePanel::zoomIn()
 {
+    mRedrawAll = true;
     if (mDisplayWidth > MIN_DISPLAY_WIDTH)
     {
         mDisplayHeight /= 2;
@@ -147,11 +214,38 @@ void wxImagePanel::zoomIn()
 void wxImagePanel::changeRow(int row)
 {
     mRowOffset = row;
+    mRedrawAll = true;
 }
 
 void wxImagePanel::changeColumn(int column)
 {
     mColumnOffset = column;
+    mRedrawAll = true;
+}
+
+/**
+ * Zoom and move the display to center on all live cells.
+ */
+void wxImagePanel::fitToBoard()
+{
+    CellIndex iMin, jMin, iMax, jMax;
+    if (!mBoard->getBoundingBox(iMin, jMin, iMax, jMax))
+    {
+        return;
+    }
+
+    // Zoom out until the live cells fit, or as far as possible.
+    CellIndex extent = std::max(iMax - iMin + 1, jMax - jMin + 1);
+    mDisplayWidth = MIN_DISPLAY_WIDTH;
+    while ((mDisplayWidth < extent) && (mDisplayWidth < MAX_DISPLAY_WIDTH))
+    {
+        mDisplayWidth *= 2;
+    }
+    mDisplayHeight = mDisplayWidth;
+
+    mRowOffset = static_cast<int>(iMin + (iMax - iMin) / 2 - mDisplayHeight / 2);
+    mColumnOffset = static_cast<int>(jMin + (jMax - jMin) / 2 - mDisplayWidth / 2);
+    mRedrawAll = true;
 }
 
 /**
@@ -165,7 +259,9 @@ enum
     BUTTON_ZOOM_OUT = wxID_HIGHEST + 4,
     BUTTON_ZOOM_IN = wxID_HIGHEST + 5,
     TEXT_ROW = wxID_HIGHEST + 6,
-    TEXT_COLUMN = wxID_HIGHEST + 7
+    TEXT_COLUMN = wxID_HIGHEST + 7,
+    BUTTON_BACK = wxID_HIGHEST + 8,
+    BUTTON_FIT = wxID_HIGHEST + 9
 };
 
 /**
@@ -190,9 +286,13 @@ protected:
 
     static const int TICK_TIME = 25; /// Time between ticks when playing, in ms.
 
+    /// Memory allowed for history of past generations, in bytes.
+    static const size_t HISTORY_MEMORY_CAP = 256 * 1024 * 1024;
+
     wxImagePanel *mDrawPane; /// Panel for drawing cells
     PlayTimer *mTimer; /// Timer for play button
     Board *mBoard; /// Handle to GOL Board
+    BoardHistory *mHistory; /// Past generations, for stepping back
 
 	// GUI elements
 	wxBoxSizer *mButtonsSizer; /// Sizer to hold all other sizers for buttons
@@ -201,10 +301,12 @@ protected:
 	wxTextCtrl *mColumnTextEntry; /// Text entry for column to view
 	wxButton *mZoomOutButton; /// Button to zoom out simulation view
 	wxButton *mZoomInButton; /// Button to zoom in simulation view
+	wxButton *mFitButton; /// Button to fit view to live cells
 	wxBoxSizer *mSimControlSizer; /// Sizer for simulation controls (tick/play/etc.)
 
 	wxButton *mOutputButton; /// Button to output file
 	wxButton *mTickButton; /// Button to tick simulation forward one step
+	wxButton *mBackButton; /// Button to step simulation back one step
 	wxButton *mPlayButton; /// Button to play simulation continously
 
 public:
@@ -213,6 +315,7 @@ public:
         : wxFrame(parent, id, title, pos, size)
     {
         mBoard = board;
+        mHistory = new BoardHistory(board, BoardHistory::DEFAULT_KEYFRAME_INTERVAL, HISTORY_MEMORY_CAP);
         mTimer = new PlayTimer(this);
     }
 
@@ -220,6 +323,7 @@ public:
 	{
 		mTimer->Stop();
 		delete mTimer;
+		delete mHistory;
 	}
 
     bool initialize()
@@ -239,20 +343,26 @@ public:
         mZoomOutButton = new wxButton(this, BUTTON_ZOOM_OUT, _T("Zoom out"),
             wxDefaultPosition, wxDefaultSize, 0);
         mZoomInButton = new wxButton(this, BUTTON_ZOOM_IN, _T("Zoom in"),
+            wxDefaultPosition, wxDefaultSize, 0);
+        mFitButton = new wxButton(this, BUTTON_FIT, _T("Fit"),
             wxDefaultPosition, wxDefaultSize, 0);
 		mPositionControlSizer->Add(mRowTextEntry, 1, wxEXPAND);
 		mPositionControlSizer->Add(mColumnTextEntry, 1, wxEXPAND);
 		mPositionControlSizer->Add(mZoomOutButton, 1, wxEXPAND);
 		mPositionControlSizer->Add(mZoomInButton, 1, wxEXPAND);
+		mPositionControlSizer->Add(mFitButton, 1, wxEXPAND);
 
         // Add buttons to control simulation
         mSimControlSizer = new wxBoxSizer(wxHORIZONTAL);
+        mBackButton = new wxButton(this, BUTTON_BACK, _T("Back"),
+            wxDefaultPosition, wxDefaultSize, 0);
         mTickButton = new wxButton(this, BUTTON_TICK, _T("Tick"),
             wxDefaultPosition, wxDefaultSize, 0);
         mOutputButton = new wxButton(this, BUTTON_OUTPUT, _T("Output"),
             wxDefaultPosition, wxDefaultSize, 0);
         mPlayButton = new wxButton(this, BUTTON_PLAY, _T("Play/Stop"),
             wxDefaultPosition, wxDefaultSize, 0);
+		mSimControlSizer->Add(mBackButton, 1, wxEXPAND);
 		mSimControlSizer->Add(mTickButton, 1, wxEXPAND);
 		mSimControlSizer->Add(mPlayButton, 1, wxEXPAND);
 		mSimControlSizer->Add(mOutputButton, 1, wxEXPAND);
@@ -273,10 +383,20 @@ public:
 
     void tick()
     {
-        mBoard->update();
+        mHistory->step();
+        mDrawPane->applyChanges();
         refreshDisplay();
     }
 
+    void OnBackClick(wxCommandEvent& event)
+    {
+        if (!mTimer->IsRunning() && mHistory->stepBack())
+        {
+            mDrawPane->applyChanges();
+            refreshDisplay();
+        }
+    }
+
     void OnTickClick(wxCommandEvent& event)
     {
         if (!mTimer->IsRunning())
@@ -320,6 +440,15 @@ public:
         }
     }
 
+    void OnFit(wxCommandEvent& event)
+    {
+        mDrawPane->fitToBoard();
+        if (!mTimer->IsRunning())
+        {
+            refreshDisplay();
+        }
+    }
+
     void OnRowEntry(wxCommandEvent& event)
     {
         wxString textContent = event.GetString();
@@ -345,10 +474,12 @@ public:
 
 BEGIN_EVENT_TABLE(GOLFrame, wxFrame)
 EVT_BUTTON(BUTTON_TICK, GOLFrame::OnTickClick)
+EVT_BUTTON(BUTTON_BACK, GOLFrame::OnBackClick)
 EVT_BUTTON(BUTTON_PLAY, GOLFrame::OnPlayClick)
 EVT_BUTTON(BUTTON_OUTPUT, GOLFrame::OnOutputClick)
 EVT_BUTTON(BUTTON_ZOOM_OUT, GOLFrame::OnZoomOut)
 EVT_BUTTON(BUTTON_ZOOM_IN, GOLFrame::OnZoomIn)
+EVT_BUTTON(BUTTON_FIT, GOLFrame::OnFit)
 EVT_TEXT_ENTER(TEXT_ROW, GOLFrame::OnRowEntry)
 EVT_TEXT_ENTER(TEXT_COLUMN, GOLFrame::OnColumnEntry)
 END_EVENT_TABLE()
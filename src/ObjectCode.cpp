@@ -0,0 +1,195 @@
+#include "ObjectCode.h"
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+using namespace std;
+
+/// Digits of extended Wechsler notation; each one is a column of 5 cells.
+static const char WECHSLER_DIGITS[] = "0123456789abcdefghijklmnopqrstuv";
+
+/// Number of rows in a strip of extended Wechsler notation.
+static const int STRIP_ROWS = 5;
+
+/// Append a run of empty columns, using the short forms for runs.
+static void appendEmptyColumns(string& out, int count)
+{
+    while (count > 0)
+    {
+        if (count == 1)
+        {
+            out += '0';
+            count = 0;
+        }
+        else if (count == 2)
+        {
+            out += 'w';
+            count = 0;
+        }
+        else if (count == 3)
+        {
+            out += 'x';
+            count = 0;
+        }
+        else
+        {
+            // "y" followed by a digit d stands for 4 + d empty columns.
+            int run = min(count, 4 + 31);
+            out += 'y';
+            out += WECHSLER_DIGITS[run - 4];
+            count -= run;
+        }
+    }
+}
+
+string getWechsler(const vector<CellCoord>& cells)
+{
+    if (cells.empty())
+    {
+        return "0";
+    }
+
+    CellIndex iMin = cells[0].first, jMin = cells[0].second, iMax = iMin, jMax = jMin;
+    for (size_t c = 1; c < cells.size(); c++)
+    {
+        iMin = min(iMin, cells[c].first);
+        iMax = max(iMax, cells[c].first);
+        jMin = min(jMin, cells[c].second);
+        jMax = max(jMax, cells[c].second);
+    }
+
+    int strips = static_cast<int>((iMax - iMin) / STRIP_ROWS + 1);
+    int columns = static_cast<int>(jMax - jMin + 1);
+    vector<int> digits(strips * columns, 0);
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        int row = static_cast<int>(cells[c].first - iMin);
+        int column = static_cast<int>(cells[c].second - jMin);
+        digits[(row / STRIP_ROWS) * columns + column] |= 1 << (row % STRIP_ROWS);
+    }
+
+    // Strips are separated by "z"; empty columns at the end of a strip are
+    // left out.
+    string out;
+    for (int s = 0; s < strips; s++)
+    {
+        if (s > 0)
+        {
+            out += 'z';
+        }
+        int empty = 0;
+        for (int column = 0; column < columns; column++)
+        {
+            int digit = digits[s * columns + column];
+            if (digit == 0)
+            {
+                empty++;
+                continue;
+            }
+            appendEmptyColumns(out, empty);
+            empty = 0;
+            out += WECHSLER_DIGITS[digit];
+        }
+    }
+    return out;
+}
+
+/// Test whether code a is preferred to b: shorter first, then in order.
+static bool isBetterCode(const string& a, const string& b)
+{
+    return (a.size() < b.size()) || ((a.size() == b.size()) && (a < b));
+}
+
+/// Get the best code of a phase over its 8 rotations and reflections.
+static string getCanonicalWechsler(const vector<CellCoord>& cells)
+{
+    string best;
+    vector<CellCoord> turned(cells.size());
+    for (int symmetry = 0; symmetry < 8; symmetry++)
+    {
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            CellIndex i = cells[c].first;
+            CellIndex j = cells[c].second;
+            if (symmetry & 1)
+            {
+                i = -i;
+            }
+            if (symmetry & 2)
+            {
+                j = -j;
+            }
+            if (symmetry & 4)
+            {
+                swap(i, j);
+            }
+            turned[c] = CellCoord(i, j);
+        }
+        string code = getWechsler(turned);
+        if ((symmetry == 0) || isBetterCode(code, best))
+        {
+            best = code;
+        }
+    }
+    return best;
+}
+
+string getObjectCode(const ObjectPhases& phases, bool moving)
+{
+    string best;
+    for (size_t p = 0; p < phases.size(); p++)
+    {
+        string code = getCanonicalWechsler(phases[p]);
+        if ((p == 0) || isBetterCode(code, best))
+        {
+            best = code;
+        }
+    }
+
+    ostringstream prefix;
+    if (moving)
+    {
+        prefix << "xq" << phases.size();
+    }
+    else if (phases.size() > 1)
+    {
+        prefix << "xp" << phases.size();
+    }
+    else
+    {
+        prefix << "xs" << (phases.empty() ? 0 : phases[0].size());
+    }
+    return prefix.str() + "_" + best;
+}
+
+void findComponents(const vector<CellCoord>& cells, vector<vector<CellCoord> >& objects, CellIndex reach)
+{
+    objects.clear();
+    set<CellCoord> unvisited(cells.begin(), cells.end());
+    vector<CellCoord> stack;
+    while (!unvisited.empty())
+    {
+        objects.push_back(vector<CellCoord>());
+        vector<CellCoord>& object = objects.back();
+        stack.push_back(*unvisited.begin());
+        unvisited.erase(unvisited.begin());
+        while (!stack.empty())
+        {
+            CellCoord cell = stack.back();
+            stack.pop_back();
+            object.push_back(cell);
+            // Take the unvisited cells in range one row at a time.
+            for (CellIndex di = -reach; di <= reach; di++)
+            {
+                CellCoord last(cell.first + di, cell.second + reach);
+                auto iter = unvisited.lower_bound(CellCoord(cell.first + di, cell.second - reach));
+                while ((iter != unvisited.end()) && (*iter <= last))
+                {
+                    stack.push_back(*iter);
+                    iter = unvisited.erase(iter);
+                }
+            }
+        }
+        sort(object.begin(), object.end());
+    }
+}
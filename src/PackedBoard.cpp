@@ -0,0 +1,410 @@
+#include "PackedBoard.h"
+#include "BitLife.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <assert.h>
+#include <atomic>
+#include <cstring>
+
+using namespace std;
+
+PackedBoard::PackedBoard(CellIndex rows, CellIndex columns, CellIndex firstRow, CellIndex firstColumn) :
+    Board()
+{
+    mRows = max<CellIndex>(rows, 0);
+    mColumns = max<CellIndex>(columns, 0);
+    mFirstRow = firstRow;
+    mFirstColumn = firstColumn;
+    mWordsPerRow = static_cast<size_t>((mColumns + BITS_PER_WORD - 1) / BITS_PER_WORD);
+    mCells = make_shared<Words>(mRows * mWordsPerRow, 0);
+    mPopulation = 0;
+}
+
+bool PackedBoard::isShared(const shared_ptr<Words>& words)
+{
+    if (words.use_count() > 1)
+    {
+        return true;
+    }
+
+    // A snapshot may have just been released on another thread; make sure
+    // its last reads of the words happen before any writes to them here.
+    atomic_thread_fence(memory_order_acquire);
+    return false;
+}
+
+void PackedBoard::ownCells()
+{
+    if (isShared(mCells))
+    {
+        mCells = make_shared<Words>(*mCells);
+    }
+}
+
+bool PackedBoard::getCell(CellIndex i, CellIndex j) const
+{
+    if (contains(i, j))
+    {
+        CellIndex c = j - mFirstColumn;
+        return ((getRow(i - mFirstRow)[c / BITS_PER_WORD] >> (c % BITS_PER_WORD)) & 1) != 0;
+    }
+    return false;
+}
+
+void PackedBoard::setCell(CellIndex i, CellIndex j, bool alive)
+{
+    if (contains(i, j))
+    {
+        ownCells();
+        CellIndex c = j - mFirstColumn;
+        uint64_t& word = (*mCells)[(i - mFirstRow) * mWordsPerRow + c / BITS_PER_WORD];
+        uint64_t bit = uint64_t(1) << (c % BITS_PER_WORD);
+        if (alive && !(word & bit))
+        {
+            word |= bit;
+            mPopulation++;
+            mBox.include(i, j);
+        }
+        else if (!alive && (word & bit))
+        {
+            word &= ~bit;
+            mPopulation--;
+            mBox.exclude(i, j);
+        }
+    }
+}
+
+void PackedBoard::setCells(const CellCoord* cells, size_t count)
+{
+    ownCells();
+    for (size_t c = 0; c < count; c++)
+    {
+        CellIndex i = cells[c].first;
+        CellIndex j = cells[c].second;
+        if (contains(i, j))
+        {
+            CellIndex column = j - mFirstColumn;
+            uint64_t& word = (*mCells)[(i - mFirstRow) * mWordsPerRow + column / BITS_PER_WORD];
+            uint64_t bit = uint64_t(1) << (column % BITS_PER_WORD);
+            mPopulation += ((word & bit) == 0);
+            word |= bit;
+            mBox.include(i, j);
+        }
+    }
+}
+
+void PackedBoard::clearBoard()
+{
+    if (isShared(mCells))
+    {
+        mCells = make_shared<Words>(mCells->size(), 0);
+    }
+    else
+    {
+        fill(mCells->begin(), mCells->end(), 0);
+    }
+    mPopulation = 0;
+    mBox.reset();
+}
+
+int64_t PackedBoard::includeRow(CellIndex r, const uint64_t* row) const
+{
+    int64_t count = 0;
+    size_t first = mWordsPerRow, last = 0;
+    for (size_t w = 0; w < mWordsPerRow; w++)
+    {
+        if (row[w] != 0)
+        {
+            count += popCount(row[w]);
+            first = min(first, w);
+            last = w;
+        }
+    }
+
+    if (count > 0)
+    {
+        CellIndex i = mFirstRow + r;
+        mBox.include(i, mFirstColumn + first * BITS_PER_WORD + countTrailingZeros(row[first]));
+        mBox.include(i, mFirstColumn + last * BITS_PER_WORD + highestBit(row[last]));
+    }
+    return count;
+}
+
+void PackedBoard::addChangedWords(CellIndex r, const uint64_t* before, const uint64_t* after)
+{
+    for (size_t w = 0; w < mWordsPerRow; w++)
+    {
+        if (before[w] != after[w])
+        {
+            ChangeSpan span = { mFirstRow + r, mFirstColumn + static_cast<CellIndex>(w * BITS_PER_WORD),
+                before[w] ^ after[w] };
+            mChangeSet->push_back(span);
+        }
+    }
+}
+
+void PackedBoard::update()
+{
+    // Counting and updating happen in the same pass, so all of it is timed
+    // as neighbor counting.
+    Instrumentation* instrumentation = mInstrumentation;
+    if (instrumentation)
+    {
+        instrumentation->beginGeneration();
+        instrumentation->beginPhase(PHASE_NEIGHBOR_COUNT);
+    }
+
+    if (mChangeSet)
+    {
+        mChangeSet->clear();
+    }
+
+    // The scratch buffer held the previous generation, which a snapshot may
+    // still be reading.
+    if (!mNextCells || isShared(mNextCells))
+    {
+        mNextCells = make_shared<Words>(mCells->size());
+        if (instrumentation)
+        {
+            instrumentation->countAllocations(1);
+        }
+    }
+    notePeakMemory(getMemoryUsage());
+
+    if (mWordsPerRow > 0)
+    {
+        uint64_t lastWordMask = ~uint64_t(0);
+        if (mColumns % BITS_PER_WORD != 0)
+        {
+            lastWordMask = (uint64_t(1) << (mColumns % BITS_PER_WORD)) - 1;
+        }
+
+        mPopulation = 0;
+        mBox.reset();
+        for (CellIndex r = 0; r < mRows; r++)
+        {
+            uint64_t* out = &(*mNextCells)[r * mWordsPerRow];
+            lifeRow((r > 0) ? getRow(r - 1) : NULL, getRow(r),
+                (r + 1 < mRows) ? getRow(r + 1) : NULL, out, mWordsPerRow);
+            out[mWordsPerRow - 1] &= lastWordMask;
+            mPopulation += includeRow(r, out);
+            if (mChangeSet)
+            {
+                addChangedWords(r, getRow(r), out);
+            }
+        }
+    }
+
+    if (instrumentation)
+    {
+        instrumentation->endPhase(PHASE_NEIGHBOR_COUNT);
+        int64_t births = 0, deaths = 0;
+        const Words& cells = *mCells;
+        const Words& nextCells = *mNextCells;
+        for (size_t w = 0; w < cells.size(); w++)
+        {
+            births += popCount(nextCells[w] & ~cells[w]);
+            deaths += popCount(cells[w] & ~nextCells[w]);
+        }
+        instrumentation->countBirths(births);
+        instrumentation->countDeaths(deaths);
+        mCells.swap(mNextCells);
+        instrumentation->endGeneration(mPopulation);
+    }
+    else
+    {
+        mCells.swap(mNextCells);
+    }
+}
+
+const int8_t* PackedBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
+{
+    // round width up to nearest 8 (bits)
+    if (width % 8 != 0)
+    {
+        width += 8 - (width % 8);
+    }
+    int bw = width / 8;
+
+    int8_t* bitmap = new int8_t[height * bw];
+    memset(bitmap, 0, height * bw * sizeof(int8_t));
+
+    // Bitmap bytes hold cells in the same bit order as the packed rows,
+    // so copy 64 cells at a time.
+    for (int iCount = 0; iCount < height; iCount++)
+    {
+        CellIndex r = iOffset + iCount - mFirstRow;
+        if ((r < 0) || (r >= mRows) || (mWordsPerRow == 0))
+        {
+            continue;
+        }
+
+        int8_t* out = &bitmap[iCount * bw];
+        for (int byteCount = 0; byteCount < bw; byteCount += 8)
+        {
+            uint64_t bits = extractBits(getRow(r), mWordsPerRow, jOffset - mFirstColumn + 8 * byteCount);
+            for (int b = 0; (b < 8) && (byteCount + b < bw); b++)
+            {
+                out[byteCount + b] = static_cast<int8_t>((bits >> (8 * b)) & 0xff);
+            }
+        }
+    }
+
+    return bitmap;
+}
+
+bool PackedBoard::findLiveCell(CellIndex r, size_t w, int b, CellIndex& i, CellIndex& j) const
+{
+    for (; r < mRows; r++)
+    {
+        const uint64_t* row = getRow(r);
+        for (; w < mWordsPerRow; w++)
+        {
+            uint64_t word = (b < BITS_PER_WORD) ? (row[w] >> b) << b : 0;
+            if (word != 0)
+            {
+                i = mFirstRow + r;
+                j = mFirstColumn + w * BITS_PER_WORD + countTrailingZeros(word);
+                return true;
+            }
+            b = 0;
+        }
+        w = 0;
+    }
+    return false;
+}
+
+bool PackedBoard::getFirstLiveCell(CellIndex& i, CellIndex& j) const
+{
+    return findLiveCell(0, 0, 0, i, j);
+}
+
+bool PackedBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
+{
+    CellIndex c = j - mFirstColumn + 1;
+    return findLiveCell(i - mFirstRow, static_cast<size_t>(c / BITS_PER_WORD),
+        static_cast<int>(c % BITS_PER_WORD), i, j);
+}
+
+size_t PackedBoard::getMemoryUsage() const
+{
+    size_t words = mCells->capacity() + (mNextCells ? mNextCells->capacity() : 0);
+    return sizeof(*this) + words * sizeof(uint64_t);
+}
+
+size_t PackedBoard::estimateUpdateMemory() const
+{
+    return sizeof(*this) + 2 * mCells->size() * sizeof(uint64_t);
+}
+
+size_t PackedBoard::compact()
+{
+    size_t released = mNextCells ? mNextCells->capacity() * sizeof(uint64_t) : 0;
+    mNextCells.reset();
+    return released;
+}
+
+int64_t PackedBoard::getPopulation() const
+{
+    return mPopulation;
+}
+
+bool PackedBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    if (mBox.dirty)
+    {
+        mBox.reset();
+        for (CellIndex r = 0; r < mRows; r++)
+        {
+            includeRow(r, getRow(r));
+        }
+    }
+    return mBox.get(iMin, jMin, iMax, jMax);
+}
+
+bool PackedBoard::getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    iMin = mFirstRow;
+    jMin = mFirstColumn;
+    iMax = mFirstRow + mRows - 1;
+    jMax = mFirstColumn + mColumns - 1;
+    return true;
+}
+
+int64_t PackedBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+    // Clip to the board, in board-relative rows and columns.
+    CellIndex r0 = max(iMin, mFirstRow) - mFirstRow;
+    CellIndex r1 = min(iMax, mFirstRow + mRows - 1) - mFirstRow;
+    CellIndex c0 = max(jMin, mFirstColumn) - mFirstColumn;
+    CellIndex c1 = min(jMax, mFirstColumn + mColumns - 1) - mFirstColumn;
+    if ((r0 > r1) || (c0 > c1))
+    {
+        return 0;
+    }
+
+    size_t w0 = static_cast<size_t>(c0 / BITS_PER_WORD);
+    size_t w1 = static_cast<size_t>(c1 / BITS_PER_WORD);
+    int64_t count = 0;
+    for (CellIndex r = r0; r <= r1; r++)
+    {
+        const uint64_t* row = getRow(r);
+        for (size_t w = w0; w <= w1; w++)
+        {
+            int first = (w == w0) ? static_cast<int>(c0 % BITS_PER_WORD) : 0;
+            int last = (w == w1) ? static_cast<int>(c1 % BITS_PER_WORD) : BITS_PER_WORD - 1;
+            count += popCount(row[w] & bitRange(first, last));
+        }
+    }
+    return count;
+}
+
+bool PackedBoard::touchesEdge() const
+{
+    if ((mRows == 0) || (mWordsPerRow == 0))
+    {
+        return false;
+    }
+
+    for (size_t w = 0; w < mWordsPerRow; w++)
+    {
+        if ((getRow(0)[w] != 0) || (getRow(mRows - 1)[w] != 0))
+        {
+            return true;
+        }
+    }
+
+    uint64_t lastBit = uint64_t(1) << ((mColumns - 1) % BITS_PER_WORD);
+    for (CellIndex r = 0; r < mRows; r++)
+    {
+        const uint64_t* row = getRow(r);
+        if ((row[0] & 1) || (row[mWordsPerRow - 1] & lastBit))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PackedBoard::shareCells(PackedBoard& copy) const
+{
+    // Find the bounding box first, so that the copy never has to.
+    CellIndex iMin, jMin, iMax, jMax;
+    getBoundingBox(iMin, jMin, iMax, jMax);
+
+    copy.mRows = mRows;
+    copy.mColumns = mColumns;
+    copy.mFirstRow = mFirstRow;
+    copy.mFirstColumn = mFirstColumn;
+    copy.mWordsPerRow = mWordsPerRow;
+    copy.mCells = mCells;
+    copy.mPopulation = mPopulation;
+    copy.mBox = mBox;
+}
+
+shared_ptr<const Board> PackedBoard::snapshot() const
+{
+    shared_ptr<PackedBoard> copy = make_shared<PackedBoard>(0, 0);
+    shareCells(*copy);
+    return copy;
+}
@@ -0,0 +1,160 @@
+#include "PerfCounters.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef __linux__
+
+/// Open one counter of the calling thread, in a group if group is not -1.
+static int openCounter(uint32_t type, uint64_t config, int group)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = (group == -1) ? 1 : 0;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+#endif
+
+PerfCounters::PerfCounters() :
+    mGroup(-1), mOpened(0)
+{
+    for (int e = 0; e < PERF_EVENT_COUNT; e++)
+    {
+        mSlots[e] = -1;
+        mFds[e] = -1;
+    }
+
+#ifdef __linux__
+    static const uint64_t L1D_READ_MISS = PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const uint32_t types[PERF_EVENT_COUNT] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE
+    };
+    const uint64_t configs[PERF_EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, L1D_READ_MISS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    // All counters go in one group, so that one read() gets all of them and
+    // they run over exactly the same code. Events the CPU lacks are left out.
+    int firstError = 0;
+    for (int e = 0; e < PERF_EVENT_COUNT; e++)
+    {
+        int fd = openCounter(types[e], configs[e], mGroup);
+        if (fd == -1)
+        {
+            firstError = firstError ? firstError : errno;
+            continue;
+        }
+        if (mGroup == -1)
+        {
+            mGroup = fd;
+        }
+        mFds[e] = fd;
+        mSlots[e] = mOpened++;
+    }
+
+    if (mGroup != -1)
+    {
+        ioctl(mGroup, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(mGroup, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    if (firstError != 0)
+    {
+        mError = string("perf_event_open: ") + strerror(firstError);
+    }
+#else
+    mError = "hardware counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int e = 0; e < PERF_EVENT_COUNT; e++)
+    {
+        if (mFds[e] != -1)
+        {
+            close(mFds[e]);
+        }
+    }
+#endif
+}
+
+const char* PerfCounters::getEventName(PerfEvent event)
+{
+    switch (event)
+    {
+    case PERF_CYCLES:
+        return "cycles";
+    case PERF_INSTRUCTIONS:
+        return "instructions";
+    case PERF_L1D_MISSES:
+        return "l1d_misses";
+    case PERF_LLC_MISSES:
+        return "llc_misses";
+    case PERF_BRANCH_MISSES:
+        return "branch_misses";
+    default:
+        return "unknown";
+    }
+}
+
+bool PerfCounters::isAvailable() const
+{
+    return mOpened > 0;
+}
+
+bool PerfCounters::isAvailable(PerfEvent event) const
+{
+    return mSlots[event] != -1;
+}
+
+void PerfCounters::read(uint64_t values[PERF_EVENT_COUNT]) const
+{
+    for (int e = 0; e < PERF_EVENT_COUNT; e++)
+    {
+        values[e] = 0;
+    }
+
+#ifdef __linux__
+    if (mGroup == -1)
+    {
+        return;
+    }
+
+    // Group layout: count, time enabled, time running, then one value per
+    // counter in the order they were opened.
+    uint64_t data[3 + PERF_EVENT_COUNT];
+    ssize_t bytes = ::read(mGroup, data, sizeof(data));
+    if ((bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) || (data[2] == 0))
+    {
+        return;
+    }
+
+    double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+    for (int e = 0; e < PERF_EVENT_COUNT; e++)
+    {
+        if ((mSlots[e] != -1) && (static_cast<uint64_t>(mSlots[e]) < data[0]))
+        {
+            values[e] = static_cast<uint64_t>(data[3 + mSlots[e]] * scale);
+        }
+    }
+#endif
+}
@@ -1,5 +1,10 @@
 #include "SparseBoard.h"
+#include "FrozenBoard.h"
+#include "Instrumentation.h"
+#include <algorithm>
 #include <assert.h>
+#include <cstring>
+#include <vector>
 
 using namespace std;
 
@@ -7,42 +12,206 @@ SparseBoard::SparseBoard() :
     Board()
 {
     mBoard = BoardRep();
+    mPopulation = 0;
+    mIndexDirty = true;
 }
 
-void SparseBoard::updateNeighborCount(CellIndex i, NeighborCount &nbrs) const
+void SparseBoard::noteRowEnds(const RowEnds& before, const BoardRow& row)
+{
+	mIndexDirty = true;
+	CellIndex first = row.empty() ? 0 : *row.begin();
+	CellIndex last = row.empty() ? 0 : *row.rbegin();
+	if (!before.empty && (row.empty() || (before.first != first)))
+	{
+		mRowFirsts.erase(mRowFirsts.find(before.first));
+	}
+	if (!row.empty() && (before.empty || (before.first != first)))
+	{
+		mRowFirsts.insert(first);
+	}
+	if (!before.empty && (row.empty() || (before.last != last)))
+	{
+		mRowLasts.erase(mRowLasts.find(before.last));
+	}
+	if (!row.empty() && (before.empty || (before.last != last)))
+	{
+		mRowLasts.insert(last);
+	}
+}
+
+void SparseBoard::buildIndex() const
+{
+	if (!mIndexDirty)
+	{
+		return;
+	}
+	mIndexColumns.clear();
+	mIndexRows.clear();
+	mIndexColumns.reserve(static_cast<size_t>(mPopulation));
+	mIndexRows.reserve(mBoard.size());
+	for (auto iIter = mBoard.begin(); iIter != mBoard.end(); iIter++)
+	{
+		mIndexRows.push_back(make_pair(iIter->first, mIndexColumns.size()));
+		mIndexColumns.insert(mIndexColumns.end(), iIter->second.begin(), iIter->second.end());
+	}
+	mIndexDirty = false;
+}
+
+size_t SparseBoard::updateNeighborCount(CellIndex i, NeighborCount &nbrs) const
 {
 	auto iIter = mBoard.find(i);
-	if (iIter != mBoard.end())
+	if (iIter == mBoard.end())
 	{
-		for (auto jIter = iIter->second.begin(); jIter != iIter->second.end(); jIter++)
-		{
-			CellIndex j = *jIter;
-			nbrs[i - 1][j - 1]++;
-			nbrs[i - 1][j]++;
-			nbrs[i - 1][j + 1]++;
-			nbrs[i][j - 1]++;
-			nbrs[i][j + 1]++;
-			nbrs[i + 1][j - 1]++;
-			nbrs[i + 1][j]++;
-			nbrs[i + 1][j + 1]++;
-		}
+		return 0;
+	}
+
+	// Look the three rows up once rather than for every count.
+	size_t rowsBefore = nbrs.size();
+	auto& above = nbrs[i - 1];
+	auto& row = nbrs[i];
+	auto& below = nbrs[i + 1];
+	size_t countsBefore = above.size() + row.size() + below.size();
+	for (auto jIter = iIter->second.begin(); jIter != iIter->second.end(); jIter++)
+	{
+		CellIndex j = *jIter;
+		above[j - 1]++;
+		above[j]++;
+		above[j + 1]++;
+		row[j - 1]++;
+		row[j + 1]++;
+		below[j - 1]++;
+		below[j]++;
+		below[j + 1]++;
 	}
+	return (nbrs.size() - rowsBefore) * NBR_ROW_BYTES +
+		(above.size() + row.size() + below.size() - countsBefore) * NBR_CELL_BYTES;
 }
 
-void SparseBoard::birthCells(CellIndex i, const NeighborCount& nbrs)
+int64_t SparseBoard::birthCells(CellIndex i, const NeighborCount& nbrs)
 {
+	int64_t births = 0;
 	auto iIter = nbrs.find(i);
 	if (iIter != nbrs.end())
 	{
+		// The row is only looked up, or made, once there is a birth in it.
+		BoardRow* row = NULL;
+		RowEnds before;
 		for (auto jIter = iIter->second.begin(); jIter != iIter->second.end(); jIter++)
 		{
 			if (jIter->second == NEIGHBOR_COUNT_BIRTH)
 			{
 				CellIndex j = jIter->first;
-				mBoard[i].insert(j);
+				if (!row)
+				{
+					row = &mBoard[i];
+					before = RowEnds(*row);
+				}
+				if (row->insert(j).second)
+				{
+					births++;
+					if (mChangeSet)
+					{
+						ChangeSpan span = { i, j, 1 };
+						mChangeSet->push_back(span);
+					}
+				}
 			}
 		}
+		if (row)
+		{
+			noteRowEnds(before, *row);
+		}
+		mPopulation += births;
+
+		if (mInstrumentation)
+		{
+			// Each birth allocates a tree node in the row.
+			mInstrumentation->countBirths(births);
+			mInstrumentation->countAllocations(births);
+		}
 	}
+	return births;
+}
+
+size_t SparseBoard::getMemoryUsage() const
+{
+	return sizeof(*this) + mBoard.size() * (ROW_BYTES + ROW_ENDS_BYTES) +
+		static_cast<size_t>(mPopulation) * CELL_BYTES +
+		mIndexColumns.capacity() * sizeof(CellIndex) +
+		mIndexRows.capacity() * sizeof(mIndexRows[0]);
+}
+
+size_t SparseBoard::compact()
+{
+	size_t before = getMemoryUsage();
+	vector<CellIndex>().swap(mIndexColumns);
+	vector<pair<CellIndex, size_t> >().swap(mIndexRows);
+	mIndexDirty = true;
+	return before - getMemoryUsage();
+}
+
+int64_t SparseBoard::getPopulation() const
+{
+	return mPopulation;
+}
+
+bool SparseBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+	if (mBoard.empty())
+	{
+		return false;
+	}
+
+	iMin = mBoard.begin()->first;
+	iMax = mBoard.rbegin()->first;
+	jMin = *mRowFirsts.begin();
+	jMax = *mRowLasts.rbegin();
+	return true;
+}
+
+int64_t SparseBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+	if (mBoard.empty() || (iMin > iMax) || (jMin > jMax))
+	{
+		return 0;
+	}
+	buildIndex();
+
+	// Rows in the range, as positions in mIndexRows; row r's columns end
+	// where row r + 1's begin.
+	size_t rowBegin = lower_bound(mIndexRows.begin(), mIndexRows.end(), iMin,
+		[](const pair<CellIndex, size_t>& row, CellIndex i) { return row.first < i; }) - mIndexRows.begin();
+	size_t rowEnd = upper_bound(mIndexRows.begin() + rowBegin, mIndexRows.end(), iMax,
+		[](CellIndex i, const pair<CellIndex, size_t>& row) { return i < row.first; }) - mIndexRows.begin();
+	auto columnsOf = [this](size_t r) {
+		return (r < mIndexRows.size()) ? mIndexRows[r].second : mIndexColumns.size(); };
+
+	// A range spanning every live column holds whole rows.
+	if ((jMin <= *mRowFirsts.begin()) && (jMax >= *mRowLasts.rbegin()))
+	{
+		return static_cast<int64_t>(columnsOf(rowEnd) - columnsOf(rowBegin));
+	}
+
+	int64_t count = 0;
+	for (size_t r = rowBegin; r < rowEnd; r++)
+	{
+		auto first = mIndexColumns.begin() + columnsOf(r);
+		auto last = mIndexColumns.begin() + columnsOf(r + 1);
+		count += upper_bound(first, last, jMax) - lower_bound(first, last, jMin);
+	}
+	return count;
+}
+
+size_t SparseBoard::estimateUpdateMemory() const
+{
+	// The neighbor count holds a window of up to four rows. Each live cell
+	// of the widest row contributes at most three counts to a row.
+	size_t widestRow = 0;
+	for (auto iIter = mBoard.begin(); iIter != mBoard.end(); iIter++)
+	{
+		widestRow = std::max(widestRow, iIter->second.size());
+	}
+	return getMemoryUsage() + 4 * (NBR_ROW_BYTES + (3 * widestRow + 2) * NBR_CELL_BYTES);
 }
 
 bool SparseBoard::getCell(CellIndex i, CellIndex j) const
@@ -59,14 +228,25 @@ void SparseBoard::setCell(CellIndex i, CellIndex j, bool alive)
 {
 	if (alive)
 	{
-		mBoard[i].insert(j);
+		BoardRow& row = mBoard[i];
+		RowEnds before(row);
+		if (row.insert(j).second)
+		{
+			mPopulation++;
+			noteRowEnds(before, row);
+		}
 	}
 	else
 	{
 		auto iIter = mBoard.find(i);
 		if (iIter != mBoard.end())
 		{
-			iIter->second.erase(j);
+			RowEnds before(iIter->second);
+			if (iIter->second.erase(j) > 0)
+			{
+				mPopulation--;
+				noteRowEnds(before, iIter->second);
+			}
 			if (iIter->second.empty())
 			{
 				mBoard.erase(i);
@@ -75,12 +255,80 @@ void SparseBoard::setCell(CellIndex i, CellIndex j, bool alive)
 	}
 }
 
+void SparseBoard::setCells(const CellCoord* cells, size_t count)
+{
+	vector<CellCoord> sorted;
+	if (!is_sorted(cells, cells + count))
+	{
+		sorted.assign(cells, cells + count);
+		sort(sorted.begin(), sorted.end());
+		cells = sorted.data();
+	}
+
+	// Take one row at a time. Sorted input lets a new row be built in
+	// linear time, and lets rows and cells be inserted with a hint.
+	size_t c = 0;
+	while (c < count)
+	{
+		CellIndex i = cells[c].first;
+		size_t rowEnd = c;
+		while ((rowEnd < count) && (cells[rowEnd].first == i))
+		{
+			rowEnd++;
+		}
+
+		auto iIter = mBoard.lower_bound(i);
+		if ((iIter == mBoard.end()) || (iIter->first != i))
+		{
+			// Duplicates are dropped by the set itself.
+			BoardRow row;
+			for (size_t k = c; k < rowEnd; k++)
+			{
+				row.insert(row.end(), cells[k].second);
+			}
+			mPopulation += row.size();
+			noteRowEnds(RowEnds(), row);
+			iIter = mBoard.insert(iIter, BoardRep::value_type(i, BoardRow()));
+			iIter->second.swap(row);
+		}
+		else
+		{
+			BoardRow& row = iIter->second;
+			RowEnds before(row);
+			size_t sizeBefore = row.size();
+			for (size_t k = c; k < rowEnd; k++)
+			{
+				row.insert(row.end(), cells[k].second);
+			}
+			if (row.size() > sizeBefore)
+			{
+				mPopulation += row.size() - sizeBefore;
+				noteRowEnds(before, row);
+			}
+		}
+
+		c = rowEnd;
+	}
+}
+
 void SparseBoard::update()
 {
 	// The board is updated row by row. At all times the algorithm tracks the
 	// prior, current, and next row from the last iteration of the board, and
 	// then makes updates to the board in place.
+	Instrumentation* instrumentation = mInstrumentation;
+	if (instrumentation)
+	{
+		instrumentation->beginGeneration();
+	}
+	if (mChangeSet)
+	{
+		mChangeSet->clear();
+	}
+
 	NeighborCount nbrs = NeighborCount();
+	size_t nbrBytes = 0; // Approximate bytes used by nbrs.
+	size_t peakBytes = getMemoryUsage(); // Most memory used so far this generation.
     auto iIter = mBoard.begin();
 	CellIndex highestRowCounted;
 	bool firstRow = true;
@@ -103,50 +351,86 @@ void SparseBoard::update()
 		// That is, birth new cells with the right neighbor count, and then clear
 		// out rows of the neighbor count map that aren't needed anymore.
 		CellIndex highestRowToProcess = i - 2;
-		while (!nbrs.empty() && (nbrs.begin()->first <= highestRowToProcess))
 		{
-			auto iNbrIter = nbrs.begin();
-			birthCells(iNbrIter->first, nbrs);
-			nbrs.erase(iNbrIter);
+			PhaseScope scope(instrumentation, PHASE_BIRTH);
+			while (!nbrs.empty() && (nbrs.begin()->first <= highestRowToProcess))
+			{
+				auto iNbrIter = nbrs.begin();
+				birthCells(iNbrIter->first, nbrs);
+				if (instrumentation)
+				{
+					// One node for the row plus one per counted cell.
+					instrumentation->countAllocations(iNbrIter->second.size() + 1);
+				}
+				nbrBytes -= NBR_ROW_BYTES + iNbrIter->second.size() * NBR_CELL_BYTES;
+				nbrs.erase(iNbrIter);
+			}
 		}
 		
 		// Update neighbor counts. Ensure that all rows up to the current row are
 		// included in the count, in case there is a new row in the middle of
 		// nowhere. Always add the next row into the count.
-		if (highestRowCounted < i - 1)
 		{
-			updateNeighborCount(i - 1, nbrs);
-		}
-		if (highestRowCounted < i)
-		{
-			updateNeighborCount(i, nbrs);
+			PhaseScope scope(instrumentation, PHASE_NEIGHBOR_COUNT);
+			if (highestRowCounted < i - 1)
+			{
+				nbrBytes += updateNeighborCount(i - 1, nbrs);
+			}
+			if (highestRowCounted < i)
+			{
+				nbrBytes += updateNeighborCount(i, nbrs);
+			}
+			nbrBytes += updateNeighborCount(i + 1, nbrs);
+			highestRowCounted = i + 1;
 		}
-		updateNeighborCount(i + 1, nbrs);
-		highestRowCounted = i + 1;
+
+		// The window of neighbor counts is at its largest right after counting.
+		peakBytes = std::max(peakBytes, getMemoryUsage() + nbrBytes);
 
 		// Update the current row based on the neighbor count for the same row.
 		// First test for live cells in the current row that need to die.
-		auto iNbrIter = nbrs.find(i);
-		assert(iNbrIter != nbrs.end());
-		auto jIter = iIter->second.begin();
-		while (jIter != iIter->second.end())
 		{
-			auto jNextIter = jIter;
-			jNextIter++;
+			PhaseScope scope(instrumentation, PHASE_DEATH);
+			int64_t deaths = 0;
+			RowEnds before(iIter->second);
+			auto iNbrIter = nbrs.find(i);
+			assert(iNbrIter != nbrs.end());
+			auto jIter = iIter->second.begin();
+			while (jIter != iIter->second.end())
+			{
+				auto jNextIter = jIter;
+				jNextIter++;
+
+				CellIndex j = *jIter;
+				int liveNbrs = 0;
+				auto jNbrIter = iNbrIter->second.find(j);
+				if (jNbrIter != iNbrIter->second.end())
+				{
+					liveNbrs = jNbrIter->second;
+				}
+				if ((liveNbrs < NEIGHBOR_COUNT_MIN) || (liveNbrs > NEIGHBOR_COUNT_MAX))
+				{
+					iIter->second.erase(jIter);
+					deaths++;
+					if (mChangeSet)
+					{
+						ChangeSpan span = { i, j, 1 };
+						mChangeSet->push_back(span);
+					}
+				}
 
-			CellIndex j = *jIter;
-			int liveNbrs = 0;
-			auto jNbrIter = iNbrIter->second.find(j);
-			if (jNbrIter != iNbrIter->second.end())
+				jIter = jNextIter;
+			}
+
+			mPopulation -= deaths;
+			if (deaths > 0)
 			{
-				liveNbrs = jNbrIter->second;
+				noteRowEnds(before, iIter->second);
 			}
-			if ((liveNbrs < NEIGHBOR_COUNT_MIN) || (liveNbrs > NEIGHBOR_COUNT_MAX))
+			if (instrumentation)
 			{
-				iIter->second.erase(jIter);
+				instrumentation->countDeaths(deaths);
 			}
-
-			jIter = jNextIter;
 		}
 
 		// Clear out row of board if it is now empty.
@@ -159,14 +443,34 @@ void SparseBoard::update()
     }
 
     // Process remaining neighbor counts.
-	while (!nbrs.empty())
 	{
-		birthCells(nbrs.begin()->first, nbrs);
-		nbrs.erase(nbrs.begin());
+		PhaseScope scope(instrumentation, PHASE_BIRTH);
+		while (!nbrs.empty())
+		{
+			birthCells(nbrs.begin()->first, nbrs);
+			if (instrumentation)
+			{
+				instrumentation->countAllocations(nbrs.begin()->second.size() + 1);
+			}
+			nbrs.erase(nbrs.begin());
+		}
+	}
+
+	notePeakMemory(peakBytes);
+
+	// Rows are born after the rows below them have had their deaths.
+	if (mChangeSet)
+	{
+		sortChangeSet();
+	}
+
+	if (instrumentation)
+	{
+		instrumentation->endGeneration(mPopulation);
 	}
 }
 
-const int8_t* SparseBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height)
+const int8_t* SparseBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
 {
     // round width up to nearest 8 (bits)
     if (width % 8 != 0)
@@ -245,4 +549,22 @@ bool SparseBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
 void SparseBoard::clearBoard()
 {
     mBoard.clear();
+    mRowFirsts.clear();
+    mRowLasts.clear();
+    mPopulation = 0;
+    mIndexDirty = true;
+}
+
+shared_ptr<const Board> SparseBoard::snapshot() const
+{
+    vector<CellCoord> cells;
+    cells.reserve(static_cast<size_t>(mPopulation));
+    for (auto iIter = mBoard.begin(); iIter != mBoard.end(); iIter++)
+    {
+        for (auto jIter = iIter->second.begin(); jIter != iIter->second.end(); jIter++)
+        {
+            cells.push_back(CellCoord(iIter->first, *jIter));
+        }
+    }
+    return make_shared<FrozenBoard>(cells);
 }
\ No newline at end of file
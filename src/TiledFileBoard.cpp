@@ -0,0 +1,745 @@
+#include "TiledFileBoard.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef GOL_HAVE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+TiledFileBoard::TiledFileBoard(CellIndex rows, CellIndex columns, const string& directory,
+    size_t residentBytes) :
+    Board(), mCurrent(0), mFile(-1), mResidentBytes(residentBytes), mSweepGenerations(1),
+    mTileLoads(0), mPopulation(0)
+{
+    mRows = max<CellIndex>(rows, 0);
+    mColumns = max<CellIndex>(columns, 0);
+    mWordsPerRow = (mColumns + BITS_PER_WORD - 1) / BITS_PER_WORD;
+    mTileRows = (mRows + TILE_ROWS - 1) / TILE_ROWS;
+    mTileColumns = (mColumns + TILE_COLUMNS - 1) / TILE_COLUMNS;
+    mTileCount = static_cast<size_t>(mTileRows * mTileColumns);
+    mTilePopulation[0].assign(mTileCount, 0);
+    mTilePopulation[1].assign(mTileCount, 0);
+
+#ifdef GOL_HAVE_MMAP
+    // Both sets of tiles go in one file, which starts out sparse, so that
+    // only tiles ever written take up disk.
+    string dir = directory;
+    if (dir.empty())
+    {
+        const char* tmp = getenv("TMPDIR");
+        dir = (tmp && *tmp) ? tmp : "/tmp";
+    }
+    string path = dir + "/gol_tiles_XXXXXX";
+    vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    mFile = mkstemp(name.data());
+    if (mFile != -1)
+    {
+        unlink(name.data());
+        if (ftruncate(mFile, static_cast<off_t>(2 * mTileCount * TILE_BYTES)) != 0)
+        {
+            close(mFile);
+            mFile = -1;
+        }
+    }
+    if (mFile == -1)
+    {
+        cerr << "Failed to create tile file in " << dir << " (" << strerror(errno)
+             << "); keeping tiles in memory" << endl;
+    }
+#else
+    (void)directory;
+#endif
+}
+
+TiledFileBoard::~TiledFileBoard()
+{
+    releaseAll();
+#ifdef GOL_HAVE_MMAP
+    if (mFile != -1)
+    {
+        close(mFile);
+    }
+#endif
+}
+
+uint64_t* TiledFileBoard::getTile(size_t key) const
+{
+    auto found = mResident.find(key);
+    if (found != mResident.end())
+    {
+        mUseOrder.splice(mUseOrder.begin(), mUseOrder, found->second.use);
+        return found->second.words;
+    }
+
+    ResidentTile tile;
+    tile.words = NULL;
+#ifdef GOL_HAVE_MMAP
+    if (mFile != -1)
+    {
+        // Make room by unmapping the least recently used tiles. Their
+        // changes stay in the file.
+        while (!mResident.empty() && ((mResident.size() + 1) * TILE_BYTES > mResidentBytes))
+        {
+            auto oldest = mResident.find(mUseOrder.back());
+            releaseTile(oldest->second);
+            mResident.erase(oldest);
+            mUseOrder.pop_back();
+        }
+
+        void* words = mmap(NULL, TILE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, mFile,
+            static_cast<off_t>(key * TILE_BYTES));
+        if (words == MAP_FAILED)
+        {
+            // Out of address space or mappings; there is no going on.
+            cerr << "Failed to map tile: " << strerror(errno) << endl;
+            abort();
+        }
+        tile.words = static_cast<uint64_t*>(words);
+    }
+#endif
+    if (!tile.words)
+    {
+        tile.words = new uint64_t[TILE_BYTES / sizeof(uint64_t)]();
+    }
+    mTileLoads++;
+
+    mUseOrder.push_front(key);
+    tile.use = mUseOrder.begin();
+    mResident[key] = tile;
+    return tile.words;
+}
+
+const uint64_t* TiledFileBoard::readTile(CellIndex tr, CellIndex tc) const
+{
+    size_t t = static_cast<size_t>(tr * mTileColumns + tc);
+    if (mTilePopulation[mCurrent][t] == 0)
+    {
+        return NULL;
+    }
+    return getTile(getKey(mCurrent, tr, tc));
+}
+
+void TiledFileBoard::releaseTile(const ResidentTile& tile) const
+{
+#ifdef GOL_HAVE_MMAP
+    if (mFile != -1)
+    {
+        munmap(tile.words, TILE_BYTES);
+        return;
+    }
+#endif
+    delete[] tile.words;
+}
+
+void TiledFileBoard::releaseAll() const
+{
+    for (auto& resident : mResident)
+    {
+        releaseTile(resident.second);
+    }
+    mResident.clear();
+    mUseOrder.clear();
+}
+
+void TiledFileBoard::prefetchTile(CellIndex tr, CellIndex tc) const
+{
+#if defined(GOL_HAVE_MMAP) && defined(POSIX_FADV_WILLNEED)
+    // The kernel reads the tile in the background, so that mapping it later
+    // finds it in the page cache.
+    if ((mFile != -1) && (tr < mTileRows) &&
+        (mTilePopulation[mCurrent][static_cast<size_t>(tr * mTileColumns + tc)] != 0) &&
+        (mResident.find(getKey(mCurrent, tr, tc)) == mResident.end()))
+    {
+        posix_fadvise(mFile, static_cast<off_t>(getKey(mCurrent, tr, tc) * TILE_BYTES),
+            static_cast<off_t>(TILE_BYTES), POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)tr;
+    (void)tc;
+#endif
+}
+
+void TiledFileBoard::setResidentLimit(size_t bytes)
+{
+    mResidentBytes = bytes;
+}
+
+void TiledFileBoard::setSweepGenerations(int generations)
+{
+    mSweepGenerations = min(max(generations, 1), static_cast<int>(MAX_SWEEP_GENERATIONS));
+}
+
+bool TiledFileBoard::hasLiveNeighborhood(CellIndex tr, CellIndex tc) const
+{
+    const vector<uint32_t>& population = mTilePopulation[mCurrent];
+    for (CellIndex r = max<CellIndex>(tr - 1, 0); r <= min(tr + 1, mTileRows - 1); r++)
+    {
+        for (CellIndex c = max<CellIndex>(tc - 1, 0); c <= min(tc + 1, mTileColumns - 1); c++)
+        {
+            if (population[static_cast<size_t>(r * mTileColumns + c)] != 0)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TiledFileBoard::loadHalo(CellIndex tr, CellIndex tc, int halo, uint64_t* scratch) const
+{
+    // Scratch row s holds board row top + s; scratch word 0 is the last word
+    // of the tile to the left, and the last scratch word is the first word
+    // of the tile to the right. Cells beyond the board are dead.
+    const size_t width = TILE_WORDS + 2;
+    const size_t height = TILE_ROWS + 2 * halo;
+    CellIndex top = tr * TILE_ROWS - halo;
+    memset(scratch, 0, width * height * sizeof(uint64_t));
+
+    for (CellIndex r = max<CellIndex>(tr - 1, 0); r <= min(tr + 1, mTileRows - 1); r++)
+    {
+        CellIndex first = max(r * TILE_ROWS, top);
+        CellIndex last = min((r + 1) * TILE_ROWS, top + static_cast<CellIndex>(height));
+        for (CellIndex c = max<CellIndex>(tc - 1, 0); c <= min(tc + 1, mTileColumns - 1); c++)
+        {
+            const uint64_t* tile = readTile(r, c);
+            if (!tile)
+            {
+                continue;
+            }
+
+            size_t fromWord = (c < tc) ? TILE_WORDS - 1 : 0;
+            size_t toWord = (c < tc) ? 0 : ((c == tc) ? 1 : width - 1);
+            size_t words = (c == tc) ? TILE_WORDS : 1;
+            for (CellIndex i = first; i < last; i++)
+            {
+                memcpy(&scratch[(i - top) * width + toWord],
+                    &tile[(i - r * TILE_ROWS) * TILE_WORDS + fromWord], words * sizeof(uint64_t));
+            }
+        }
+    }
+}
+
+void TiledFileBoard::includeRow(CellIndex i, CellIndex tc, const uint64_t* row) const
+{
+    int first = TILE_WORDS, last = 0;
+    for (int w = 0; w < TILE_WORDS; w++)
+    {
+        if (row[w] != 0)
+        {
+            first = min(first, w);
+            last = w;
+        }
+    }
+
+    if (first < TILE_WORDS)
+    {
+        CellIndex left = tc * TILE_COLUMNS;
+        mBox.include(i, left + first * BITS_PER_WORD + countTrailingZeros(row[first]));
+        mBox.include(i, left + last * BITS_PER_WORD + highestBit(row[last]));
+    }
+}
+
+void TiledFileBoard::addChangedWords(CellIndex tr, CellIndex tc, const uint64_t* before,
+    const uint64_t* after, int halo)
+{
+    const size_t width = TILE_WORDS + 2;
+    for (int r = 0; r < TILE_ROWS; r++)
+    {
+        for (int w = 0; w < TILE_WORDS; w++)
+        {
+            size_t x = (halo + r) * width + 1 + w;
+            if (before[x] != after[x])
+            {
+                ChangeSpan span = { tr * TILE_ROWS + r, tc * TILE_COLUMNS + w * BITS_PER_WORD, before[x] ^ after[x] };
+                mChangeSet->push_back(span);
+            }
+        }
+    }
+}
+
+void TiledFileBoard::sweep(int generations)
+{
+    // Counting and updating happen in the same pass, so all of it is timed
+    // as neighbor counting.
+    Instrumentation* instrumentation = mInstrumentation;
+    if (instrumentation)
+    {
+        instrumentation->beginGeneration();
+        instrumentation->beginPhase(PHASE_NEIGHBOR_COUNT);
+    }
+    uint64_t loads = mTileLoads;
+
+    const size_t width = TILE_WORDS + 2;
+    const size_t height = TILE_ROWS + 2 * generations;
+    mScratch.resize(2 * width * height);
+    uint64_t* buffers[2] = { mScratch.data(), mScratch.data() + width * height };
+
+    uint64_t lastWordMask = ~uint64_t(0);
+    if (mColumns % BITS_PER_WORD != 0)
+    {
+        lastWordMask = (uint64_t(1) << (mColumns % BITS_PER_WORD)) - 1;
+    }
+
+    if (mChangeSet)
+    {
+        mChangeSet->clear();
+    }
+
+    int next = 1 - mCurrent;
+    int64_t births = 0, deaths = 0;
+    mPopulation = 0;
+    mBox.reset();
+    for (CellIndex tr = 0; tr < mTileRows; tr++)
+    {
+        CellIndex top = tr * TILE_ROWS - generations;
+        for (CellIndex tc = 0; tc < mTileColumns; tc++)
+        {
+            // The row of tiles after the ones being read is read ahead.
+            prefetchTile(tr + 2, tc);
+
+            size_t t = static_cast<size_t>(tr * mTileColumns + tc);
+            if (!hasLiveNeighborhood(tr, tc))
+            {
+                if (mTilePopulation[next][t] != 0)
+                {
+                    memset(getTile(getKey(next, tr, tc)), 0, TILE_BYTES);
+                    mTilePopulation[next][t] = 0;
+                }
+                continue;
+            }
+
+            // Cells beyond the board must stay dead from one generation to
+            // the next, so mask off the words of the halo outside it.
+            uint64_t masks[TILE_WORDS + 2];
+            for (size_t x = 0; x < width; x++)
+            {
+                CellIndex w = tc * TILE_WORDS + static_cast<CellIndex>(x) - 1;
+                masks[x] = ((w < 0) || (w >= mWordsPerRow)) ? 0 :
+                    ((w == mWordsPerRow - 1) ? lastWordMask : ~uint64_t(0));
+            }
+
+            // Each generation is good one row and one column less on each
+            // side of the halo; after the last, the tile itself is left.
+            loadHalo(tr, tc, generations, buffers[0]);
+            for (int g = 0; g < generations; g++)
+            {
+                const uint64_t* in = buffers[g % 2];
+                uint64_t* out = buffers[(g + 1) % 2];
+                for (size_t s = g + 1; s + g + 1 < height; s++)
+                {
+                    CellIndex i = top + static_cast<CellIndex>(s);
+                    uint64_t* outRow = &out[s * width];
+                    if ((i < 0) || (i >= mRows))
+                    {
+                        memset(outRow, 0, width * sizeof(uint64_t));
+                        continue;
+                    }
+                    lifeRow(&in[(s - 1) * width], &in[s * width], &in[(s + 1) * width], outRow, width);
+                    for (size_t x = 0; x < width; x++)
+                    {
+                        outRow[x] &= masks[x];
+                    }
+                }
+            }
+
+            const uint64_t* result = buffers[generations % 2];
+            int64_t population = 0;
+            for (int r = 0; r < TILE_ROWS; r++)
+            {
+                const uint64_t* row = &result[(generations + r) * width + 1];
+                for (int w = 0; w < TILE_WORDS; w++)
+                {
+                    population += popCount(row[w]);
+                }
+            }
+            if (mChangeSet)
+            {
+                addChangedWords(tr, tc, buffers[0], result, generations);
+            }
+            if (instrumentation && (generations == 1))
+            {
+                for (int r = 0; r < TILE_ROWS; r++)
+                {
+                    const uint64_t* before = &buffers[0][(1 + r) * width + 1];
+                    const uint64_t* after = &result[(1 + r) * width + 1];
+                    for (int w = 0; w < TILE_WORDS; w++)
+                    {
+                        births += popCount(after[w] & ~before[w]);
+                        deaths += popCount(before[w] & ~after[w]);
+                    }
+                }
+            }
+
+            // A tile that was and stays empty needn't be touched.
+            if ((population == 0) && (mTilePopulation[next][t] == 0))
+            {
+                continue;
+            }
+            uint64_t* tile = getTile(getKey(next, tr, tc));
+            for (int r = 0; r < TILE_ROWS; r++)
+            {
+                const uint64_t* row = &result[(generations + r) * width + 1];
+                memcpy(&tile[r * TILE_WORDS], row, TILE_WORDS * sizeof(uint64_t));
+                if (population > 0)
+                {
+                    includeRow(tr * TILE_ROWS + r, tc, row);
+                }
+            }
+            mTilePopulation[next][t] = static_cast<uint32_t>(population);
+            mPopulation += population;
+        }
+    }
+    mCurrent = next;
+    notePeakMemory(getMemoryUsage());
+
+    // Tiles go one after another along a row of tiles, not row by row.
+    if (mChangeSet)
+    {
+        sortChangeSet();
+    }
+
+    if (instrumentation)
+    {
+        instrumentation->endPhase(PHASE_NEIGHBOR_COUNT);
+        instrumentation->countBirths(births);
+        instrumentation->countDeaths(deaths);
+        instrumentation->countAllocations(static_cast<int64_t>(mTileLoads - loads));
+        instrumentation->endGeneration(mPopulation);
+    }
+}
+
+void TiledFileBoard::advance(int64_t generations)
+{
+    while (generations > 0)
+    {
+        bool perGeneration = mInstrumentation || mChangeSet;
+        int step = perGeneration ? 1 : static_cast<int>(min<int64_t>(generations, mSweepGenerations));
+        sweep(step);
+        generations -= step;
+    }
+}
+
+void TiledFileBoard::update()
+{
+    sweep(1);
+}
+
+bool TiledFileBoard::getCell(CellIndex i, CellIndex j) const
+{
+    if (!contains(i, j))
+    {
+        return false;
+    }
+    const uint64_t* tile = readTile(i / TILE_ROWS, j / TILE_COLUMNS);
+    if (!tile)
+    {
+        return false;
+    }
+    CellIndex c = j % TILE_COLUMNS;
+    return ((tile[(i % TILE_ROWS) * TILE_WORDS + c / BITS_PER_WORD] >> (c % BITS_PER_WORD)) & 1) != 0;
+}
+
+void TiledFileBoard::setCell(CellIndex i, CellIndex j, bool alive)
+{
+    if (!contains(i, j))
+    {
+        return;
+    }
+
+    CellIndex tr = i / TILE_ROWS, tc = j / TILE_COLUMNS;
+    uint32_t& population = mTilePopulation[mCurrent][static_cast<size_t>(tr * mTileColumns + tc)];
+    if (!alive && (population == 0))
+    {
+        return;
+    }
+
+    CellIndex c = j % TILE_COLUMNS;
+    uint64_t& word = getTile(getKey(mCurrent, tr, tc))[(i % TILE_ROWS) * TILE_WORDS + c / BITS_PER_WORD];
+    uint64_t bit = uint64_t(1) << (c % BITS_PER_WORD);
+    if (alive && !(word & bit))
+    {
+        word |= bit;
+        population++;
+        mPopulation++;
+        mBox.include(i, j);
+    }
+    else if (!alive && (word & bit))
+    {
+        word &= ~bit;
+        population--;
+        mPopulation--;
+        mBox.exclude(i, j);
+    }
+}
+
+void TiledFileBoard::clearBoard()
+{
+    releaseAll();
+#ifdef GOL_HAVE_MMAP
+    // Truncating the file zeroes it and gives back its disk.
+    if (mFile != -1)
+    {
+        off_t bytes = static_cast<off_t>(2 * mTileCount * TILE_BYTES);
+        if ((ftruncate(mFile, 0) != 0) || (ftruncate(mFile, bytes) != 0))
+        {
+            cerr << "Failed to clear tile file: " << strerror(errno) << endl;
+        }
+    }
+#endif
+    fill(mTilePopulation[0].begin(), mTilePopulation[0].end(), 0);
+    fill(mTilePopulation[1].begin(), mTilePopulation[1].end(), 0);
+    mPopulation = 0;
+    mBox.reset();
+}
+
+uint64_t TiledFileBoard::extractBits(CellIndex i, CellIndex j) const
+{
+    // Cells j to j + 63 span at most two words, possibly of two tiles.
+    CellIndex w = (j >= 0) ? (j / BITS_PER_WORD) : -((BITS_PER_WORD - 1 - j) / BITS_PER_WORD);
+    int shift = static_cast<int>(j - w * BITS_PER_WORD);
+    uint64_t words[2] = { 0, 0 };
+    for (int k = 0; k < 2; k++)
+    {
+        CellIndex word = w + k;
+        if ((i < 0) || (i >= mRows) || (word < 0) || (word >= mWordsPerRow))
+        {
+            continue;
+        }
+        const uint64_t* tile = readTile(i / TILE_ROWS, word / TILE_WORDS);
+        if (tile)
+        {
+            words[k] = tile[(i % TILE_ROWS) * TILE_WORDS + word % TILE_WORDS];
+        }
+    }
+    if (shift == 0)
+    {
+        return words[0];
+    }
+    return (words[0] >> shift) | (words[1] << (BITS_PER_WORD - shift));
+}
+
+const int8_t* TiledFileBoard::getBitmap(CellIndex iOffset, CellIndex jOffset, int &width, int& height) const
+{
+    // round width up to nearest 8 (bits)
+    if (width % 8 != 0)
+    {
+        width += 8 - (width % 8);
+    }
+    int bw = width / 8;
+
+    int8_t* bitmap = new int8_t[height * bw];
+    memset(bitmap, 0, height * bw * sizeof(int8_t));
+
+    // Bitmap bytes hold cells in the same bit order as the packed rows,
+    // so copy 64 cells at a time.
+    for (int iCount = 0; iCount < height; iCount++)
+    {
+        int8_t* out = &bitmap[iCount * bw];
+        for (int byteCount = 0; byteCount < bw; byteCount += 8)
+        {
+            uint64_t bits = extractBits(iOffset + iCount, jOffset + 8 * byteCount);
+            for (int b = 0; (b < 8) && (byteCount + b < bw); b++)
+            {
+                out[byteCount + b] = static_cast<int8_t>((bits >> (8 * b)) & 0xff);
+            }
+        }
+    }
+
+    return bitmap;
+}
+
+bool TiledFileBoard::findLiveCell(CellIndex i, CellIndex j, CellIndex& iFound, CellIndex& jFound) const
+{
+    for (; i < mRows; i++, j = 0)
+    {
+        // Skip rows of tiles without live cells.
+        CellIndex tr = i / TILE_ROWS;
+        bool empty = true;
+        for (CellIndex tc = 0; empty && (tc < mTileColumns); tc++)
+        {
+            empty = (mTilePopulation[mCurrent][static_cast<size_t>(tr * mTileColumns + tc)] == 0);
+        }
+        if (empty)
+        {
+            i = (tr + 1) * TILE_ROWS - 1;
+            continue;
+        }
+
+        for (CellIndex tc = j / TILE_COLUMNS; tc < mTileColumns; tc++)
+        {
+            const uint64_t* tile = readTile(tr, tc);
+            if (!tile)
+            {
+                continue;
+            }
+
+            const uint64_t* row = &tile[(i % TILE_ROWS) * TILE_WORDS];
+            CellIndex c = max<CellIndex>(j - tc * TILE_COLUMNS, 0);
+            int b = static_cast<int>(c % BITS_PER_WORD);
+            for (CellIndex w = c / BITS_PER_WORD; w < TILE_WORDS; w++, b = 0)
+            {
+                uint64_t word = (row[w] >> b) << b;
+                if (word != 0)
+                {
+                    iFound = i;
+                    jFound = tc * TILE_COLUMNS + w * BITS_PER_WORD + countTrailingZeros(word);
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+bool TiledFileBoard::getFirstLiveCell(CellIndex& i, CellIndex& j) const
+{
+    return findLiveCell(0, 0, i, j);
+}
+
+bool TiledFileBoard::getNextLiveCell(CellIndex& i, CellIndex& j) const
+{
+    return findLiveCell(i, j + 1, i, j);
+}
+
+int64_t TiledFileBoard::getPopulation() const
+{
+    return mPopulation;
+}
+
+bool TiledFileBoard::getBoundingBox(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    if (mBox.dirty)
+    {
+        mBox.reset();
+        for (CellIndex tr = 0; tr < mTileRows; tr++)
+        {
+            for (CellIndex tc = 0; tc < mTileColumns; tc++)
+            {
+                const uint64_t* tile = readTile(tr, tc);
+                for (int r = 0; tile && (r < TILE_ROWS); r++)
+                {
+                    includeRow(tr * TILE_ROWS + r, tc, &tile[r * TILE_WORDS]);
+                }
+            }
+        }
+    }
+    return mBox.get(iMin, jMin, iMax, jMax);
+}
+
+bool TiledFileBoard::getLimits(CellIndex& iMin, CellIndex& jMin, CellIndex& iMax, CellIndex& jMax) const
+{
+    iMin = 0;
+    jMin = 0;
+    iMax = mRows - 1;
+    jMax = mColumns - 1;
+    return true;
+}
+
+int64_t TiledFileBoard::countCells(CellIndex iMin, CellIndex jMin, CellIndex iMax, CellIndex jMax) const
+{
+    // Clip to the board.
+    iMin = max<CellIndex>(iMin, 0);
+    jMin = max<CellIndex>(jMin, 0);
+    iMax = min(iMax, mRows - 1);
+    jMax = min(jMax, mColumns - 1);
+    if ((iMin > iMax) || (jMin > jMax))
+    {
+        return 0;
+    }
+
+    int64_t count = 0;
+    for (CellIndex tr = iMin / TILE_ROWS; tr <= iMax / TILE_ROWS; tr++)
+    {
+        CellIndex r0 = max(iMin - tr * TILE_ROWS, CellIndex(0));
+        CellIndex r1 = min(iMax - tr * TILE_ROWS, CellIndex(TILE_ROWS - 1));
+        for (CellIndex tc = jMin / TILE_COLUMNS; tc <= jMax / TILE_COLUMNS; tc++)
+        {
+            CellIndex c0 = max(jMin - tc * TILE_COLUMNS, CellIndex(0));
+            CellIndex c1 = min(jMax - tc * TILE_COLUMNS, CellIndex(TILE_COLUMNS - 1));
+            uint32_t population = mTilePopulation[mCurrent][static_cast<size_t>(tr * mTileColumns + tc)];
+            if ((population == 0) ||
+                ((r0 == 0) && (c0 == 0) && (r1 == TILE_ROWS - 1) && (c1 == TILE_COLUMNS - 1)))
+            {
+                count += population;
+                continue;
+            }
+
+            const uint64_t* tile = readTile(tr, tc);
+            size_t w0 = static_cast<size_t>(c0 / BITS_PER_WORD);
+            size_t w1 = static_cast<size_t>(c1 / BITS_PER_WORD);
+            for (CellIndex r = r0; r <= r1; r++)
+            {
+                const uint64_t* row = &tile[r * TILE_WORDS];
+                for (size_t w = w0; w <= w1; w++)
+                {
+                    int first = (w == w0) ? static_cast<int>(c0 % BITS_PER_WORD) : 0;
+                    int last = (w == w1) ? static_cast<int>(c1 % BITS_PER_WORD) : BITS_PER_WORD - 1;
+                    count += popCount(row[w] & bitRange(first, last));
+                }
+            }
+        }
+    }
+    return count;
+}
+
+size_t TiledFileBoard::getMemoryUsage() const
+{
+    // Each tile in memory also has a hash node and a list node.
+    return sizeof(*this) + mResident.size() * (TILE_BYTES + 4 * sizeof(void*) + 2 * sizeof(size_t)) +
+        2 * mTileCount * sizeof(uint32_t) + mScratch.capacity() * sizeof(uint64_t);
+}
+
+size_t TiledFileBoard::estimateUpdateMemory() const
+{
+    size_t scratch = 2 * (TILE_WORDS + 2) * (TILE_ROWS + 2 * mSweepGenerations) * sizeof(uint64_t);
+    size_t fixed = sizeof(*this) + 2 * mTileCount * sizeof(uint32_t) + scratch;
+    if (mFile != -1)
+    {
+        return fixed + min(mResidentBytes, 2 * mTileCount * TILE_BYTES);
+    }
+
+    // On the heap, every tile with live cells gets a copy for the next generation.
+    size_t tiles = mResident.size();
+    for (size_t t = 0; t < mTileCount; t++)
+    {
+        tiles += (mTilePopulation[mCurrent][t] != 0);
+    }
+    return fixed + tiles * TILE_BYTES;
+}
+
+size_t TiledFileBoard::compact()
+{
+    size_t before = getMemoryUsage();
+    if (mFile != -1)
+    {
+        releaseAll();
+    }
+    else
+    {
+        // The heap holds the only copy of tiles with live cells.
+        for (auto iter = mResident.begin(); iter != mResident.end();)
+        {
+            if (mTilePopulation[iter->first / mTileCount][iter->first % mTileCount] == 0)
+            {
+                releaseTile(iter->second);
+                mUseOrder.erase(iter->second.use);
+                iter = mResident.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    }
+    vector<uint64_t>().swap(mScratch);
+    return before - getMemoryUsage();
+}
@@ -0,0 +1,257 @@
+// Tests for BoardHistory and the cell codec it stores generations with:
+// any recorded generation must come back as a fresh run of the board
+// would have it, however the history was thinned to fit its cap.
+
+#include "BoardHistory.h"
+#include "CellCodec.h"
+#include "Check.h"
+#include "PackedBoard.h"
+#include "SparseBoard.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static const int GENERATIONS = 300; /// Generations recorded before moving around.
+static const int ROUNDS = 40; /// Seeks to random generations.
+static const uint64_t KEYFRAME_INTERVAL = 8; /// Generations between keyframes.
+static const size_t MEMORY_CAP = 48 << 10; /// Cap on the history's bytes.
+
+/// Lets the test see which recorded generations are keyframes.
+class InspectedHistory : public BoardHistory
+{
+public:
+    InspectedHistory(Board* board) :
+        BoardHistory(board, KEYFRAME_INTERVAL, MEMORY_CAP)
+    {
+    }
+
+    /// Bytes used by recorded generations, which the cap applies to.
+    size_t getFrameBytes() const { return mBytes; }
+
+    /// Count the generations that were keyframes when recorded, but aren't now.
+    int countThinned() const
+    {
+        int thinned = 0;
+        for (size_t f = 1; f < mFrames.size(); f++)
+        {
+            thinned += ((mFrames[f].generation % KEYFRAME_INTERVAL == 0) && !mFrames[f].isKeyframe) ? 1 : 0;
+        }
+        return thinned;
+    }
+};
+
+/// Encode and decode cells, checking they come back as they were.
+static void checkRoundTrip(const vector<CellCoord>& cells)
+{
+    vector<uint8_t> encoded;
+    encodeCells(cells, encoded);
+    vector<CellCoord> decoded;
+    CHECK(decodeCells(encoded.data(), encoded.size(), decoded));
+    CHECK(decoded == cells);
+}
+
+/// Check the codec on empty, dense and scattered lists of cells, and on
+/// malformed data, and check diffCells().
+static void checkCodec(mt19937_64& random)
+{
+    checkRoundTrip(vector<CellCoord>());
+
+    // After the first cell, cells along a row take a byte for the row and
+    // one for the column.
+    vector<CellCoord> run;
+    for (CellIndex j = -50; j < 50; j += 1 + static_cast<CellIndex>(random() % 3))
+    {
+        run.push_back(CellCoord(-3, j));
+    }
+    checkRoundTrip(run);
+    vector<uint8_t> encoded, first;
+    encodeCells(run, encoded);
+    encodeCells(vector<CellCoord>(1, run[0]), first);
+    CHECK(encoded.size() == first.size() + 2 * (run.size() - 1));
+
+    // Cells anywhere, out to the ends of the range, where the differences
+    // between them wrap around.
+    for (int round = 0; round < 100; round++)
+    {
+        vector<CellCoord> cells;
+        cells.push_back(CellCoord(INT64_MIN, INT64_MAX));
+        cells.push_back(CellCoord(INT64_MAX, INT64_MIN));
+        cells.push_back(CellCoord(0, 0));
+        for (int c = 0; c < 50; c++)
+        {
+            CellIndex scale = (c % 3 == 0) ? INT64_MAX : 1000;
+            cells.push_back(CellCoord(static_cast<CellIndex>(random() % 7) - 3,
+                static_cast<CellIndex>(random() % scale) - scale / 2));
+            cells.push_back(CellCoord(static_cast<CellIndex>(random()), static_cast<CellIndex>(random())));
+        }
+        sort(cells.begin(), cells.end());
+        cells.erase(unique(cells.begin(), cells.end()), cells.end());
+        checkRoundTrip(cells);
+
+        // Data cut off before its last byte, or with a number of more than
+        // 64 bits, is malformed.
+        encoded.clear();
+        encodeCells(cells, encoded);
+        vector<CellCoord> decoded;
+        CHECK(!decodeCells(encoded.data(), encoded.size() - 1, decoded));
+        vector<uint8_t> tooLong(11, 0x80);
+        tooLong.push_back(0);
+        CHECK(!decodeCells(tooLong.data(), tooLong.size(), decoded));
+
+        // And diffCells gives the cells alive in just one of two lists.
+        vector<CellCoord> other(cells.begin(), cells.begin() + cells.size() / 2), toggled, expected;
+        other.push_back(CellCoord(1, 1));
+        sort(other.begin(), other.end());
+        other.erase(unique(other.begin(), other.end()), other.end());
+        diffCells(cells, other, toggled);
+        set_symmetric_difference(cells.begin(), cells.end(), other.begin(), other.end(), back_inserter(expected));
+        CHECK(toggled == expected);
+    }
+}
+
+/// Check that a board shows the given cells.
+static void checkCells(const Board& board, const vector<CellCoord>& expected)
+{
+    vector<CellCoord> cells;
+    getLiveCells(board, cells);
+    CHECK(cells == expected);
+}
+
+/// Check that a board's change set holds the cells toggled between two generations.
+static void checkChanges(const vector<ChangeSpan>& changes, const vector<CellCoord>& from, const vector<CellCoord>& to)
+{
+    vector<CellCoord> cells, expected;
+    Board::getChangedCells(changes, cells);
+    diffCells(from, to, expected);
+    CHECK(cells == expected);
+}
+
+/// Record a soup on a board, capped so that keyframes are thinned and old
+/// generations dropped, and move around the history comparing the board
+/// with generations from a fresh run.
+static void checkHistory(Board& board, Board& fresh, mt19937_64& random)
+{
+    for (CellIndex i = 10; i < 50; i++)
+    {
+        for (CellIndex j = 10; j < 50; j++)
+        {
+            if (random() % 100 < 37)
+            {
+                board.setCell(i, j, true);
+                fresh.setCell(i, j, true);
+            }
+        }
+    }
+    // Stepping forward from the last generation records more, up to two
+    // per round and two after.
+    const int generations = GENERATIONS + 2 * ROUNDS + 2;
+    vector<vector<CellCoord> > expected(generations + 1);
+    getLiveCells(fresh, expected[0]);
+    for (int g = 1; g <= generations; g++)
+    {
+        fresh.update();
+        getLiveCells(fresh, expected[g]);
+    }
+
+    InspectedHistory history(&board);
+    int mostThinned = 0;
+    for (int g = 1; g <= GENERATIONS; g++)
+    {
+        history.step();
+        CHECK(history.getGeneration() == static_cast<uint64_t>(g));
+        checkCells(board, expected[g]);
+        mostThinned = max(mostThinned, history.countThinned());
+    }
+    CHECK(mostThinned > 0);
+    CHECK(history.getFirstGeneration() > 0);
+    CHECK(history.getLastGeneration() == GENERATIONS);
+    CHECK(history.getFrameBytes() <= MEMORY_CAP);
+
+    // Generations that were dropped can't be reached.
+    uint64_t first = history.getFirstGeneration(), last = history.getLastGeneration();
+    CHECK(!history.seek(first - 1));
+    CHECK(!history.seek(last + 1));
+    CHECK(history.getGeneration() == last);
+
+    vector<ChangeSpan> changes;
+    board.setChangeSet(&changes);
+    for (int round = 0; round < ROUNDS; round++)
+    {
+        first = history.getFirstGeneration();
+        last = history.getLastGeneration();
+        uint64_t target = first + random() % (last - first + 1);
+        CHECK(history.seek(target));
+        CHECK(history.getGeneration() == target);
+        checkCells(board, expected[target]);
+
+        // A few steps back and forth from there, each leaving its changes.
+        for (int s = 0; s < 3; s++)
+        {
+            uint64_t g = history.getGeneration();
+            if (history.stepBack())
+            {
+                checkCells(board, expected[g - 1]);
+                checkChanges(changes, expected[g], expected[g - 1]);
+            }
+            else
+            {
+                CHECK(g == first);
+            }
+        }
+        for (int s = 0; s < 5; s++)
+        {
+            uint64_t g = history.getGeneration();
+            history.step();
+            checkCells(board, expected[g + 1]);
+            checkChanges(changes, expected[g], expected[g + 1]);
+        }
+        CHECK(history.getFrameBytes() <= MEMORY_CAP);
+    }
+
+    // Steps from the last generation record new ones.
+    last = history.getLastGeneration();
+    CHECK(history.seek(last));
+    for (uint64_t g = last + 1; g <= last + 2; g++)
+    {
+        history.step();
+        CHECK(history.getLastGeneration() == g);
+        checkCells(board, expected[g]);
+        checkChanges(changes, expected[g - 1], expected[g]);
+    }
+
+    // Back at the start, there is nothing further back.
+    first = history.getFirstGeneration();
+    last = history.getLastGeneration();
+    CHECK(history.seek(first));
+    CHECK(!history.stepBack());
+    checkCells(board, expected[first]);
+
+    // Updating the board from the middle of the history and recording it
+    // replaces the generations after it.
+    uint64_t middle = (first + last) / 2;
+    CHECK(history.seek(middle));
+    board.setChangeSet(NULL);
+    board.update();
+    history.record();
+    CHECK(history.getGeneration() == middle + 1);
+    CHECK(history.getLastGeneration() == middle + 1);
+    CHECK(history.seek(middle - 1));
+    checkCells(board, expected[middle - 1]);
+    CHECK(history.seek(middle + 1));
+    checkCells(board, expected[middle + 1]);
+}
+
+int main()
+{
+    mt19937_64 random(29);
+    checkCodec(random);
+
+    SparseBoard sparse, freshSparse;
+    checkHistory(sparse, freshSparse, random);
+    PackedBoard packed(60, 60), freshPacked(60, 60);
+    checkHistory(packed, freshPacked, random);
+    return gFailures;
+}
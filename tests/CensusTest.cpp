@@ -0,0 +1,96 @@
+// Tests for the stages of a census: running a soup until it settles, with
+// spaceships taken off, and splitting its ash into named objects.
+
+#include "Census.h"
+#include "Check.h"
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// Census with its stages opened up for testing.
+class CensusUnderTest : public Census
+{
+public:
+    CensusUnderTest() :
+        Census(getOptions())
+    {
+    }
+
+    static Options getOptions()
+    {
+        Options options;
+        options.maxGenerations = 2000;
+        return options;
+    }
+
+    /// Run cells, given as rows of a picture, until they settle.
+    /// @return names of the escaped spaceships and the objects of the ash
+    vector<string> run(const vector<string>& picture, bool& settled)
+    {
+        Soup soup;
+        soup.index = 0;
+        for (size_t i = 0; i < picture.size(); i++)
+        {
+            for (size_t j = 0; j < picture[i].size(); j++)
+            {
+                if (picture[i][j] == 'O')
+                {
+                    soup.cells.push_back(CellCoord(i, j));
+                }
+            }
+        }
+
+        Ash ash;
+        runSoup(soup, ash);
+        settled = ash.settled;
+        vector<Object> objects;
+        splitAsh(ash, objects);
+        vector<string> names;
+        for (size_t o = 0; o < objects.size(); o++)
+        {
+            names.push_back(getObjectCode(objects[o].phases, objects[o].moving));
+        }
+        return names;
+    }
+};
+
+int main()
+{
+    CensusUnderTest census;
+    bool settled = false;
+
+    // A lone LWSS has a phase with a cell apart from the rest.
+    const char* lwss[] = { ".O..O", "O....", "O...O", "OOOO." };
+    vector<string> names = census.run(vector<string>(lwss, lwss + 4), settled);
+    CHECK(settled);
+    CHECK(names == vector<string>(1, "xq4_6frc"));
+
+    // Two gliders flying side by side escape together.
+    const char* gliders[] = { ".O.....O.", "..O.....O", "OOO...OOO" };
+    names = census.run(vector<string>(gliders, gliders + 3), settled);
+    CHECK(settled);
+    CHECK(names == vector<string>(2, "xq4_153"));
+
+    // A glider flying away from a block escapes; the block stays.
+    const char* away[] = { "OO..........", "OO..........", "..........O.", "...........O", ".........OOO" };
+    names = census.run(vector<string>(away, away + 5), settled);
+    CHECK(settled);
+    CHECK((names.size() == 2) && (names[0] == "xq4_153") && (names[1] == "xs4_33"));
+
+    // A still life whose 8-connected pieces aren't still lifes on their
+    // own is named as a whole: the snake is two L-triominoes.
+    const char* snake[] = { ".OO", "..O", "O..", "OO." };
+    names = census.run(vector<string>(snake, snake + 4), settled);
+    CHECK(settled);
+    CHECK(names == vector<string>(1, "xs6_39c"));
+
+    // Still lifes within reach of each other but stable on their own stay
+    // apart: a block and a beehive.
+    const char* apart[] = { "OO.....", "OO.....", "....OO.", "...O..O", "....OO." };
+    names = census.run(vector<string>(apart, apart + 5), settled);
+    CHECK(settled);
+    CHECK((names.size() == 2) && (names[0] == "xs4_33") && (names[1] == "xs6_696"));
+
+    return gFailures;
+}
@@ -0,0 +1,156 @@
+// Tests for change sets: every engine must report, in order and without
+// overlaps, exactly the cells that differ between one generation and the
+// next.
+
+#include "BasicBoard.h"
+#include "CellCodec.h"
+#include "Check.h"
+#include "FixedBoard.h"
+#include "FlatSparseBoard.h"
+#include "HybridBoard.h"
+#include "LargerThanLifeBoard.h"
+#include "PackedBoard.h"
+#include "SparseBoard.h"
+#include "TiledFileBoard.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/// Gives the test sortChangeSet() on change lists of its own making.
+class SortingBoard : public SparseBoard
+{
+public:
+    void sort(vector<ChangeSpan>& changes)
+    {
+        setChangeSet(&changes);
+        sortChangeSet();
+        setChangeSet(NULL);
+    }
+};
+
+/// Check that spans are in row-major order, don't overlap, and hold
+/// exactly the given cells, which are sorted.
+static void checkSpans(const vector<ChangeSpan>& changes, const vector<CellCoord>& expected)
+{
+    for (size_t s = 0; s < changes.size(); s++)
+    {
+        CHECK(changes[s].mask != 0);
+        if (s > 0)
+        {
+            CHECK((changes[s].i > changes[s - 1].i) ||
+                ((changes[s].i == changes[s - 1].i) && (changes[s].j - changes[s - 1].j >= 64)));
+        }
+    }
+    vector<CellCoord> cells;
+    Board::getChangedCells(changes, cells);
+    CHECK(cells == expected);
+}
+
+/// Fill a square of random cells.
+static void addSoup(Board& board, mt19937_64& random, CellIndex top, CellIndex left, CellIndex side)
+{
+    for (CellIndex i = top; i < top + side; i++)
+    {
+        for (CellIndex j = left; j < left + side; j++)
+        {
+            if (random() % 100 < 37)
+            {
+                board.setCell(i, j, true);
+            }
+        }
+    }
+}
+
+/// Run a board with a change set attached, and compare the changes of
+/// each generation with its cells before and after.
+static void checkEngine(Board& board, int generations)
+{
+    vector<ChangeSpan> changes;
+    board.setChangeSet(&changes);
+    vector<CellCoord> before;
+    getLiveCells(board, before);
+    for (int g = 0; g < generations; g++)
+    {
+        board.update();
+        vector<CellCoord> after, expected;
+        getLiveCells(board, after);
+        set_symmetric_difference(before.begin(), before.end(), after.begin(), after.end(), back_inserter(expected));
+        checkSpans(changes, expected);
+        before.swap(after);
+    }
+    board.setChangeSet(NULL);
+}
+
+/// Sort random spans, many of them out of order and overlapping, and
+/// check they come out as the cells of all of them.
+static void checkSort(mt19937_64& random)
+{
+    SortingBoard board;
+    for (int round = 0; round < 200; round++)
+    {
+        vector<ChangeSpan> changes;
+        vector<CellCoord> expected;
+        int count = static_cast<int>(random() % 12);
+        for (int s = 0; s < count; s++)
+        {
+            // Spans close together overlap; some far apart don't.
+            CellIndex spread = (round % 2 == 0) ? 100 : 1000;
+            ChangeSpan span = { static_cast<CellIndex>(random() % 3) - 1,
+                static_cast<CellIndex>(random() % spread) - spread / 2, random() | 1 };
+            changes.push_back(span);
+        }
+        Board::getChangedCells(changes, expected);
+        sort(expected.begin(), expected.end());
+        expected.erase(unique(expected.begin(), expected.end()), expected.end());
+
+        board.sort(changes);
+        checkSpans(changes, expected);
+    }
+}
+
+int main()
+{
+    mt19937_64 random(42);
+
+    // SparseBoard finds births and deaths apart, and out of order; soups
+    // either side of the origin check spans with negative columns.
+    SparseBoard sparse;
+    addSoup(sparse, random, -30, -30, 60);
+    checkEngine(sparse, 40);
+
+    FlatSparseBoard flat;
+    addSoup(flat, random, -30, -30, 60);
+    checkEngine(flat, 40);
+
+    HybridBoard hybrid;
+    addSoup(hybrid, random, -30, -30, 60);
+    checkEngine(hybrid, 40);
+
+    BasicBoard basic(70, 70);
+    addSoup(basic, random, 5, 5, 60);
+    checkEngine(basic, 40);
+
+    PackedBoard packed(70, 130, -10, -65);
+    addSoup(packed, random, -5, -60, 60);
+    checkEngine(packed, 40);
+
+    FixedBoard<64, 130> fixed;
+    addSoup(fixed, random, 2, 40, 60);
+    checkEngine(fixed, 40);
+
+    LargerThanLifeBoard larger(LargerThanLifeBoard::Rule(), 70, 130);
+    addSoup(larger, random, 5, 40, 60);
+    checkEngine(larger, 40);
+
+    // TiledFileBoard finds changes a tile at a time, so a row's spans in
+    // the right tile come before the next row's in the left one.
+    TiledFileBoard tiled(TiledFileBoard::TILE_ROWS + 100, TiledFileBoard::TILE_COLUMNS + 100);
+    addSoup(tiled, random, TiledFileBoard::TILE_ROWS - 40, TiledFileBoard::TILE_COLUMNS - 40, 80);
+    checkEngine(tiled, 40);
+
+    checkSort(random);
+    return gFailures;
+}
@@ -0,0 +1,21 @@
+#ifndef GOL_CHECK_H
+#define GOL_CHECK_H
+
+#include <iostream>
+
+/// Number of failed checks so far; a test's main() returns it.
+static int gFailures = 0;
+
+/// Report a failed condition without stopping the test, so that one run
+/// shows every failure. Works whether or not NDEBUG is defined.
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            gFailures++; \
+        } \
+    } while (0)
+
+#endif
@@ -0,0 +1,120 @@
+// Tests that every engine's bounding box and rectangle counts agree with
+// counts taken cell by cell, as cells are set, cleared and updated.
+
+#include "BasicBoard.h"
+#include "CellCodec.h"
+#include "Check.h"
+#include "FlatSparseBoard.h"
+#include "HybridBoard.h"
+#include "PackedBoard.h"
+#include "SparseBoard.h"
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static const CellIndex SIZE = 70; /// Side of the bounded boards.
+
+/// Compare a board's bounding box and counts of random rectangles with
+/// the same worked out from its live cells.
+static void checkCounts(const Board& board, mt19937_64& random)
+{
+    vector<CellCoord> cells;
+    getLiveCells(board, cells);
+
+    CellIndex iMin, jMin, iMax, jMax;
+    bool any = board.getBoundingBox(iMin, jMin, iMax, jMax);
+    CHECK(any == !cells.empty());
+    if (any)
+    {
+        CellIndex iLow = INT64_MAX, jLow = INT64_MAX, iHigh = INT64_MIN, jHigh = INT64_MIN;
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            iLow = min(iLow, cells[c].first);
+            iHigh = max(iHigh, cells[c].first);
+            jLow = min(jLow, cells[c].second);
+            jHigh = max(jHigh, cells[c].second);
+        }
+        CHECK((iMin == iLow) && (jMin == jLow) && (iMax == iHigh) && (jMax == jHigh));
+    }
+    CHECK(board.countCells(INT64_MIN, INT64_MIN, INT64_MAX, INT64_MAX) == static_cast<int64_t>(cells.size()));
+
+    for (int r = 0; r < 20; r++)
+    {
+        CellIndex i0 = static_cast<CellIndex>(random() % (SIZE + 10)) - 5;
+        CellIndex j0 = static_cast<CellIndex>(random() % (SIZE + 10)) - 5;
+        CellIndex i1 = i0 + static_cast<CellIndex>(random() % SIZE) - 3;
+        CellIndex j1 = j0 + static_cast<CellIndex>(random() % SIZE) - 3;
+        int64_t expected = 0;
+        for (size_t c = 0; c < cells.size(); c++)
+        {
+            expected += (cells[c].first >= i0) && (cells[c].first <= i1) &&
+                (cells[c].second >= j0) && (cells[c].second <= j1);
+        }
+        CHECK(board.countCells(i0, j0, i1, j1) == expected);
+    }
+}
+
+/// Run a soup, killing and adding cells between generations, most of them
+/// on the edges of the bounding box, and check the counts at every step.
+static void checkEngine(Board& board)
+{
+    mt19937_64 random(5);
+    for (CellIndex i = 10; i < 40; i++)
+    {
+        for (CellIndex j = 10; j < 40; j++)
+        {
+            if (random() % 100 < 37)
+            {
+                board.setCell(i, j, true);
+            }
+        }
+    }
+
+    for (int g = 0; g < 60; g++)
+    {
+        checkCounts(board, random);
+
+        // Kill a few cells on the edges of the box.
+        CellIndex iMin, jMin, iMax, jMax;
+        if (board.getBoundingBox(iMin, jMin, iMax, jMax))
+        {
+            vector<CellCoord> cells;
+            getLiveCells(board, cells);
+            for (size_t c = 0; c < cells.size(); c++)
+            {
+                if ((cells[c].first == iMin) || (cells[c].second == jMax))
+                {
+                    board.setCell(cells[c].first, cells[c].second, false);
+                }
+            }
+            checkCounts(board, random);
+        }
+
+        // And add a few, some of them as a batch.
+        board.setCell(static_cast<CellIndex>(random() % SIZE), static_cast<CellIndex>(random() % SIZE), true);
+        CellCoord batch[] = { CellCoord(random() % SIZE, random() % SIZE), CellCoord(random() % SIZE, random() % SIZE) };
+        board.setCells(batch, 2);
+        checkCounts(board, random);
+
+        board.update();
+    }
+
+    board.clearBoard();
+    checkCounts(board, random);
+}
+
+int main()
+{
+    SparseBoard sparse;
+    checkEngine(sparse);
+    FlatSparseBoard flat;
+    checkEngine(flat);
+    HybridBoard hybrid;
+    checkEngine(hybrid);
+    BasicBoard basic(SIZE, SIZE);
+    checkEngine(basic);
+    PackedBoard packed(SIZE, SIZE);
+    checkEngine(packed);
+    return gFailures;
+}
@@ -0,0 +1,76 @@
+// Tests for EnsembleBoard: every lane must run as its own board would.
+
+#include "Check.h"
+#include "EnsembleBoard.h"
+#include "PackedBoard.h"
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/// Run a different random soup on each lane of an ensemble and on a
+/// PackedBoard per lane, and compare them every few generations.
+template <typename Word>
+static void checkLanes(CellIndex rows, CellIndex columns)
+{
+    const int lanes = EnsembleBoard<Word>::LANES;
+    EnsembleBoard<Word> ensemble(rows, columns);
+    mt19937_64 random(lanes);
+    ensemble.randomize(random, 0, 0, rows - 1, columns - 1);
+
+    vector<PackedBoard*> boards;
+    for (int lane = 0; lane < lanes; lane++)
+    {
+        boards.push_back(new PackedBoard(rows, columns));
+        ensemble.extractLane(lane, *boards.back());
+    }
+
+    for (int g = 1; g <= 60; g++)
+    {
+        ensemble.update();
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            boards[lane]->update();
+        }
+        if (g % 20 != 0)
+        {
+            continue;
+        }
+
+        vector<int64_t> populations;
+        ensemble.getPopulations(populations);
+        for (int lane = 0; lane < lanes; lane++)
+        {
+            int differences = 0;
+            for (CellIndex i = 0; i < rows; i++)
+            {
+                for (CellIndex j = 0; j < columns; j++)
+                {
+                    differences += (ensemble.getCell(lane, i, j) != boards[lane]->getCell(i, j)) ? 1 : 0;
+                }
+            }
+            CHECK(differences == 0);
+            CHECK(populations[lane] == boards[lane]->getPopulation());
+            CHECK(ensemble.getPopulation(lane) == boards[lane]->getPopulation());
+        }
+    }
+
+    for (int lane = 0; lane < lanes; lane++)
+    {
+        delete boards[lane];
+    }
+}
+
+int main()
+{
+    // Sizes that are and aren't multiples of the packed word.
+    checkLanes<uint64_t>(24, 24);
+    checkLanes<uint64_t>(17, 70);
+#ifdef GOL_HAVE_ENSEMBLE_WORD256
+    checkLanes<EnsembleWord256>(24, 24);
+#endif
+#ifdef GOL_HAVE_ENSEMBLE_WORD512
+    checkLanes<EnsembleWord512>(24, 24);
+#endif
+    return gFailures;
+}
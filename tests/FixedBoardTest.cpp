@@ -0,0 +1,73 @@
+// Tests for FixedBoard: it runs as PackedBoard does, and its snapshots hold
+// the cells of the generation they were taken at and nothing else.
+
+#include "CellCodec.h"
+#include "Check.h"
+#include "FixedBoard.h"
+#include "PackedBoard.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+template <CellIndex Rows, CellIndex Cols>
+static void checkBoard()
+{
+    FixedBoard<Rows, Cols> board;
+    PackedBoard packed(Rows, Cols);
+    mt19937_64 random(Rows * Cols);
+    for (CellIndex i = 0; i < Rows; i++)
+    {
+        for (CellIndex j = 0; j < Cols; j++)
+        {
+            if (random() % 100 < 37)
+            {
+                board.setCell(i, j, true);
+                packed.setCell(i, j, true);
+            }
+        }
+    }
+
+    vector<ChangeSpan> changes;
+    board.setChangeSet(&changes);
+    shared_ptr<const Board> first = board.snapshot();
+    vector<CellCoord> firstCells;
+    getLiveCells(*first, firstCells);
+    CHECK(first->getChangeSet() == NULL);
+    CHECK(first->getMemoryUsage() < board.getMemoryUsage());
+
+    for (int g = 1; g <= 50; g++)
+    {
+        board.update();
+        packed.update();
+        vector<CellCoord> cells, expected;
+        getLiveCells(board, cells);
+        getLiveCells(packed, expected);
+        CHECK(cells == expected);
+        CHECK(board.getPopulation() == packed.getPopulation());
+
+        shared_ptr<const Board> snapshot = board.snapshot();
+        vector<CellCoord> snapshotCells;
+        getLiveCells(*snapshot, snapshotCells);
+        CHECK(snapshotCells == expected);
+        CHECK(snapshot->getPopulation() == packed.getPopulation());
+        CellIndex iMin, jMin, iMax, jMax, iMin2, jMin2, iMax2, jMax2;
+        CHECK(snapshot->getBoundingBox(iMin, jMin, iMax, jMax) == packed.getBoundingBox(iMin2, jMin2, iMax2, jMax2));
+        CHECK(expected.empty() || ((iMin == iMin2) && (jMin == jMin2) && (iMax == iMax2) && (jMax == jMax2)));
+    }
+
+    // The first snapshot still shows generation 0.
+    vector<CellCoord> cells;
+    getLiveCells(*first, cells);
+    CHECK(cells == firstCells);
+    board.setChangeSet(NULL);
+}
+
+int main()
+{
+    checkBoard<32, 32>();
+    checkBoard<64, 64>();
+    checkBoard<37, 130>();
+    return gFailures;
+}
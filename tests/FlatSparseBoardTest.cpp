@@ -0,0 +1,118 @@
+// Tests for FlatSparseBoard: it must hold and run the same cells as
+// SparseBoard, however they are set.
+
+#include "CellCodec.h"
+#include "Check.h"
+#include "FlatSparseBoard.h"
+#include "SparseBoard.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static const CellIndex SIDE = 60; /// Side of the area the soups are in.
+
+/// Get a random cell of the area, which straddles the origin.
+static CellCoord randomCell(mt19937_64& random)
+{
+    return CellCoord(static_cast<CellIndex>(random() % SIDE) - SIDE / 2,
+        static_cast<CellIndex>(random() % SIDE) - SIDE / 2);
+}
+
+/// Compare the cells, population, bounding box, rectangle counts and
+/// walks from random cells of both boards.
+static void checkSame(const FlatSparseBoard& flat, const SparseBoard& sparse, mt19937_64& random)
+{
+    vector<CellCoord> cells, expected;
+    getLiveCells(flat, cells);
+    getLiveCells(sparse, expected);
+    CHECK(cells == expected);
+    CHECK(flat.getPopulation() == sparse.getPopulation());
+
+    CellIndex iMin, jMin, iMax, jMax, iMin2, jMin2, iMax2, jMax2;
+    CHECK(flat.getBoundingBox(iMin, jMin, iMax, jMax) == sparse.getBoundingBox(iMin2, jMin2, iMax2, jMax2));
+    CHECK(expected.empty() || ((iMin == iMin2) && (jMin == jMin2) && (iMax == iMax2) && (jMax == jMax2)));
+
+    for (int r = 0; r < 20; r++)
+    {
+        CellCoord from = randomCell(random), to = randomCell(random);
+        CHECK(flat.getCell(from.first, from.second) == sparse.getCell(from.first, from.second));
+        CHECK(flat.countCells(from.first, from.second, to.first + SIDE / 2, to.second + SIDE / 2) ==
+            sparse.countCells(from.first, from.second, to.first + SIDE / 2, to.second + SIDE / 2));
+
+        // The next live cell after a cell that may be dead, or off any row.
+        CellIndex i = from.first, j = from.second;
+        vector<CellCoord>::const_iterator next = upper_bound(expected.begin(), expected.end(), from);
+        bool found = flat.getNextLiveCell(i, j);
+        CHECK(found == (next != expected.end()));
+        CHECK(!found || ((i == next->first) && (j == next->second)));
+
+        // SparseBoard only steps from live cells.
+        if (!expected.empty())
+        {
+            CellCoord live = expected[random() % expected.size()];
+            CellIndex i1 = live.first, j1 = live.second, i2 = live.first, j2 = live.second;
+            found = flat.getNextLiveCell(i1, j1);
+            CHECK(found == sparse.getNextLiveCell(i2, j2));
+            CHECK(!found || ((i1 == i2) && (j1 == j2)));
+        }
+    }
+}
+
+/// Set the same soups on both boards, each time some other way, run them,
+/// and check they agree after each step.
+static void checkSoup(int seed)
+{
+    FlatSparseBoard flat;
+    SparseBoard sparse;
+    mt19937_64 random(seed);
+
+    for (int round = 0; round < 8; round++)
+    {
+        // A batch in random order with repeats, on top of what is there.
+        vector<CellCoord> batch;
+        for (int c = 0; c < 500; c++)
+        {
+            batch.push_back(randomCell(random));
+            if (random() % 5 == 0)
+            {
+                batch.push_back(batch.back());
+            }
+        }
+        shuffle(batch.begin(), batch.end(), random);
+        flat.setCells(batch.data(), batch.size());
+        sparse.setCells(batch.data(), batch.size());
+        checkSame(flat, sparse, random);
+
+        // Single cells: births, deaths, and sets that change nothing.
+        for (int c = 0; c < 200; c++)
+        {
+            CellCoord cell = randomCell(random);
+            bool alive = (random() % 2) == 0;
+            flat.setCell(cell.first, cell.second, alive);
+            sparse.setCell(cell.first, cell.second, alive);
+        }
+        checkSame(flat, sparse, random);
+
+        for (int g = 0; g < 10; g++)
+        {
+            flat.update();
+            sparse.update();
+        }
+        checkSame(flat, sparse, random);
+    }
+
+    flat.clearBoard();
+    sparse.clearBoard();
+    checkSame(flat, sparse, random);
+}
+
+int main()
+{
+    for (int seed = 1; seed <= 5; seed++)
+    {
+        checkSoup(seed);
+    }
+    return gFailures;
+}
@@ -0,0 +1,71 @@
+// Tests for FrozenBoard, the snapshot taken of sparse engines.
+
+#include "Check.h"
+#include "FrozenBoard.h"
+#include "PackedBoard.h"
+#include "SparseBoard.h"
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/// Compare a viewport of a sparse board's snapshot with the same viewport
+/// of a packed board holding the same cells.
+static void checkBitmap(const vector<CellCoord>& cells, CellIndex iOffset, CellIndex jOffset,
+    int width, int height)
+{
+    SparseBoard sparse;
+    PackedBoard packed(64, 64);
+    for (size_t c = 0; c < cells.size(); c++)
+    {
+        sparse.setCell(cells[c].first, cells[c].second, true);
+        packed.setCell(cells[c].first, cells[c].second, true);
+    }
+    shared_ptr<const Board> snapshot = sparse.snapshot();
+    CHECK(dynamic_cast<const FrozenBoard*>(snapshot.get()) != NULL);
+
+    int frozenWidth = width, frozenHeight = height;
+    const int8_t* frozenBits = snapshot->getBitmap(iOffset, jOffset, frozenWidth, frozenHeight);
+    int packedWidth = width, packedHeight = height;
+    const int8_t* packedBits = packed.getBitmap(iOffset, jOffset, packedWidth, packedHeight);
+
+    CHECK(frozenWidth == packedWidth);
+    CHECK(frozenHeight == packedHeight);
+    for (int b = 0; b < frozenHeight * frozenWidth / 8; b++)
+    {
+        CHECK(frozenBits[b] == packedBits[b]);
+    }
+    delete[] frozenBits;
+    delete[] packedBits;
+}
+
+int main()
+{
+    // Cells left of the viewport, on rows below its first live cell, must
+    // not be drawn, nor shift into it.
+    vector<CellCoord> cells;
+    cells.push_back(CellCoord(2, 12));
+    cells.push_back(CellCoord(9, 3));
+    cells.push_back(CellCoord(9, 4));
+    cells.push_back(CellCoord(9, 5));
+    cells.push_back(CellCoord(9, 14));
+    cells.push_back(CellCoord(11, 17));
+    cells.push_back(CellCoord(11, 30));
+    checkBitmap(cells, 0, 10, 8, 12);
+
+    // Only cells left of the viewport.
+    cells.clear();
+    cells.push_back(CellCoord(4, 1));
+    cells.push_back(CellCoord(5, 2));
+    checkBitmap(cells, 0, 10, 8, 12);
+
+    // A viewport whose width isn't a multiple of 8 is widened, and cells in
+    // the widened part are drawn.
+    cells.clear();
+    cells.push_back(CellCoord(3, 9));
+    cells.push_back(CellCoord(3, 20));
+    cells.push_back(CellCoord(6, 25));
+    checkBitmap(cells, 1, 10, 13, 9);
+
+    return gFailures;
+}
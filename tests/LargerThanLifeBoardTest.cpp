@@ -0,0 +1,141 @@
+// Tests for LargerThanLifeBoard: its running sums must give the same
+// generations as counting the (2R+1)^2 cells around each cell, and rules
+// must parse as the usual notation has them.
+
+#include "Check.h"
+#include "LargerThanLifeBoard.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef LargerThanLifeBoard::Rule Rule;
+
+/// Work out the next generation of a board's cells, given row by row, by
+/// counting the neighbors of each cell one at a time.
+static vector<bool> bruteForce(const Rule& rule, const vector<bool>& cells, CellIndex rows, CellIndex columns)
+{
+    vector<bool> next(cells.size());
+    for (CellIndex i = 0; i < rows; i++)
+    {
+        for (CellIndex j = 0; j < columns; j++)
+        {
+            int neighbors = 0;
+            for (CellIndex di = -rule.radius; di <= rule.radius; di++)
+            {
+                for (CellIndex dj = -rule.radius; dj <= rule.radius; dj++)
+                {
+                    CellIndex ni = i + di, nj = j + dj;
+                    bool self = (di == 0) && (dj == 0);
+                    if ((ni >= 0) && (nj >= 0) && (ni < rows) && (nj < columns) && (!self || rule.countsSelf))
+                    {
+                        neighbors += cells[ni * columns + nj] ? 1 : 0;
+                    }
+                }
+            }
+            bool alive = cells[i * columns + j];
+            next[i * columns + j] = alive ?
+                ((neighbors >= rule.survivalMin) && (neighbors <= rule.survivalMax)) :
+                ((neighbors >= rule.birthMin) && (neighbors <= rule.birthMax));
+        }
+    }
+    return next;
+}
+
+/// Run a random soup under a rule, on a board that doesn't start at the
+/// origin, and compare each generation with the brute force count.
+static void checkRule(const string& text, CellIndex rows, CellIndex columns)
+{
+    Rule rule;
+    CHECK(LargerThanLifeBoard::parseRule(text, rule));
+    const CellIndex firstRow = -7, firstColumn = -70;
+    LargerThanLifeBoard board(rule, rows, columns, firstRow, firstColumn);
+
+    mt19937_64 random(rows * columns + rule.radius);
+    vector<bool> cells(rows * columns);
+    for (CellIndex i = 0; i < rows; i++)
+    {
+        for (CellIndex j = 0; j < columns; j++)
+        {
+            cells[i * columns + j] = (random() % 100) < 45;
+            board.setCell(firstRow + i, firstColumn + j, cells[i * columns + j]);
+        }
+    }
+
+    for (int g = 0; g < 12; g++)
+    {
+        board.update();
+        cells = bruteForce(rule, cells, rows, columns);
+        int differences = 0;
+        int64_t population = 0;
+        for (CellIndex i = 0; i < rows; i++)
+        {
+            for (CellIndex j = 0; j < columns; j++)
+            {
+                differences += (board.getCell(firstRow + i, firstColumn + j) != cells[i * columns + j]) ? 1 : 0;
+                population += cells[i * columns + j] ? 1 : 0;
+            }
+        }
+        CHECK(differences == 0);
+        CHECK(board.getPopulation() == population);
+    }
+}
+
+/// Check that a rule parses to the given fields, and formats back to
+/// a rule that parses to them too.
+static void checkParse(const string& text, int radius, bool countsSelf,
+    int survivalMin, int survivalMax, int birthMin, int birthMax)
+{
+    Rule rule;
+    CHECK(LargerThanLifeBoard::parseRule(text, rule));
+    CHECK((rule.radius == radius) && (rule.countsSelf == countsSelf));
+    CHECK((rule.survivalMin == survivalMin) && (rule.survivalMax == survivalMax));
+    CHECK((rule.birthMin == birthMin) && (rule.birthMax == birthMax));
+
+    Rule again;
+    CHECK(LargerThanLifeBoard::parseRule(LargerThanLifeBoard::formatRule(rule), again));
+    CHECK((again.radius == radius) && (again.countsSelf == countsSelf));
+    CHECK((again.survivalMin == survivalMin) && (again.survivalMax == survivalMax));
+    CHECK((again.birthMin == birthMin) && (again.birthMax == birthMax));
+}
+
+/// Check that a rule is rejected and leaves the rule it was given alone.
+static void checkReject(const string& text)
+{
+    Rule rule;
+    rule.radius = 9;
+    CHECK(!LargerThanLifeBoard::parseRule(text, rule));
+    CHECK(rule.radius == 9);
+}
+
+int main()
+{
+    // Sizes across several words, and one narrower than the neighborhood.
+    checkRule("R2,C0,M0,S3..6,B4..5,NM", 37, 130);
+    checkRule("R5,C0,M1,S34..58,B34..45,NM", 45, 77);
+    checkRule("R3,C0,M1,S0..20,B0..4,NM", 29, 100);
+    checkRule("R7,C0,M0,S10..40,B0..12", 9, 70);
+    checkRule("R1,C0,M0,S2..3,B3..3,NM", 20, 65);
+
+    checkParse("R5,C0,M1,S34..58,B34..45,NM", 5, true, 34, 58, 34, 45);
+    checkParse("r2,c2,m0,s2..3,b3,nm", 2, false, 2, 3, 3, 3);
+    checkParse("B0..4,S0..20,R255,M1", 255, true, 0, 20, 0, 4);
+
+    checkReject("");
+    checkReject("R2,C0,M0,S2..3,NM");
+    checkReject("R2,C0,M0,B3,NM");
+    checkReject("C0,M0,S2..3,B3,NM");
+    checkReject("R0,C0,M0,S2..3,B3,NM");
+    checkReject("R256,C0,M0,S2..3,B3,NM");
+    checkReject("R2,C3,M0,S2..3,B3,NM");
+    checkReject("R2,C0,M2,S2..3,B3,NM");
+    checkReject("R2,C0,M0,S3..2,B3,NM");
+    checkReject("R2,C0,M0,S2..,B3,NM");
+    checkReject("R2,C0,M0,S2..3,B3,NN");
+    checkReject("R2,C0,M0,S2..3,B3,NM,X1");
+    checkReject("R2,,C0,M0,S2..3,B3,NM");
+    checkReject("Rx,C0,M0,S2..3,B3,NM");
+    checkReject("R2a,C0,M0,S2..3,B3,NM");
+    return gFailures;
+}
@@ -0,0 +1,175 @@
+// Tests that snapshots can be read on other threads while the board they
+// were taken of goes on updating.
+
+#include "BasicBoard.h"
+#include "Check.h"
+#include "CellCodec.h"
+#include "PackedBoard.h"
+#include "SparseBoard.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const int GENERATIONS = 200; /// Generations each board runs.
+static const int READERS = 3; /// Threads reading snapshots.
+
+/// A snapshot and the generation it was taken at.
+struct Taken
+{
+    shared_ptr<const Board> board;
+    int generation;
+};
+
+/// Seed a board with a soup in rows and columns [8, 56).
+static void seed(Board& board)
+{
+    mt19937_64 random(1);
+    for (CellIndex i = 8; i < 56; i++)
+    {
+        for (CellIndex j = 8; j < 56; j++)
+        {
+            if (random() % 100 < 37)
+            {
+                board.setCell(i, j, true);
+            }
+        }
+    }
+}
+
+/**
+ * Run a board, taking a snapshot every generation, while reader threads
+ * check the latest snapshot against the live cells expected at its
+ * generation.
+ * @param board - board to run, freshly constructed
+ * @param reference - board of the same kind used to work out the expected cells
+ */
+static void checkConcurrentReads(Board& board, Board& reference)
+{
+    seed(reference);
+    vector<vector<CellCoord> > expected(GENERATIONS + 1);
+    for (int g = 0; g <= GENERATIONS; g++)
+    {
+        getLiveCells(reference, expected[g]);
+        reference.update();
+    }
+
+    seed(board);
+    mutex latestMutex;
+    Taken latest = { board.snapshot(), 0 };
+    atomic<bool> done(false);
+    atomic<int> mismatches(0), reads(0);
+
+    vector<thread> readers;
+    for (int r = 0; r < READERS; r++)
+    {
+        readers.push_back(thread([&]()
+        {
+            while (!done)
+            {
+                Taken taken;
+                {
+                    lock_guard<mutex> lock(latestMutex);
+                    taken = latest;
+                }
+
+                // Read the snapshot several ways while the board changes.
+                vector<CellCoord> cells;
+                getLiveCells(*taken.board, cells);
+                const vector<CellCoord>& want = expected[taken.generation];
+                CellIndex iMin, jMin, iMax, jMax;
+                bool any = taken.board->getBoundingBox(iMin, jMin, iMax, jMax);
+                if ((cells != want) ||
+                    (taken.board->getPopulation() != static_cast<int64_t>(want.size())) ||
+                    (any && (taken.board->countCells(iMin, jMin, iMax, jMax) != static_cast<int64_t>(want.size()))))
+                {
+                    mismatches++;
+                }
+                int width = 64, height = 64;
+                delete[] taken.board->getBitmap(0, 0, width, height);
+                reads++;
+            }
+        }));
+    }
+
+    for (int g = 1; g <= GENERATIONS; g++)
+    {
+        board.update();
+        Taken taken = { board.snapshot(), g };
+        lock_guard<mutex> lock(latestMutex);
+        latest = taken;
+    }
+
+    // Let the readers see the last snapshot too.
+    while (reads < READERS * 4)
+    {
+        this_thread::yield();
+    }
+    done = true;
+    for (size_t r = 0; r < readers.size(); r++)
+    {
+        readers[r].join();
+    }
+
+    CHECK(mismatches == 0);
+    vector<CellCoord> cells;
+    getLiveCells(board, cells);
+    CHECK(cells == expected[GENERATIONS]);
+}
+
+/// Check that a BasicBoard's snapshots keep their cells while the rows
+/// they share are changed by setCell(), setCells() and clearBoard().
+static void checkBasicWrites()
+{
+    BasicBoard board(64, 64);
+    seed(board);
+    vector<CellCoord> seeded;
+    getLiveCells(board, seeded);
+    shared_ptr<const Board> first = board.snapshot();
+    CHECK(dynamic_cast<const FrozenBasicBoard*>(first.get()) != NULL);
+
+    for (CellIndex i = 0; i < 64; i += 3)
+    {
+        board.setCell(i, i, !board.getCell(i, i));
+    }
+    CellCoord batch[] = { CellCoord(0, 63), CellCoord(63, 0), CellCoord(20, 20) };
+    board.setCells(batch, 3);
+    vector<CellCoord> changed;
+    getLiveCells(board, changed);
+    shared_ptr<const Board> second = board.snapshot();
+
+    board.clearBoard();
+    CHECK(board.getPopulation() == 0);
+    vector<CellCoord> cells;
+    getLiveCells(*first, cells);
+    CHECK(cells == seeded);
+    CHECK(first->countCells(0, 0, 63, 63) == static_cast<int64_t>(seeded.size()));
+    getLiveCells(*second, cells);
+    CHECK(cells == changed);
+    CHECK(second->countCells(0, 0, 63, 63) == static_cast<int64_t>(changed.size()));
+    CHECK(second->countCells(-5, 10, 20, 20) == count_if(changed.begin(), changed.end(),
+        [](const CellCoord& c) { return (c.first <= 20) && (c.second >= 10) && (c.second <= 20); }));
+}
+
+int main()
+{
+    checkBasicWrites();
+    {
+        BasicBoard board(64, 64), reference(64, 64);
+        checkConcurrentReads(board, reference);
+    }
+    {
+        SparseBoard board, reference;
+        checkConcurrentReads(board, reference);
+    }
+    {
+        PackedBoard board(64, 64), reference(64, 64);
+        checkConcurrentReads(board, reference);
+    }
+    return gFailures;
+}
@@ -0,0 +1,102 @@
+// Tests for TiledFileBoard: it must run as PackedBoard does, whatever the
+// resident limit, the generations per sweep and where the tiles are kept.
+
+#include "CellCodec.h"
+#include "Check.h"
+#include "PackedBoard.h"
+#include "TiledFileBoard.h"
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// Two tiles high and three wide, neither a whole number of tiles or words.
+static const CellIndex ROWS = TiledFileBoard::TILE_ROWS + 477;
+static const CellIndex COLUMNS = 2 * TiledFileBoard::TILE_COLUMNS + 253;
+
+/// Fill a square of random cells on both boards, clipped to the board.
+static void addSoup(Board& tiled, Board& packed, mt19937_64& random, CellIndex top, CellIndex left, CellIndex side)
+{
+    for (CellIndex i = max<CellIndex>(top, 0); i < min(top + side, ROWS); i++)
+    {
+        for (CellIndex j = max<CellIndex>(left, 0); j < min(left + side, COLUMNS); j++)
+        {
+            if (random() % 100 < 37)
+            {
+                tiled.setCell(i, j, true);
+                packed.setCell(i, j, true);
+            }
+        }
+    }
+}
+
+/// Compare the live cells, population and bounding box of both boards.
+static void checkSame(const TiledFileBoard& tiled, const PackedBoard& packed)
+{
+    vector<CellCoord> cells, expected;
+    getLiveCells(tiled, cells);
+    getLiveCells(packed, expected);
+    CHECK(cells == expected);
+    CHECK(tiled.getPopulation() == packed.getPopulation());
+
+    CellIndex iMin, jMin, iMax, jMax, iMin2, jMin2, iMax2, jMax2;
+    CHECK(tiled.getBoundingBox(iMin, jMin, iMax, jMax) == packed.getBoundingBox(iMin2, jMin2, iMax2, jMax2));
+    CHECK(expected.empty() || ((iMin == iMin2) && (jMin == jMin2) && (iMax == iMax2) && (jMax == jMax2)));
+}
+
+/// Run soups on the seams, corners and edges of the tiles, leaving some
+/// tiles empty, with each number of generations per sweep in turn.
+static void checkBoard(TiledFileBoard& tiled)
+{
+    PackedBoard packed(ROWS, COLUMNS);
+    mt19937_64 random(ROWS * COLUMNS);
+    const CellIndex tileRows = TiledFileBoard::TILE_ROWS, tileColumns = TiledFileBoard::TILE_COLUMNS;
+    addSoup(tiled, packed, random, tileRows - 60, tileColumns - 60, 120);
+    addSoup(tiled, packed, random, tileRows - 40, 2 * tileColumns - 90, 150);
+    addSoup(tiled, packed, random, -20, 300, 100);
+    addSoup(tiled, packed, random, ROWS - 70, COLUMNS - 70, 100);
+    addSoup(tiled, packed, random, 500, -30, 90);
+    checkSame(tiled, packed);
+
+    const int sweeps[] = { 1, 2, 5, 17, 63, 64 };
+    for (size_t s = 0; s < sizeof(sweeps) / sizeof(sweeps[0]); s++)
+    {
+        // Take a few more generations than a sweep, so the last sweep is short.
+        tiled.setSweepGenerations(sweeps[s]);
+        tiled.advance(sweeps[s] + 3);
+        for (int g = 0; g < sweeps[s] + 3; g++)
+        {
+            packed.update();
+        }
+        checkSame(tiled, packed);
+
+        // Wake a tile that has been empty so far.
+        addSoup(tiled, packed, random, tileRows + 200 + 20 * static_cast<CellIndex>(s), 2 * tileColumns + 50, 40);
+    }
+
+    tiled.update();
+    packed.update();
+    checkSame(tiled, packed);
+}
+
+int main()
+{
+    TiledFileBoard tiled(ROWS, COLUMNS);
+    checkBoard(tiled);
+
+    // With one tile mapped at a time, every step of a sweep remaps.
+    TiledFileBoard limited(ROWS, COLUMNS, "", 1);
+    checkBoard(limited);
+    CHECK(limited.getTileLoads() > tiled.getTileLoads());
+
+    // A directory that can't hold the file keeps the tiles on the heap.
+    TiledFileBoard heap(ROWS, COLUMNS, "/nonexistent/gol_tiles", 1);
+    CHECK(!heap.isFileBacked());
+    checkBoard(heap);
+
+#ifdef GOL_HAVE_MMAP
+    CHECK(tiled.isFileBacked());
+    CHECK(limited.isFileBacked());
+#endif
+    return gFailures;
+}